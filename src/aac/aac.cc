@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,7 +7,9 @@
 #include <neaacdec.h>
 
 #include <audacious/audtag.h>
+#include <libaudcore/audstrings.h>
 #include <libaudcore/i18n.h>
+#include <libaudcore/multihash.h>
 #include <libaudcore/plugin.h>
 #include <libaudcore/runtime.h>
 
@@ -144,6 +148,213 @@ static int aac_probe (unsigned char * buf, int len)
     return len;
 }
 
+/*
+ * ADTS frame index.  One sequential pass over the file reads only the 7-byte
+ * frame headers (no decoding), giving the exact number of samples and thus an
+ * exact length, as well as the byte offset of every INDEX_INTERVAL'th frame
+ * for seeking.  Indexes are kept in memory for the last few files, so that
+ * playback can reuse the index built while reading the tag.  Only local files
+ * are indexed, since the pass reads the whole file.
+ */
+
+#define INDEX_INTERVAL 16      /* frames between seek points */
+#define INDEX_CHUNK 65536      /* bytes read at a time */
+#define INDEX_CACHE_SIZE 32    /* files */
+
+struct ADTSSeekPoint
+{
+    int64_t offset;
+    int64_t sample;
+};
+
+struct ADTSIndex
+{
+    int rate = 0;              /* from the ADTS headers (before SBR) */
+    int64_t samples = 0;
+    int64_t bytes = 0;
+    Index<ADTSSeekPoint> points;
+};
+
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SimpleHash<String, ADTSIndex> index_cache;
+
+/* Parses an ADTS header, returning the frame size in bytes (or 0 if the
+ * header is not valid) and the number of samples in the frame. */
+static int parse_adts_header (const unsigned char * buf, int * rate_index, int * samples)
+{
+    if (buf[0] != 0xff || (buf[1] & 0xf6) != 0xf0)
+        return 0;
+
+    * rate_index = (buf[2] >> 2) & 0x0f;
+    if (* rate_index > 11)
+        return 0;
+
+    int size = ((buf[3] & 0x03) << 11) | (buf[4] << 3) | (buf[5] >> 5);
+    if (size < 7)
+        return 0;
+
+    * samples = 1024 * ((buf[6] & 0x03) + 1);
+    return size;
+}
+
+static int64_t skip_id3v2 (VFSFile & file)
+{
+    unsigned char id3[10];
+
+    if (file.fread (id3, 1, 10) != 10 || strncmp ((char *) id3, "ID3", 3))
+        return 0;
+
+    return 10 + (id3[6] << 21) + (id3[7] << 14) + (id3[8] << 7) + id3[9];
+}
+
+static bool build_adts_index (VFSFile & file, ADTSIndex & index)
+{
+    static const int srates[] = {96000, 88200, 64000, 48000, 44100, 32000,
+     24000, 22050, 16000, 12000, 11025, 8000};
+
+    if (file.fseek (0, VFS_SEEK_SET) < 0)
+        return false;
+
+    int64_t start = skip_id3v2 (file);
+    if (file.fseek (start, VFS_SEEK_SET) < 0)
+        return false;
+
+    Index<unsigned char> buf;
+    buf.resize (INDEX_CHUNK);
+
+    int64_t buf_offset = start;  /* file offset of buf[0] */
+    int filled = 0, pos = 0;
+    int64_t frames = 0;
+    int first_rate = -1;
+    bool eof = false;
+
+    index.points.clear ();
+    index.samples = 0;
+    index.bytes = 0;
+
+    while (1)
+    {
+        /* refill so that a whole header is available at pos */
+        if (filled - pos < 7 && ! eof)
+        {
+            memmove (buf.begin (), buf.begin () + pos, filled - pos);
+            buf_offset += pos;
+            filled -= pos;
+            pos = 0;
+
+            int64_t got = file.fread (buf.begin () + filled, 1, INDEX_CHUNK - filled);
+            if (got <= 0)
+                eof = true;
+            else
+                filled += got;
+        }
+
+        if (filled - pos < 7)
+            break;
+
+        int rate_index, samples;
+        int size = parse_adts_header (& buf[pos], & rate_index, & samples);
+
+        if (! size || (first_rate >= 0 && rate_index != first_rate))
+        {
+            /* the first frame must follow the ID3v2 tag directly; otherwise
+             * this is not an ADTS stream (ADIF, for example) */
+            if (! frames)
+                return false;
+
+            /* lost sync; give up at trailing tags, otherwise resync */
+            if (! strncmp ((char *) & buf[pos], "TAG", 3) ||
+             (filled - pos >= 8 && ! strncmp ((char *) & buf[pos], "APETAGEX", 8)))
+                break;
+
+            pos ++;
+            continue;
+        }
+
+        if (first_rate < 0)
+            first_rate = rate_index;
+
+        if (frames % INDEX_INTERVAL == 0)
+        {
+            ADTSSeekPoint point = {buf_offset + pos, index.samples};
+            index.points.append (point);
+        }
+
+        frames ++;
+        index.samples += samples;
+        index.bytes += size;
+
+        /* skip the frame body, which may extend beyond the buffer */
+        if (size <= filled - pos)
+            pos += size;
+        else
+        {
+            int64_t next = buf_offset + pos + size;
+
+            if (file.fseek (next, VFS_SEEK_SET) < 0)
+                break;
+
+            buf_offset = next;
+            filled = pos = 0;
+        }
+    }
+
+    if (first_rate < 0)
+        return false;
+
+    index.rate = srates[first_rate];
+    return true;
+}
+
+static String index_cache_key (const char * filename, VFSFile & file)
+{
+    return String (str_printf ("%s:%" PRId64, filename, file.fsize ()));
+}
+
+/* Builds the index for a file, or copies it from the cache. */
+static bool get_adts_index (const char * filename, VFSFile & file, ADTSIndex & index)
+{
+    String key = index_cache_key (filename, file);
+
+    pthread_mutex_lock (& index_mutex);
+
+    ADTSIndex * cached = index_cache.lookup (key);
+    if (cached)
+    {
+        index.rate = cached->rate;
+        index.samples = cached->samples;
+        index.bytes = cached->bytes;
+        index.points.clear ();
+        index.points.insert (cached->points.begin (), 0, cached->points.len ());
+    }
+
+    pthread_mutex_unlock (& index_mutex);
+
+    if (cached)
+        return true;
+
+    if (! build_adts_index (file, index))
+        return false;
+
+    ADTSIndex copy;
+    copy.rate = index.rate;
+    copy.samples = index.samples;
+    copy.bytes = index.bytes;
+    copy.points.insert (index.points.begin (), 0, index.points.len ());
+
+    pthread_mutex_lock (& index_mutex);
+
+    /* crude, but keeps memory bounded during library scans */
+    if (index_cache.n_items () >= INDEX_CACHE_SIZE)
+        index_cache.clear ();
+
+    index_cache.add (key, std::move (copy));
+
+    pthread_mutex_unlock (& index_mutex);
+
+    return true;
+}
+
 /* Gets info (some approximated) from an AAC/ADTS file.  <length> is
  * milliseconds, <bitrate> is kilobits per second.  Any parameters that cannot
  * be read are set to -1. */
@@ -259,8 +470,19 @@ bool AACDecoder::read_tag (const char * filename, VFSFile & file, Tuple & tuple,
 
     tuple.set_str (Tuple::Codec, "MPEG-2/4 AAC");
 
-    // TODO: error handling
-    calc_aac_info (file, &length, &bitrate, &samplerate, &channels);
+    ADTSIndex index;
+
+    if (file.fsize () >= 0 && uri_to_filename (filename) &&
+     get_adts_index (filename, file, index) && index.samples > 0)
+    {
+        length = index.samples * 1000 / index.rate;
+        bitrate = length ? index.bytes * 8 / length : -1;
+    }
+    else
+    {
+        // TODO: error handling
+        calc_aac_info (file, &length, &bitrate, &samplerate, &channels);
+    }
 
     if (length > 0)
         tuple.set_int (Tuple::Length, length);
@@ -272,6 +494,44 @@ bool AACDecoder::read_tag (const char * filename, VFSFile & file, Tuple & tuple,
     return true;
 }
 
+/* Seeks to the last indexed frame at or before <time>.  Returns the number of
+ * samples (at the ADTS header rate) to be skipped after that frame. */
+static int64_t aac_seek_indexed (VFSFile & file, NeAACDecHandle dec, int time,
+ const ADTSIndex & index, void * buf, int size, int * buflen)
+{
+    int64_t target = (int64_t) time * index.rate / 1000;
+
+    int lo = 0, hi = index.points.len ();
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if (index.points[mid].sample <= target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const ADTSSeekPoint & point = index.points[lo];
+
+    if (file.fseek (point.offset, VFS_SEEK_SET))
+        return 0;
+
+    * buflen = file.fread (buf, 1, size);
+
+    unsigned char chan;
+    unsigned long rate;
+    int used;
+
+    if ((used = NeAACDecInit (dec, (unsigned char *) buf, * buflen, & rate, & chan)))
+    {
+        * buflen -= used;
+        memmove (buf, (char *) buf + used, * buflen);
+        * buflen += file.fread ((char *) buf + * buflen, 1, size - * buflen);
+    }
+
+    return aud::max (target - point.sample, (int64_t) 0);
+}
+
 static void aac_seek (VFSFile & file, NeAACDecHandle dec, int time, int len,
  void * buf, int size, int * buflen)
 {
@@ -332,6 +592,14 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
     Tuple tuple = get_playback_tuple ();
     int bitrate = 1000 * aud::max (0, tuple.get_int (Tuple::Bitrate));
 
+    /* the index is only built on the first seek, so that playback can start
+     * at once; without one, seeks are estimated from the file size */
+    ADTSIndex index;
+    bool can_index = (file.fsize () >= 0 && uri_to_filename (filename));
+    bool indexed = false;
+
+    int64_t skip = 0;  /* floats to drop after a seek */
+
     if ((decoder = NeAACDecOpen ()) == nullptr)
     {
         AUDERR ("Open Decoder Error\n");
@@ -412,7 +680,22 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
         if (seek_value >= 0)
         {
             int length = tuple.get_int (Tuple::Length);
-            if (length > 0)
+
+            if (can_index)
+            {
+                indexed = (get_adts_index (filename, file, index) && index.points.len ());
+                can_index = false;
+            }
+
+            if (indexed)
+            {
+                skip = aac_seek_indexed (file, decoder, seek_value, index, buf,
+                 sizeof buf, & buflen);
+
+                /* the output rate is doubled for HE-AAC */
+                skip = skip * (int64_t) samplerate / index.rate * channels;
+            }
+            else if (length > 0)
                 aac_seek (file, decoder, seek_value, length, buf, sizeof buf, & buflen);
         }
 
@@ -456,7 +739,20 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
         /* == PLAY THE SOUND == */
 
         if (audio && info.samples)
-            write_audio (audio, sizeof (float) * info.samples);
+        {
+            int64_t samples = info.samples;
+
+            if (skip)
+            {
+                int64_t dropped = aud::min (skip, samples);
+                audio = (float *) audio + dropped;
+                samples -= dropped;
+                skip -= dropped;
+            }
+
+            if (samples)
+                write_audio (audio, sizeof (float) * samples);
+        }
     }
 
     NeAACDecClose (decoder);
@@ -22,6 +22,7 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 /* prevent libcdio from redefining PACKAGE, VERSION, etc. */
 #define EXTERNAL_LIBCDIO_CONFIG_H
@@ -51,12 +52,19 @@
 #include <libaudcore/preferences.h>
 #include <libaudcore/runtime.h>
 
+#include "cddb-cache.h"
+
 #define MIN_DISC_SPEED 2
 #define MAX_DISC_SPEED 24
 
 #define MAX_RETRIES 10
 #define MAX_SKIPS 10
 
+#define SECTOR_SIZE 2352
+#define READAHEAD_SECONDS 4
+#define MIN_READ_SECTORS 16
+#define MAX_READ_SECTORS 75
+
 static const char * const cdaudio_schemes[] = {"cdda", nullptr};
 
 class CDAudio : public InputPlugin
@@ -105,9 +113,15 @@ static int firsttrackno = -1;
 static int lasttrackno = -1;
 static int n_audio_tracks;
 static cdrom_drive_t *pcdrom_drive = nullptr;
+static bool is_image;  /* pcdrom_drive is a BIN/CUE, NRG, or TOC image */
 static Index<trackinfo_t> trackinfo;
 static QueuedFunc purge_func;
 
+/* lock import_mutex to read / set these variables */
+static pthread_mutex_t import_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t import_thread;
+static bool import_started, import_running, import_abort;
+
 static bool scan_cd ();
 static bool refresh_trackinfo (bool warning);
 static void reset_trackinfo ();
@@ -130,12 +144,14 @@ const char * const CDAudio::defaults[] = {
  "cddbport", "8880",
  nullptr};
 
+static void import_cddb_dump ();
+
 const PreferencesWidget CDAudio::widgets[] = {
     WidgetLabel (N_("<b>Device</b>")),
     WidgetSpin (N_("Read speed:"),
         WidgetInt ("CDDA", "disc_speed"),
         {MIN_DISC_SPEED, MAX_DISC_SPEED, 1}),
-    WidgetEntry (N_("Override device:"),
+    WidgetEntry (N_("Override device (or disc image):"),
         WidgetString ("CDDA", "device")),
     WidgetLabel (N_("<b>Metadata</b>")),
     WidgetCheck (N_("Use CD-Text"),
@@ -156,6 +172,13 @@ const PreferencesWidget CDAudio::widgets[] = {
     WidgetSpin (N_("Port:"),
         WidgetInt ("CDDA", "cddbport"),
         {0, 65535, 1},
+        WIDGET_CHILD),
+    WidgetFileEntry (N_("freedb dump:"),
+        WidgetString ("CDDA", "cddb_import_path"),
+        {FileSelectMode::Folder},
+        WIDGET_CHILD),
+    WidgetButton (N_("Import into local cache"),
+        {import_cddb_dump},
         WIDGET_CHILD)
 };
 
@@ -210,7 +233,53 @@ static void monitor (void *)
     pthread_mutex_unlock (& mutex);
 }
 
+static bool import_aborted ()
+{
+    pthread_mutex_lock (& import_mutex);
+    bool aborted = import_abort;
+    pthread_mutex_unlock (& import_mutex);
+
+    return aborted;
+}
+
+/* import thread */
+static void * import_worker (void *)
+{
+    String uri = aud_get_str ("CDDA", "cddb_import_path");
+    StringBuf path = uri[0] ? uri_to_filename (uri) : StringBuf ();
+
+    if (path)
+    {
+        int count = cddb_cache_import (path, import_aborted);
+        AUDINFO ("Imported %d CDDB entries from %s.\n", count, (const char *) path);
+    }
+    else
+        AUDERR ("No freedb dump to import.\n");
+
+    pthread_mutex_lock (& import_mutex);
+    import_running = false;
+    pthread_mutex_unlock (& import_mutex);
+
+    return nullptr;
+}
+
 /* main thread only */
+static void import_cddb_dump ()
+{
+    pthread_mutex_lock (& import_mutex);
+
+    if (! import_running)
+    {
+        if (import_started)
+            pthread_join (import_thread, nullptr);
+
+        import_started = import_running =
+         ! pthread_create (& import_thread, nullptr, import_worker, nullptr);
+    }
+
+    pthread_mutex_unlock (& import_mutex);
+}
+
 bool CDAudio::init ()
 {
     aud_config_set_defaults ("CDDA", defaults);
@@ -232,6 +301,161 @@ bool CDAudio::is_our_file (const char * filename, VFSFile & file)
     return !strncmp (filename, "cdda://", 7);
 }
 
+/*
+ * Read-ahead worker.  Sectors are read from the drive on a separate thread
+ * into a ring buffer holding a few seconds of audio, so that the output does
+ * not stall while the drive spins up or re-reads a bad sector.  The read size
+ * adapts to errors, and the drive speed is raised temporarily when the buffer
+ * runs low.
+ */
+struct ReadAhead
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+    pthread_t thread;
+
+    Index<unsigned char> ring;
+    int size = 0;        /* in sectors */
+    int start = 0;       /* index of the first buffered sector */
+    int used = 0;        /* number of buffered sectors */
+
+    int readlsn = 0;     /* next sector to be read */
+    int endlsn = 0;
+    int serial = 0;      /* incremented on each seek */
+    int base_speed = 0;
+
+    bool stop = false;
+    bool eof = false;
+    bool error = false;
+};
+
+/* read-ahead thread only */
+static void set_speed (int speed)
+{
+    if (is_image)
+        return;
+
+    if (cdda_speed_set (pcdrom_drive, speed) != DRIVER_OP_SUCCESS)
+        AUDERR ("Cannot set drive speed.\n");
+    else
+        AUDDBG ("Drive speed set to %d.\n", speed);
+}
+
+static void * readahead_worker (void * data)
+{
+    ReadAhead * ra = (ReadAhead *) data;
+
+    int chunk = MAX_READ_SECTORS;
+    int speed = ra->base_speed;
+    int retry_count = 0, skip_count = 0;
+
+    pthread_mutex_lock (& ra->mutex);
+
+    while (! ra->stop)
+    {
+        if (ra->eof || ra->error || ra->used == ra->size)
+        {
+            /* buffer is full; the drive can slow down again */
+            if (ra->used == ra->size && speed != ra->base_speed)
+            {
+                speed = ra->base_speed;
+                set_speed (speed);
+            }
+
+            pthread_cond_wait (& ra->cond, & ra->mutex);
+            continue;
+        }
+
+        /* read into the free part of the ring, without wrapping */
+        int tail = (ra->start + ra->used) % ra->size;
+        int sectors = aud::min (chunk, ra->size - ra->used);
+        sectors = aud::min (sectors, ra->size - tail);
+        sectors = aud::min (sectors, ra->endlsn + 1 - ra->readlsn);
+
+        int lsn = ra->readlsn;
+        int serial = ra->serial;
+        bool low = (ra->used < ra->size / 4);
+
+        pthread_mutex_unlock (& ra->mutex);
+
+        if (low && speed < MAX_DISC_SPEED)
+        {
+            speed = aud::min (speed * 2, MAX_DISC_SPEED);
+            set_speed (speed);
+        }
+
+        int ret = cdio_read_audio_sectors (pcdrom_drive->p_cdio,
+         & ra->ring[tail * SECTOR_SIZE], lsn, sectors);
+
+        pthread_mutex_lock (& ra->mutex);
+
+        /* discard the data if there was a seek in the meantime */
+        if (serial != ra->serial)
+        {
+            retry_count = 0;
+            skip_count = 0;
+            continue;
+        }
+
+        if (ret == DRIVER_OP_SUCCESS)
+        {
+            ra->used += sectors;
+            ra->readlsn += sectors;
+            ra->eof = (ra->readlsn > ra->endlsn);
+
+            chunk = aud::min (chunk * 2, MAX_READ_SECTORS);
+            retry_count = 0;
+            skip_count = 0;
+        }
+        else if (chunk > MIN_READ_SECTORS)
+        {
+            /* maybe a smaller read size will help */
+            chunk /= 2;
+        }
+        else if (retry_count < MAX_RETRIES)
+        {
+            /* still failed; retry a few times */
+            retry_count ++;
+        }
+        else if (skip_count < MAX_SKIPS)
+        {
+            /* maybe the disk is scratched; try skipping ahead */
+            ra->readlsn = aud::min (ra->readlsn + 75, ra->endlsn + 1);
+            ra->eof = (ra->readlsn > ra->endlsn);
+            skip_count ++;
+        }
+        else
+        {
+            /* still failed; give it up */
+            ra->error = true;
+        }
+
+        pthread_cond_broadcast (& ra->cond);
+    }
+
+    pthread_mutex_unlock (& ra->mutex);
+
+    if (speed != ra->base_speed)
+        set_speed (ra->base_speed);
+
+    return nullptr;
+}
+
+static void readahead_seek (ReadAhead * ra, int lsn)
+{
+    pthread_mutex_lock (& ra->mutex);
+
+    ra->start = 0;
+    ra->used = 0;
+    ra->readlsn = lsn;
+    ra->serial ++;
+    ra->eof = (lsn > ra->endlsn);
+    ra->error = false;
+
+    pthread_cond_broadcast (& ra->cond);
+    pthread_mutex_unlock (& ra->mutex);
+}
+
 /* play thread only */
 bool CDAudio::play (const char * name, VFSFile & file)
 {
@@ -269,68 +493,96 @@ bool CDAudio::play (const char * name, VFSFile & file)
 
     playing = true;
 
-    int buffer_size = aud_get_int (nullptr, "output_buffer_size");
     int speed = aud_get_int ("CDDA", "disc_speed");
-    speed = aud::clamp (speed, MIN_DISC_SPEED, MAX_DISC_SPEED);
-    int sectors = aud::clamp (buffer_size / 2, 50, 250) * speed * 75 / 1000;
-    int currlsn = startlsn;
-    int retry_count = 0, skip_count = 0;
 
-    Index<unsigned char> buffer;
-    buffer.insert (0, 2352 * sectors);
+    ReadAhead ra;
+    ra.size = READAHEAD_SECONDS * 75;
+    ra.ring.insert (0, SECTOR_SIZE * ra.size);
+    ra.readlsn = startlsn;
+    ra.endlsn = endlsn;
+    ra.base_speed = aud::clamp (speed, MIN_DISC_SPEED, MAX_DISC_SPEED);
+
+    /* unlock mutex here to avoid blocking
+     * other threads must be careful not to close drive handle */
+    pthread_mutex_unlock (& mutex);
+
+    if (pthread_create (& ra.thread, nullptr, readahead_worker, & ra))
+    {
+        cdaudio_error (_("Error reading audio CD."));
+
+        pthread_mutex_lock (& mutex);
+        playing = false;
+        pthread_mutex_unlock (& mutex);
+        return false;
+    }
 
     while (! check_stop ())
     {
         int seek_time = check_seek ();
         if (seek_time >= 0)
-            currlsn = startlsn + (seek_time * 75 / 1000);
+            readahead_seek (& ra, startlsn + (seek_time * 75 / 1000));
 
-        sectors = aud::min (sectors, endlsn + 1 - currlsn);
-        if (sectors < 1)
-            break;
+        pthread_mutex_lock (& ra.mutex);
 
-        /* unlock mutex here to avoid blocking
-         * other threads must be careful not to close drive handle */
-        pthread_mutex_unlock (& mutex);
+        if (! ra.used)
+        {
+            if (ra.eof)
+            {
+                pthread_mutex_unlock (& ra.mutex);
+                break;
+            }
 
-        int ret = cdio_read_audio_sectors (pcdrom_drive->p_cdio,
-         buffer.begin (), currlsn, sectors);
+            if (ra.error)
+            {
+                pthread_mutex_unlock (& ra.mutex);
+                cdaudio_error (_("Error reading audio CD."));
+                break;
+            }
 
-        if (ret == DRIVER_OP_SUCCESS)
-            write_audio (buffer.begin (), 2352 * sectors);
+            /* wake up periodically to check for stop and seek requests */
+            timeval now;
+            gettimeofday (& now, nullptr);
 
-        pthread_mutex_lock (& mutex);
+            timespec until;
+            until.tv_sec = now.tv_sec + (now.tv_usec >= 900000);
+            until.tv_nsec = ((now.tv_usec + 100000) % 1000000) * 1000;
 
-        if (ret == DRIVER_OP_SUCCESS)
-        {
-            currlsn += sectors;
-            retry_count = 0;
-            skip_count = 0;
-        }
-        else if (sectors > 16)
-        {
-            /* maybe a smaller read size will help */
-            sectors /= 2;
-        }
-        else if (retry_count < MAX_RETRIES)
-        {
-            /* still failed; retry a few times */
-            retry_count ++;
-        }
-        else if (skip_count < MAX_SKIPS)
-        {
-            /* maybe the disk is scratched; try skipping ahead */
-            currlsn = aud::min (currlsn + 75, endlsn + 1);
-            skip_count ++;
+            pthread_cond_timedwait (& ra.cond, & ra.mutex, & until);
+            pthread_mutex_unlock (& ra.mutex);
+            continue;
         }
-        else
+
+        /* the worker never writes into the buffered part of the ring */
+        int sectors = aud::min (ra.used, ra.size - ra.start);
+        sectors = aud::min (sectors, 75);
+        unsigned char * data = & ra.ring[ra.start * SECTOR_SIZE];
+        int serial = ra.serial;
+
+        pthread_mutex_unlock (& ra.mutex);
+
+        write_audio (data, SECTOR_SIZE * sectors);
+
+        pthread_mutex_lock (& ra.mutex);
+
+        if (serial == ra.serial)
         {
-            /* still failed; give it up */
-            cdaudio_error (_("Error reading audio CD."));
-            break;
+            ra.start = (ra.start + sectors) % ra.size;
+            ra.used -= sectors;
+            pthread_cond_broadcast (& ra.cond);
         }
+
+        pthread_mutex_unlock (& ra.mutex);
     }
 
+    pthread_mutex_lock (& ra.mutex);
+    ra.stop = true;
+    pthread_cond_broadcast (& ra.cond);
+    pthread_mutex_unlock (& ra.mutex);
+
+    pthread_join (ra.thread, nullptr);
+
+    pthread_mutex_lock (& mutex);
+
     playing = false;
 
     pthread_mutex_unlock (& mutex);
@@ -340,6 +592,19 @@ bool CDAudio::play (const char * name, VFSFile & file)
 /* main thread only */
 void CDAudio::cleanup ()
 {
+    pthread_mutex_lock (& import_mutex);
+    bool started = import_started;
+    import_abort = true;
+    pthread_mutex_unlock (& import_mutex);
+
+    if (started)
+        pthread_join (import_thread, nullptr);
+
+    pthread_mutex_lock (& import_mutex);
+    import_started = false;
+    import_abort = false;
+    pthread_mutex_unlock (& import_mutex);
+
     pthread_mutex_lock (& mutex);
 
     reset_trackinfo ();
@@ -428,7 +693,26 @@ static bool open_cd ()
     AUDDBG ("Opening CD drive.\n");
     String device = aud_get_str ("CDDA", "device");
 
-    if (device[0])
+    is_image = false;
+
+    if (device[0] && (str_has_suffix_nocase (device, ".cue") ||
+     str_has_suffix_nocase (device, ".bin") || str_has_suffix_nocase (device, ".nrg") ||
+     str_has_suffix_nocase (device, ".toc")))
+    {
+        /* disc images are read through libcdio's image drivers */
+        CdIo_t * p_cdio = cdio_open (device, DRIVER_UNKNOWN);
+
+        if (! p_cdio || ! (pcdrom_drive = cdda_identify_cdio (p_cdio, 1, nullptr)))
+        {
+            if (p_cdio)
+                cdio_destroy (p_cdio);
+
+            cdaudio_error (_("Failed to open disc image %s."), (const char *) device);
+        }
+        else
+            is_image = true;
+    }
+    else if (device[0])
     {
         if (! (pcdrom_drive = cdda_identify (device, 1, nullptr)))
             cdaudio_error (_("Failed to open CD device %s."), (const char *) device);
@@ -477,6 +761,166 @@ static bool check_disc_mode (bool warning)
     return true;
 }
 
+/* mutex must be locked */
+static void apply_cddb_entry (const CDDBEntry & entry)
+{
+    trackinfo[0].performer = entry.performer;
+    trackinfo[0].name = entry.name;
+    trackinfo[0].genre = entry.genre;
+
+    for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
+    {
+        int i = trackno - firsttrackno;
+        if (i >= entry.tracks.len ())
+            break;
+
+        trackinfo[trackno].performer = entry.tracks[i].performer;
+        trackinfo[trackno].name = entry.tracks[i].name;
+        trackinfo[trackno].genre = entry.genre;
+    }
+}
+
+/* mutex must be locked */
+static void lookup_cddb ()
+{
+    /* initialize de cddb subsystem */
+    cddb_conn_t *pcddb_conn = nullptr;
+    cddb_disc_t *pcddb_disc = nullptr;
+    cddb_track_t *pcddb_track = nullptr;
+    lba_t lba;              /* Logical Block Address */
+
+    Index<int> offsets;
+    CDDBEntry entry;
+
+    pcddb_disc = cddb_disc_new ();
+
+    lba = cdio_get_track_lba (pcdrom_drive->p_cdio,
+                              CDIO_CDROM_LEADOUT_TRACK);
+    int length = FRAMES_TO_SECONDS (lba);
+    cddb_disc_set_length (pcddb_disc, length);
+
+    for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
+    {
+        lba = cdio_get_track_lba (pcdrom_drive->p_cdio, trackno);
+        offsets.append (lba);
+
+        pcddb_track = cddb_track_new ();
+        cddb_track_set_frame_offset (pcddb_track, lba);
+        cddb_disc_add_track (pcddb_disc, pcddb_track);
+    }
+
+    cddb_disc_calc_discid (pcddb_disc);
+
+    unsigned discid = cddb_disc_get_discid (pcddb_disc);
+    AUDDBG ("CDDB disc id = %x\n", discid);
+
+    /* the local cache saves a round trip to the server, and works offline */
+    if (cddb_cache_lookup (discid, offsets, entry))
+    {
+        apply_cddb_entry (entry);
+        cddb_disc_destroy (pcddb_disc);
+        return;
+    }
+
+    pcddb_conn = cddb_new ();
+    if (pcddb_conn == nullptr)
+        cdaudio_error (_("Failed to create the cddb connection."));
+    else
+    {
+        AUDDBG ("getting CDDB info\n");
+
+        cddb_cache_enable (pcddb_conn);
+        // cddb_cache_set_dir(pcddb_conn, "~/.cddbslave");
+
+        String server = aud_get_str ("CDDA", "cddbserver");
+        String path = aud_get_str ("CDDA", "cddbpath");
+        int port = aud_get_int ("CDDA", "cddbport");
+
+        if (aud_get_bool (nullptr, "use_proxy"))
+        {
+            String prhost = aud_get_str (nullptr, "proxy_host");
+            int prport = aud_get_int (nullptr, "proxy_port");
+            String pruser = aud_get_str (nullptr, "proxy_user");
+            String prpass = aud_get_str (nullptr, "proxy_pass");
+
+            cddb_http_proxy_enable (pcddb_conn);
+            cddb_set_http_proxy_server_name (pcddb_conn, prhost);
+            cddb_set_http_proxy_server_port (pcddb_conn, prport);
+            cddb_set_http_proxy_username (pcddb_conn, pruser);
+            cddb_set_http_proxy_password (pcddb_conn, prpass);
+
+            cddb_set_server_name (pcddb_conn, server);
+            cddb_set_server_port (pcddb_conn, port);
+        }
+        else if (aud_get_bool ("CDDA", "cddbhttp"))
+        {
+            cddb_http_enable (pcddb_conn);
+            cddb_set_server_name (pcddb_conn, server);
+            cddb_set_server_port (pcddb_conn, port);
+            cddb_set_http_path_query (pcddb_conn, path);
+        }
+        else
+        {
+            cddb_set_server_name (pcddb_conn, server);
+            cddb_set_server_port (pcddb_conn, port);
+        }
+
+        int matches;
+        if ((matches = cddb_query (pcddb_conn, pcddb_disc)) == -1)
+        {
+            if (cddb_errno (pcddb_conn) == CDDB_ERR_OK)
+                cdaudio_error (_("Failed to query the CDDB server"));
+            else
+                cdaudio_error (_("Failed to query the CDDB server: %s"),
+                               cddb_error_str (cddb_errno
+                                               (pcddb_conn)));
+        }
+        else if (matches == 0)
+        {
+            AUDDBG ("no cddb info available for this disc\n");
+        }
+        else
+        {
+            AUDDBG ("CDDB disc category = \"%s\"\n",
+                   cddb_disc_get_category_str (pcddb_disc));
+
+            cddb_read (pcddb_conn, pcddb_disc);
+            if (cddb_errno (pcddb_conn) != CDDB_ERR_OK)
+            {
+                cdaudio_error (_("Failed to read the cddb info: %s"),
+                               cddb_error_str (cddb_errno
+                                               (pcddb_conn)));
+            }
+            else
+            {
+                entry.performer = String (cddb_disc_get_artist (pcddb_disc));
+                entry.name = String (cddb_disc_get_title (pcddb_disc));
+                entry.genre = String (cddb_disc_get_genre (pcddb_disc));
+
+                for (int i = 0; i < offsets.len (); i++)
+                {
+                    pcddb_track = cddb_disc_get_track (pcddb_disc, i);
+
+                    CDDBTrack & track = entry.tracks.append ();
+                    track.performer = String (cddb_track_get_artist (pcddb_track));
+                    track.name = String (cddb_track_get_title (pcddb_track));
+                }
+
+                apply_cddb_entry (entry);
+
+                /* the query may have returned a different (fuzzy matched)
+                 * disc ID, but the entry is filed under ours */
+                cddb_cache_store (discid, cddb_disc_get_category_str (pcddb_disc),
+                                  offsets, length, entry);
+            }
+        }
+
+        cddb_destroy (pcddb_conn);
+    }
+
+    cddb_disc_destroy (pcddb_disc);
+}
+
 /* mutex must be locked */
 static bool scan_cd ()
 {
@@ -498,7 +942,7 @@ static bool scan_cd ()
 
     int speed = aud_get_int ("CDDA", "disc_speed");
     speed = aud::clamp (speed, MIN_DISC_SPEED, MAX_DISC_SPEED);
-    if (cdda_speed_set (pcdrom_drive, speed) != DRIVER_OP_SUCCESS)
+    if (! is_image && cdda_speed_set (pcdrom_drive, speed) != DRIVER_OP_SUCCESS)
         AUDERR ("Cannot set drive speed.\n");
 
     firsttrackno = cdio_get_first_track_num (pcdrom_drive->p_cdio);
@@ -596,146 +1040,8 @@ static bool scan_cd ()
         }
     }
 
-    if (!cdtext_was_available)
-    {
-        /* initialize de cddb subsystem */
-        cddb_conn_t *pcddb_conn = nullptr;
-        cddb_disc_t *pcddb_disc = nullptr;
-        cddb_track_t *pcddb_track = nullptr;
-        lba_t lba;              /* Logical Block Address */
-
-        if (aud_get_bool ("CDDA", "use_cddb"))
-        {
-            pcddb_conn = cddb_new ();
-            if (pcddb_conn == nullptr)
-                cdaudio_error (_("Failed to create the cddb connection."));
-            else
-            {
-                AUDDBG ("getting CDDB info\n");
-
-                cddb_cache_enable (pcddb_conn);
-                // cddb_cache_set_dir(pcddb_conn, "~/.cddbslave");
-
-                String server = aud_get_str ("CDDA", "cddbserver");
-                String path = aud_get_str ("CDDA", "cddbpath");
-                int port = aud_get_int ("CDDA", "cddbport");
-
-                if (aud_get_bool (nullptr, "use_proxy"))
-                {
-                    String prhost = aud_get_str (nullptr, "proxy_host");
-                    int prport = aud_get_int (nullptr, "proxy_port");
-                    String pruser = aud_get_str (nullptr, "proxy_user");
-                    String prpass = aud_get_str (nullptr, "proxy_pass");
-
-                    cddb_http_proxy_enable (pcddb_conn);
-                    cddb_set_http_proxy_server_name (pcddb_conn, prhost);
-                    cddb_set_http_proxy_server_port (pcddb_conn, prport);
-                    cddb_set_http_proxy_username (pcddb_conn, pruser);
-                    cddb_set_http_proxy_password (pcddb_conn, prpass);
-
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                }
-                else if (aud_get_bool ("CDDA", "cddbhttp"))
-                {
-                    cddb_http_enable (pcddb_conn);
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                    cddb_set_http_path_query (pcddb_conn, path);
-                }
-                else
-                {
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                }
-
-                pcddb_disc = cddb_disc_new ();
-
-                lba = cdio_get_track_lba (pcdrom_drive->p_cdio,
-                                          CDIO_CDROM_LEADOUT_TRACK);
-                cddb_disc_set_length (pcddb_disc, FRAMES_TO_SECONDS (lba));
-
-                for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
-                {
-                    pcddb_track = cddb_track_new ();
-                    cddb_track_set_frame_offset (pcddb_track,
-                                                 cdio_get_track_lba (
-                                                     pcdrom_drive->p_cdio,
-                                                     trackno));
-                    cddb_disc_add_track (pcddb_disc, pcddb_track);
-                }
-
-                cddb_disc_calc_discid (pcddb_disc);
-
-                unsigned discid = cddb_disc_get_discid (pcddb_disc);
-                AUDDBG ("CDDB disc id = %x\n", discid);
-
-                int matches;
-                if ((matches = cddb_query (pcddb_conn, pcddb_disc)) == -1)
-                {
-                    if (cddb_errno (pcddb_conn) == CDDB_ERR_OK)
-                        cdaudio_error (_("Failed to query the CDDB server"));
-                    else
-                        cdaudio_error (_("Failed to query the CDDB server: %s"),
-                                       cddb_error_str (cddb_errno
-                                                       (pcddb_conn)));
-
-                    cddb_disc_destroy (pcddb_disc);
-                    pcddb_disc = nullptr;
-                }
-                else
-                {
-                    if (matches == 0)
-                    {
-                        AUDDBG ("no cddb info available for this disc\n");
-
-                        cddb_disc_destroy (pcddb_disc);
-                        pcddb_disc = nullptr;
-                    }
-                    else
-                    {
-                        AUDDBG ("CDDB disc category = \"%s\"\n",
-                               cddb_disc_get_category_str (pcddb_disc));
-
-                        cddb_read (pcddb_conn, pcddb_disc);
-                        if (cddb_errno (pcddb_conn) != CDDB_ERR_OK)
-                        {
-                            cdaudio_error (_("Failed to read the cddb info: %s"),
-                                           cddb_error_str (cddb_errno
-                                                           (pcddb_conn)));
-                            cddb_disc_destroy (pcddb_disc);
-                            pcddb_disc = nullptr;
-                        }
-                        else
-                        {
-                            trackinfo[0].performer = String (cddb_disc_get_artist (pcddb_disc));
-                            trackinfo[0].name = String (cddb_disc_get_title (pcddb_disc));
-                            trackinfo[0].genre = String (cddb_disc_get_genre (pcddb_disc));
-
-                            int trackno;
-                            for (trackno = firsttrackno; trackno <= lasttrackno;
-                                 trackno++)
-                            {
-                                cddb_track_t *pcddb_track =
-                                    cddb_disc_get_track (pcddb_disc,
-                                                         trackno - 1);
-
-                                trackinfo[trackno].performer = String (cddb_track_get_artist (pcddb_track));
-                                trackinfo[trackno].name = String (cddb_track_get_title (pcddb_track));
-                                trackinfo[trackno].genre = String (cddb_disc_get_genre (pcddb_disc));
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        if (pcddb_disc != nullptr)
-            cddb_disc_destroy (pcddb_disc);
-
-        if (pcddb_conn != nullptr)
-            cddb_destroy (pcddb_conn);
-    }
+    if (!cdtext_was_available && aud_get_bool ("CDDA", "use_cddb"))
+        lookup_cddb ();
 
     return true;
 }
@@ -746,7 +1052,8 @@ static bool refresh_trackinfo (bool warning)
     if (! open_cd () || ! check_disc_mode (warning))
         goto fail;
 
-    if (! trackinfo.len () || cdio_get_media_changed (pcdrom_drive->p_cdio))
+    /* images cannot change, and report an error when asked */
+    if (! trackinfo.len () || (! is_image && cdio_get_media_changed (pcdrom_drive->p_cdio)))
     {
         if (! scan_cd ())
             goto fail;
@@ -0,0 +1,339 @@
+/*
+ * Audacious CD Digital Audio plugin
+ * Local CDDB cache
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; under version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses>.
+ */
+
+/*
+ * Disc metadata is kept in the user's config directory in the same layout as
+ * a freedb dump: one xmcd file per disc, named by the disc ID and filed under
+ * its category.  Since disc IDs are only 32 bits and collide quite often, a
+ * cached entry is used only if its track offsets match the TOC exactly.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+
+#include "cddb-cache.h"
+
+static StringBuf cache_dir ()
+{
+    return filename_build ({aud_get_path (AudPath::UserDir), "cddb"});
+}
+
+static bool is_discid_name (const char * name)
+{
+    if (strlen (name) != 8)
+        return false;
+
+    for (const char * c = name; * c; c ++)
+    {
+        if (! g_ascii_isxdigit (* c))
+            return false;
+    }
+
+    return true;
+}
+
+/* undoes the \n, \t and \\ escapes of the xmcd format */
+static void append_unescaped (GString * buf, const char * value)
+{
+    for (const char * c = value; * c; c ++)
+    {
+        if (* c == '\\' && c[1])
+        {
+            c ++;
+            g_string_append_c (buf, (* c == 'n') ? '\n' : (* c == 't') ? '\t' : * c);
+        }
+        else
+            g_string_append_c (buf, * c);
+    }
+}
+
+static void append_escaped (GString * buf, const char * value)
+{
+    for (const char * c = value ? value : ""; * c; c ++)
+    {
+        if (* c == '\n')
+            g_string_append (buf, "\\n");
+        else if (* c == '\t')
+            g_string_append (buf, "\\t");
+        else if (* c == '\\')
+            g_string_append (buf, "\\\\");
+        else
+            g_string_append_c (buf, * c);
+    }
+}
+
+/* DTITLE and compilation TTITLEs are "Artist / Title" */
+static void split_title (const char * value, const char * default_performer,
+ String & performer, String & name)
+{
+    const char * sep = strstr (value, " / ");
+
+    if (sep)
+    {
+        performer = String (str_copy (value, sep - value));
+        name = String (sep + 3);
+    }
+    else
+    {
+        performer = String (default_performer);
+        name = String (value);
+    }
+}
+
+static bool parse_entry (char * data, const Index<int> & offsets, CDDBEntry & entry)
+{
+    Index<int> file_offsets;
+    bool in_offsets = false;
+
+    GString * dtitle = g_string_new (nullptr);
+    GString * dgenre = g_string_new (nullptr);
+    Index<GString *> ttitles;
+
+    for (int i = 0; i < offsets.len (); i ++)
+        ttitles.append (g_string_new (nullptr));
+
+    char * saveptr = nullptr;
+    for (char * line = strtok_r (data, "\r\n", & saveptr); line;
+         line = strtok_r (nullptr, "\r\n", & saveptr))
+    {
+        if (line[0] == '#')
+        {
+            const char * text = line + 1;
+            while (* text == ' ' || * text == '\t')
+                text ++;
+
+            if (! strncmp (text, "Track frame offsets:", 20))
+                in_offsets = true;
+            else if (in_offsets && g_ascii_isdigit (* text))
+                file_offsets.append (atoi (text));
+            else
+                in_offsets = false;
+
+            continue;
+        }
+
+        in_offsets = false;
+
+        char * value = strchr (line, '=');
+        if (! value)
+            continue;
+
+        * value ++ = 0;
+
+        /* long values are split over several lines with the same key */
+        if (! strcmp (line, "DTITLE"))
+            append_unescaped (dtitle, value);
+        else if (! strcmp (line, "DGENRE"))
+            append_unescaped (dgenre, value);
+        else if (! strncmp (line, "TTITLE", 6) && g_ascii_isdigit (line[6]))
+        {
+            int track = atoi (line + 6);
+            if (track < ttitles.len ())
+                append_unescaped (ttitles[track], value);
+        }
+    }
+
+    bool match = (file_offsets.len () == offsets.len ());
+
+    for (int i = 0; match && i < offsets.len (); i ++)
+    {
+        if (file_offsets[i] != offsets[i])
+            match = false;
+    }
+
+    if (match)
+    {
+        split_title (dtitle->str, nullptr, entry.performer, entry.name);
+        entry.genre = dgenre->len ? String (dgenre->str) : String ();
+
+        entry.tracks.clear ();
+        entry.tracks.insert (0, ttitles.len ());
+
+        for (int i = 0; i < ttitles.len (); i ++)
+            split_title (ttitles[i]->str, entry.performer,
+             entry.tracks[i].performer, entry.tracks[i].name);
+    }
+
+    g_string_free (dtitle, true);
+    g_string_free (dgenre, true);
+
+    for (GString * title : ttitles)
+        g_string_free (title, true);
+
+    return match;
+}
+
+bool cddb_cache_lookup (unsigned discid, const Index<int> & offsets, CDDBEntry & entry)
+{
+    StringBuf root = cache_dir ();
+    GDir * dir = g_dir_open (root, 0, nullptr);
+    if (! dir)
+        return false;
+
+    StringBuf name = str_printf ("%08x", discid);
+    bool found = false;
+
+    const char * category;
+    while (! found && (category = g_dir_read_name (dir)))
+    {
+        StringBuf path = filename_build ({root, category, name});
+
+        char * data;
+        if (! g_file_get_contents (path, & data, nullptr, nullptr))
+            continue;
+
+        if (parse_entry (data, offsets, entry))
+        {
+            AUDDBG ("Found disc %s in CDDB cache (%s).\n", (const char *) name, category);
+            found = true;
+        }
+
+        g_free (data);
+    }
+
+    g_dir_close (dir);
+    return found;
+}
+
+void cddb_cache_store (unsigned discid, const char * category,
+ const Index<int> & offsets, int length, const CDDBEntry & entry)
+{
+    if (! category || ! category[0] || strchr (category, G_DIR_SEPARATOR))
+        category = "misc";
+
+    StringBuf dir = filename_build ({cache_dir (), category});
+    if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+        AUDERR ("Cannot create %s.\n", (const char *) dir);
+        return;
+    }
+
+    GString * data = g_string_new ("# xmcd\n#\n# Track frame offsets:\n");
+
+    for (int offset : offsets)
+        g_string_append_printf (data, "#\t%d\n", offset);
+
+    g_string_append_printf (data, "#\n# Disc length: %d seconds\n#\n", length);
+    g_string_append_printf (data, "DISCID=%08x\n", discid);
+
+    g_string_append (data, "DTITLE=");
+    append_escaped (data, entry.performer);
+    g_string_append (data, " / ");
+    append_escaped (data, entry.name);
+
+    g_string_append (data, "\nDGENRE=");
+    append_escaped (data, entry.genre);
+    g_string_append_c (data, '\n');
+
+    for (int i = 0; i < entry.tracks.len (); i ++)
+    {
+        const CDDBTrack & track = entry.tracks[i];
+
+        g_string_append_printf (data, "TTITLE%d=", i);
+
+        /* per-track artists only for compilations */
+        if (track.performer && (! entry.performer || strcmp (track.performer, entry.performer)))
+        {
+            append_escaped (data, track.performer);
+            g_string_append (data, " / ");
+        }
+
+        append_escaped (data, track.name);
+        g_string_append_c (data, '\n');
+    }
+
+    StringBuf path = filename_build ({dir, str_printf ("%08x", discid)});
+
+    if (! g_file_set_contents (path, data->str, data->len, nullptr))
+        AUDERR ("Cannot write %s.\n", (const char *) path);
+
+    g_string_free (data, true);
+}
+
+static int import_category (const char * src, const char * dest, bool (* aborted) ())
+{
+    GDir * dir = g_dir_open (src, 0, nullptr);
+    if (! dir)
+        return 0;
+
+    int count = 0;
+
+    const char * name;
+    while ((name = g_dir_read_name (dir)) && ! aborted ())
+    {
+        if (! is_discid_name (name))
+            continue;
+
+        if (! count && g_mkdir_with_parents (dest, 0755) != 0)
+        {
+            AUDERR ("Cannot create %s.\n", dest);
+            break;
+        }
+
+        char * lower = g_ascii_strdown (name, -1);
+        StringBuf from = filename_build ({src, name});
+        StringBuf to = filename_build ({dest, lower});
+        g_free (lower);
+
+        char * data;
+        gsize len;
+
+        if (! g_file_get_contents (from, & data, & len, nullptr))
+            continue;
+
+        if (g_file_set_contents (to, data, len, nullptr))
+            count ++;
+
+        g_free (data);
+    }
+
+    g_dir_close (dir);
+    return count;
+}
+
+int cddb_cache_import (const char * path, bool (* aborted) ())
+{
+    GDir * dir = g_dir_open (path, 0, nullptr);
+    if (! dir)
+    {
+        AUDERR ("Cannot open %s.\n", path);
+        return 0;
+    }
+
+    StringBuf root = cache_dir ();
+
+    /* a single category folder is accepted as well */
+    char * base = g_path_get_basename (path);
+    int count = import_category (path, filename_build ({root, base}), aborted);
+    g_free (base);
+
+    const char * name;
+    while ((name = g_dir_read_name (dir)) && ! aborted ())
+    {
+        StringBuf sub = filename_build ({path, name});
+        if (g_file_test (sub, G_FILE_TEST_IS_DIR))
+            count += import_category (sub, filename_build ({root, name}), aborted);
+    }
+
+    g_dir_close (dir);
+    return count;
+}
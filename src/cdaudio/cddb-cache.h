@@ -0,0 +1,49 @@
+/*
+ * Audacious CD Digital Audio plugin
+ * Local CDDB cache
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; under version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses>.
+ */
+
+#ifndef CDDB_CACHE_H
+#define CDDB_CACHE_H
+
+#include <libaudcore/index.h>
+#include <libaudcore/objects.h>
+
+struct CDDBTrack
+{
+    String performer;
+    String name;
+};
+
+struct CDDBEntry
+{
+    String performer;
+    String name;
+    String genre;
+    Index<CDDBTrack> tracks;  /* in TOC order */
+};
+
+/* offsets are the track start LBAs (including the 150-frame lead-in) as used
+ * by freedb; length is the disc length in seconds */
+bool cddb_cache_lookup (unsigned discid, const Index<int> & offsets, CDDBEntry & entry);
+void cddb_cache_store (unsigned discid, const char * category,
+ const Index<int> & offsets, int length, const CDDBEntry & entry);
+
+/* copies the entries of a freedb dump (a folder with one subfolder per
+ * category) into the cache, returning the number of entries imported; stops
+ * early once aborted() returns true */
+int cddb_cache_import (const char * path, bool (* aborted) ());
+
+#endif
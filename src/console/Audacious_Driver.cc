@@ -14,9 +14,12 @@
 #include <libaudcore/runtime.h>
 
 #include "configure.h"
+#include "image_cache.h"
+#include "length_detect.h"
 #include "plugin.h"
+#include "../pcm-cache/pcm-cache.h"
 #include "Music_Emu.h"
-#include "Gzip_Reader.h"
+#include "Data_Reader.h"
 
 static const int fade_threshold = 10 * 1000;
 static const int fade_length    = 8 * 1000;
@@ -35,9 +38,9 @@ static void log_warning(Music_Emu * emu)
         AUDWARN("%s\n", str);
 }
 
-/* Handles URL parsing, file opening and identification, and file
- * loading. Keeps file header around when loading rest of file to
- * avoid seeking and re-reading.
+/* Handles URL parsing, file reading and identification, and file
+ * loading. The (inflated) file image is kept in memory between
+ * identification and loading.
  */
 class ConsoleFileHandler {
 public:
@@ -53,13 +56,15 @@ public:
     // emulator couldn't be created, returns 1.
     int load(int sample_rate);
 
-    // Deletes owned emu and closes file
+    // Adds the file image to a PCM cache key; must be called before load()
+    void add_to_key(PCMCacheKey &key) const
+        { key.add(m_data.begin(), m_data.len()); }
+
+    // Deletes owned emu
     ~ConsoleFileHandler();
 
 private:
-    char m_header[4];
-    Vfs_File_Reader vfs_in;
-    Gzip_Reader gzip_in;
+    Index<char> m_data;
 };
 
 ConsoleFileHandler::ConsoleFileHandler(const char *path, VFSFile &fd)
@@ -74,17 +79,14 @@ ConsoleFileHandler::ConsoleFileHandler(const char *path, VFSFile &fd)
 
     m_track -= 1;
 
-    // open vfs
-    vfs_in.reset(fd);
-
-    // now open gzip_reader on top of vfs
-    if (log_err(gzip_in.open(&vfs_in)))
+    // read whole file, inflating VGZ and the like
+    if (!image_cache_read(fd, m_data))
         return;
 
-    // read and identify header
-    if (!log_err(gzip_in.read(m_header, sizeof(m_header))))
+    // identify header
+    if (m_data.len() >= 4)
     {
-        m_type = gme_identify_extension(gme_identify_header(m_header));
+        m_type = gme_identify_extension(gme_identify_header(m_data.begin()));
         if (!m_type)
         {
             m_type = gme_identify_extension(m_path);
@@ -111,14 +113,12 @@ int ConsoleFileHandler::load(int sample_rate)
         return 1;
     }
 
-    // combine header with remaining file data
-    Remaining_Reader reader(m_header, sizeof(m_header), &gzip_in);
+    // the emulator keeps its own copy of the data
+    Mem_File_Reader reader(m_data.begin(), m_data.len());
     if (log_err(m_emu->load(reader)))
         return 1;
 
-    // files can be closed now
-    gzip_in.close();
-    vfs_in.close();
+    m_data.clear();
 
     log_warning(m_emu);
 
@@ -172,6 +172,16 @@ bool ConsolePlugin::read_tag(const char *filename, VFSFile &file, Tuple &tuple,
     if (log_err(fh.m_emu->track_info(&info, fh.m_track < 0 ? 0 : fh.m_track)))
         return false;
 
+    if (audcfg.detect_length && info.length <= 0 && info.loop_length <= 0)
+    {
+        // a file with subtunes is read first as a whole; start on all of them
+        if (fh.m_track < 0 && info.track_count > 1)
+            length_detect_queue(fh.m_path, fh.m_type, info.track_count);
+        else
+            length_detect_get(fh.m_path, fh.m_type, fh.m_track < 0 ? 0 : fh.m_track,
+             info.track_count, true, info);
+    }
+
     auto set_str = [&tuple](Tuple::Field f, const char *s)
         { if (s[0]) tuple.set_str(f, s); };
 
@@ -218,6 +228,16 @@ bool ConsolePlugin::play(const char *filename, VFSFile &file)
     if (sample_rate == 0)
         sample_rate = 44100;
 
+    // the rendered track depends on the file and the settings below
+    PCMCacheKey key;
+    bool key_valid = pcm_cache_enabled();
+
+    if (key_valid)
+    {
+        key.add("console");
+        fh.add_to_key(key);
+    }
+
     // create emulator and load file
     if (fh.load(sample_rate))
         return false;
@@ -248,10 +268,54 @@ bool ConsolePlugin::play(const char *filename, VFSFile &file)
         if (fh.m_type == gme_spc_type && audcfg.ignore_spc_length)
             info.length = -1;
 
+        if (audcfg.detect_length && info.length <= 0 && info.loop_length <= 0)
+            length_detect_get(fh.m_path, fh.m_type, fh.m_track, info.track_count, false, info);
+
         length = get_track_length(info);
         set_stream_bitrate(fh.m_emu->voice_count() * 1000);
     }
 
+    // fade time
+    if (length <= 0)
+        length = audcfg.loop_length * 1000;
+    if (length >= fade_threshold + fade_length)
+        length -= fade_length / 2;
+
+    // look up the rendered track
+    PCMCacheReader cache;
+    PCMCacheWriter writer;
+
+    if (key_valid)
+    {
+        key.add(fh.m_track);
+        key.add(sample_rate);
+        key.add(audcfg.echo);
+        key.add(audcfg.treble);
+        key.add(audcfg.bass);
+        key.add(length);
+
+        if (cache.open(key, sample_rate, 2))
+        {
+            open_audio(FMT_S16_NE, sample_rate, 2);
+
+            while (!check_stop())
+            {
+                int seek_value = check_seek();
+                if (seek_value >= 0)
+                    cache.seek(seek_value);
+
+                Music_Emu::sample_t buf[1024];
+                int bytes = cache.read(buf, sizeof(buf));
+                if (!bytes)
+                    break;
+
+                write_audio(buf, bytes);
+            }
+
+            return true;
+        }
+    }
+
     // start track
     if (log_err(fh.m_emu->start_track(fh.m_track)))
         return false;
@@ -260,19 +324,20 @@ bool ConsolePlugin::play(const char *filename, VFSFile &file)
 
     open_audio(FMT_S16_NE, sample_rate, 2);
 
-    // set fade time
-    if (length <= 0)
-        length = audcfg.loop_length * 1000;
-    if (length >= fade_threshold + fade_length)
-        length -= fade_length / 2;
     fh.m_emu->set_fade(length, fade_length);
 
+    if (key_valid)
+        writer.open(key, sample_rate, 2);
+
     while (!check_stop())
     {
         /* Perform seek, if requested */
         int seek_value = check_seek();
         if (seek_value >= 0)
+        {
             fh.m_emu->seek(seek_value);
+            writer.abandon();
+        }
 
         /* Fill and play buffer of audio */
         int const buf_size = 1024;
@@ -281,9 +346,13 @@ bool ConsolePlugin::play(const char *filename, VFSFile &file)
         fh.m_emu->play(buf_size, buf);
 
         write_audio(buf, sizeof(buf));
+        writer.write(buf, sizeof(buf));
 
         if (fh.m_emu->track_ended())
+        {
+            writer.commit();
             break;
+        }
     }
 
     return true;
@@ -287,6 +287,7 @@ void Ay_Emu::cpu_out_misc( cpu_time_t time, unsigned addr, int data )
 
 		case 0xBEFD:
 			spectrum_mode = true;
+			GME_APU_HOOK( this, apu_addr, data );
 			apu.write( time, apu_addr, data );
 			return;
 		}
@@ -304,6 +305,7 @@ void Ay_Emu::cpu_out_misc( cpu_time_t time, unsigned addr, int data )
 				goto enable_cpc;
 
 			case 0x80:
+				GME_APU_HOOK( this, apu_addr, cpc_latch );
 				apu.write( time, apu_addr, cpc_latch );
 				goto enable_cpc;
 			}
@@ -115,7 +115,7 @@ public:
 };
 
 #ifndef GME_APU_HOOK
-	#define GME_APU_HOOK( emu, addr, data ) ((void) 0)
+	#define GME_APU_HOOK( emu, addr, data ) ((emu)->log_apu_write( addr, data ))
 #endif
 
 #ifndef GME_FRAME_HOOK
@@ -52,8 +52,9 @@ static void gen_sinc( double rolloff, int width, double offset, double spacing,
 	}
 }
 
-Fir_Resampler_::Fir_Resampler_( int width, sample_t* impulses_ ) :
+Fir_Resampler_::Fir_Resampler_( int width, int stride, sample_t* impulses_ ) :
 	width_( width ),
+	stride_( stride ),
 	write_offset( width * stereo - stereo ),
 	impulses( impulses_ )
 {
@@ -74,12 +75,13 @@ void Fir_Resampler_::clear()
 	{
 		write_pos = &buf [write_offset];
 		memset( buf.begin(), 0, write_offset * sizeof buf [0] );
+		memset( buf.end() - pad_size(), 0, pad_size() * sizeof buf [0] );
 	}
 }
 
 blargg_err_t Fir_Resampler_::buffer_size( int new_size )
 {
-	RETURN_ERR( buf.resize( new_size + write_offset ) );
+	RETURN_ERR( buf.resize( new_size + write_offset + pad_size() ) );
 	clear();
 	return 0;
 }
@@ -121,7 +123,8 @@ double Fir_Resampler_::time_ratio( double new_factor, double rolloff, double gai
 	{
 		gen_sinc( rolloff, int (width_ * filter + 1) & ~1, pos, filter,
 				double (0x7FFF * gain * filter),
-				(int) width_, impulses + i * width_ );
+				(int) width_, impulses + i * stride_ );
+		memset( impulses + i * stride_ + width_, 0, (stride_ - width_) * sizeof *impulses );
 
 		pos += fstep;
 		input_per_cycle += step;
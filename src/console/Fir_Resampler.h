@@ -31,7 +31,7 @@ public:
 	void clear();
 
 	// Number of input samples that can be written
-	int max_write() const { return buf.end() - write_pos; }
+	int max_write() const { return buf.end() - pad_size() - write_pos; }
 
 	// Pointer to place to write input samples
 	sample_t* buffer() { return write_pos; }
@@ -63,6 +63,7 @@ protected:
 	int res;
 	int imp_phase;
 	int const width_;
+	int const stride_; // width_ rounded up to a multiple of 8
 	int const write_offset;
 	blargg_ulong skip_bits;
 	int step;
@@ -70,8 +71,11 @@ protected:
 	double ratio_;
 	sample_t* impulses;
 
-	Fir_Resampler_( int width, sample_t* );
+	Fir_Resampler_( int width, int stride, sample_t* );
 	int avail_( blargg_long input_count ) const;
+
+	// read() runs past the end of the input by this many (zero-weighted) samples
+	int pad_size() const { return (stride_ - width_) * stereo; }
 };
 
 // Width is number of points in FIR. Must be even and 4 or more. More points give
@@ -79,9 +83,13 @@ protected:
 template<int width>
 class Fir_Resampler : public Fir_Resampler_ {
 	BOOST_STATIC_ASSERT( width >= 4 && width % 2 == 0 );
-	short impulses [max_res] [width];
+	// Impulses are padded with zeroes to a multiple of 8 points, so that the
+	// inner loop of read() has a trip count compilers can vectorize into
+	// packed multiply-adds (PMADDWD on x86, SMLAL on ARM).
+	enum { stride = (width + 7) & ~7 };
+	short impulses [max_res] [stride];
 public:
-	Fir_Resampler() : Fir_Resampler_( width, impulses [0] ) { }
+	Fir_Resampler() : Fir_Resampler_( width, stride, impulses [0] ) { }
 
 	// Read at most 'count' samples. Returns number of samples actually read.
 	typedef short sample_t;
@@ -93,7 +101,7 @@ public:
 inline void Fir_Resampler_::write( long count )
 {
 	write_pos += count;
-	assert( write_pos <= buf.end() );
+	assert( write_pos <= buf.end() - pad_size() );
 }
 
 template<int width>
@@ -124,17 +132,12 @@ int Fir_Resampler<width>::read( sample_t* out_begin, blargg_long count )
 			if ( count < 0 )
 				break;
 
-			for ( int n = width / 2; n; --n )
+			for ( int n = 0; n < stride; n++ )
 			{
-				int pt0 = imp [0];
-				l += pt0 * i [0];
-				r += pt0 * i [1];
-				int pt1 = imp [1];
-				imp += 2;
-				l += pt1 * i [2];
-				r += pt1 * i [3];
-				i += 4;
+				l += imp [n] * i [n * 2];
+				r += imp [n] * i [n * 2 + 1];
 			}
+			imp += stride;
 
 			remain--;
 
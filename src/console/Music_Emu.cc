@@ -51,6 +51,8 @@ void Music_Emu::unload()
 Music_Emu::Music_Emu()
 {
 	effects_buffer = 0;
+	apu_log_func   = 0;
+	apu_log_data   = 0;
 
 	sample_rate_ = 0;
 	mute_mask_   = 0;
@@ -298,7 +300,7 @@ void Music_Emu::emu_play( long count, sample_t* out )
 }
 
 // number of consecutive silent samples at end
-static long count_silence( Music_Emu::sample_t* begin, long size )
+long Music_Emu::count_silence( sample_t* begin, long size )
 {
 	Music_Emu::sample_t first = *begin;
 	*begin = silence_threshold; // sentinel
@@ -61,6 +61,20 @@ public:
 	using Gme_File::track_info;
 	blargg_err_t track_info( track_info_t* out ) const;
 
+	// Number of consecutive silent samples at end of buffer
+	static long count_silence( sample_t* begin, long size );
+
+// Sound chip register logging
+
+	// Call func( data, addr, value ) for every sound chip register write, or
+	// stop if func is NULL. Supported by the chip-based emulators (AY, GBS,
+	// HES, KSS, NSF, SAP, SPC); others never call it.
+	typedef void (*apu_log_func_t)( void* data, int addr, int value );
+	void set_apu_log( apu_log_func_t func, void* data );
+
+	// Used by emulators to report a register write
+	void log_apu_write( int addr, int value );
+
 // Sound customization
 
 	// Adjust song tempo, where 1.0 = normal, 0.5 = half speed, 2.0 = double speed.
@@ -165,6 +179,8 @@ private:
 	void emu_play( long count, sample_t* out );
 
 	Multi_Buffer* effects_buffer;
+	apu_log_func_t apu_log_func;
+	void* apu_log_data;
 	friend Music_Emu* gme_new_emu( gme_type_t, int );
 	friend void gme_set_stereo_depth( Music_Emu*, double );
 };
@@ -199,6 +215,18 @@ inline void Music_Emu::enable_accuracy( bool b )    { enable_accuracy_( b ); }
 inline void Music_Emu::set_tempo_( double t )       { tempo_ = t; }
 inline void Music_Emu::remute_voices()              { mute_voices( mute_mask_ ); }
 inline void Music_Emu::ignore_silence( bool b )     { ignore_silence_ = b; }
+
+inline void Music_Emu::set_apu_log( apu_log_func_t func, void* data )
+{
+	apu_log_func = func;
+	apu_log_data = data;
+}
+
+inline void Music_Emu::log_apu_write( int addr, int value )
+{
+	if ( apu_log_func )
+		apu_log_func( apu_log_data, addr, value );
+}
 inline blargg_err_t Music_Emu::start_track_( int )  { return 0; }
 
 inline void Music_Emu::set_voice_names( const char* const* names )
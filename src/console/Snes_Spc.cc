@@ -34,6 +34,9 @@ blargg_err_t Snes_Spc::init()
 	memset( &m, 0, sizeof m );
 	dsp.init( RAM );
 
+	dsp_write_hook = 0;
+	dsp_write_hook_data = 0;
+
 	m.tempo = tempo_unit;
 
 	// Most SPC music doesn't need ROM, and almost all the rest only rely
@@ -119,6 +119,14 @@ public:
 
 	void run_until( time_t t ) { run_until_( t ); }
 
+	// Called as hook( data, addr, value ) for every DSP register write
+	typedef void (*dsp_write_hook_t)( void* data, int addr, int value );
+	void set_dsp_write_hook( dsp_write_hook_t hook, void* data )
+	{
+		dsp_write_hook = hook;
+		dsp_write_hook_data = data;
+	}
+
 	// Time relative to m_spc_time. Speeds up code a bit by eliminating need to
 	// constantly add m_spc_time to time from CPU. CPU uses time that ends at
 	// 0 to eliminate reloading end time every instruction. It pays off.
@@ -142,6 +150,9 @@ public:
 private:
 	Spc_Dsp dsp;
 
+	dsp_write_hook_t dsp_write_hook;
+	void* dsp_write_hook_data;
+
 	#if SPC_LESS_ACCURATE
 		static signed char const reg_times_ [256];
 		signed char reg_times [256];
@@ -173,6 +173,9 @@ inline void Snes_Spc::dsp_write( int data, rel_time_t time )
 		SPC_DSP_WRITE_HOOK( m.spc_time + time, REGS [r_dspaddr], (uint8_t) data );
 	#endif
 
+	if ( dsp_write_hook )
+		dsp_write_hook( dsp_write_hook_data, REGS [r_dspaddr], (uint8_t) data );
+
 	if ( REGS [r_dspaddr] <= 0x7F )
 		dsp.write( REGS [r_dspaddr], data );
 	else if ( !SPC_MORE_ACCURACY )
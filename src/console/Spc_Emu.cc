@@ -249,9 +249,15 @@ gme_type_t const gme_spc_type = &gme_spc_type_;
 
 // Setup
 
+static void log_dsp_write( void* emu, int addr, int value )
+{
+	STATIC_CAST(Spc_Emu*,emu)->log_apu_write( addr, value );
+}
+
 blargg_err_t Spc_Emu::set_sample_rate_( long sample_rate )
 {
 	RETURN_ERR( apu.init() );
+	apu.set_dsp_write_hook( log_dsp_write, this );
 	enable_accuracy( false );
 	if ( sample_rate != native_sample_rate )
 	{
@@ -9,7 +9,10 @@
  */
 
 #include "configure.h"
+#include "image_cache.h"
+#include "length_detect.h"
 #include "plugin.h"
+#include "../pcm-cache/pcm-cache.h"
 
 #include <libaudcore/runtime.h>
 
@@ -26,11 +29,13 @@ const char * const ConsolePlugin::defaults[] = {
  "ignore_spc_length", "FALSE",
  "echo", "0",
  "inc_spc_reverb", "FALSE",
+ "detect_length", "TRUE",
  nullptr};
 
 bool ConsolePlugin::init ()
 {
     aud_config_set_defaults (CON_CFGID, defaults);
+    pcm_cache_init ();
 
     audcfg.loop_length = aud_get_int (CON_CFGID, "loop_length");
     audcfg.resample = aud_get_bool (CON_CFGID, "resample");
@@ -40,6 +45,7 @@ bool ConsolePlugin::init ()
     audcfg.ignore_spc_length = aud_get_bool (CON_CFGID, "ignore_spc_length");
     audcfg.echo = aud_get_int (CON_CFGID, "echo");
     audcfg.inc_spc_reverb = aud_get_bool (CON_CFGID, "inc_spc_reverb");
+    audcfg.detect_length = aud_get_bool (CON_CFGID, "detect_length");
 
     return true;
 }
@@ -54,4 +60,8 @@ void ConsolePlugin::cleanup ()
     aud_set_bool (CON_CFGID, "ignore_spc_length", audcfg.ignore_spc_length);
     aud_set_int (CON_CFGID, "echo", audcfg.echo);
     aud_set_bool (CON_CFGID, "inc_spc_reverb", audcfg.inc_spc_reverb);
+    aud_set_bool (CON_CFGID, "detect_length", audcfg.detect_length);
+
+    length_detect_cleanup ();
+    image_cache_cleanup ();
 }
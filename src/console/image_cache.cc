@@ -0,0 +1,160 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2005-2009 Audacious Team
+ *
+ * Driver for Game_Music_Emu library. See details at:
+ * http://www.slack.net/~ant/libs/
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <libaudcore/runtime.h>
+#include <libaudcore/vfs.h>
+
+#include "image_cache.h"
+#include "Gzip_Reader.h"
+
+static const int max_images   = 16;
+static const long max_bytes   = 32 << 20; // total size of inflated images
+
+// images are identified by their compressed contents
+struct CachedImage
+{
+    uint64_t hash;
+    long raw_size;
+    Index<char> data;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* lock mutex to read / set these variables */
+static Index<CachedImage> images; // least recently used first
+static long total_bytes;
+
+static uint64_t hash_data(const Index<char> &data)
+{
+    uint64_t hash = 0xcbf29ce484222325; // FNV-1a
+    for (char c : data)
+        hash = (hash ^ (unsigned char) c) * 0x100000001b3;
+
+    return hash;
+}
+
+static bool is_gzip(const Index<char> &raw)
+{
+    return raw.len() >= 18 && (unsigned char) raw[0] == 0x1f &&
+     (unsigned char) raw[1] == 0x8b;
+}
+
+static bool inflate(const Index<char> &raw, Index<char> &data)
+{
+    Mem_File_Reader in(raw.begin(), raw.len());
+    Gzip_Reader gzip;
+
+    blargg_err_t err = gzip.open(&in);
+    long size = err ? 0 : gzip.remain();
+
+    if (!err && size > 0)
+    {
+        data.insert(0, size);
+        err = gzip.read(data.begin(), size);
+    }
+
+    if (err || size <= 0)
+    {
+        AUDERR("%s\n", err ? err : "Corrupt gzip file");
+        data.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/* mutex must be locked */
+static int find(uint64_t hash, long raw_size)
+{
+    for (int i = images.len() - 1; i >= 0; i--)
+    {
+        if (images[i].hash == hash && images[i].raw_size == raw_size)
+            return i;
+    }
+
+    return -1;
+}
+
+/* mutex must be locked */
+static bool lookup(uint64_t hash, long raw_size, Index<char> &data)
+{
+    int i = find(hash, raw_size);
+    if (i < 0)
+        return false;
+
+    // move it to the most recently used end
+    CachedImage image = std::move(images[i]);
+    images.remove(i, 1);
+
+    data.insert(image.data.begin(), 0, image.data.len());
+    images.append(std::move(image));
+    return true;
+}
+
+/* mutex must be locked */
+static void add(uint64_t hash, long raw_size, const Index<char> &data)
+{
+    if (data.len() > max_bytes)
+        return;
+
+    while (images.len() && (images.len() >= max_images ||
+     total_bytes + data.len() > max_bytes))
+    {
+        total_bytes -= images[0].data.len();
+        images.remove(0, 1);
+    }
+
+    CachedImage &image = images.append();
+    image.hash = hash;
+    image.raw_size = raw_size;
+    image.data.insert(data.begin(), 0, data.len());
+    total_bytes += data.len();
+}
+
+bool image_cache_read(VFSFile &file, Index<char> &data)
+{
+    Index<char> raw = file.read_all();
+
+    if (!is_gzip(raw))
+    {
+        data = std::move(raw);
+        return data.len() > 0;
+    }
+
+    uint64_t hash = hash_data(raw);
+
+    pthread_mutex_lock(&mutex);
+    bool found = lookup(hash, raw.len(), data);
+    pthread_mutex_unlock(&mutex);
+
+    if (found)
+        return true;
+
+    // inflate without holding the lock; another thread may race us to it
+    if (!inflate(raw, data))
+        return false;
+
+    pthread_mutex_lock(&mutex);
+
+    if (find(hash, raw.len()) < 0)
+        add(hash, raw.len(), data);
+
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+void image_cache_cleanup()
+{
+    pthread_mutex_lock(&mutex);
+    images.clear();
+    total_bytes = 0;
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,26 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2005-2009 Audacious Team
+ *
+ * Driver for Game_Music_Emu library. See details at:
+ * http://www.slack.net/~ant/libs/
+ */
+
+#ifndef CONSOLE_IMAGE_CACHE_H
+#define CONSOLE_IMAGE_CACHE_H
+
+#include <libaudcore/index.h>
+
+class VFSFile;
+
+// Reads the rest of a file into memory, inflating it if it is gzipped (VGZ
+// and other compressed rips).  Inflated images are kept in a small LRU cache
+// shared by tag reading, playback and length detection, so that a file with
+// many subtunes is inflated only once.  Returns false on a read error or a
+// corrupt gzip stream.
+bool image_cache_read(VFSFile &file, Index<char> &data);
+
+// Frees all cached images.
+void image_cache_cleanup();
+
+#endif // CONSOLE_IMAGE_CACHE_H
@@ -0,0 +1,576 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2005-2009 Audacious Team
+ *
+ * Driver for Game_Music_Emu library. See details at:
+ * http://www.slack.net/~ant/libs/
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/index.h>
+#include <libaudcore/multihash.h>
+#include <libaudcore/runtime.h>
+#include <libaudcore/vfs.h>
+
+#include "image_cache.h"
+#include "length_detect.h"
+#include "Music_Emu.h"
+
+static const int max_workers    = 8;
+static const int max_seconds    = 6 * 60;   // give up after this much audio
+static const int silence_length = 6 * 1000; // same as Music_Emu
+static const int min_loop       = 3 * 1000; // shorter repeats are held notes
+static const int block_size     = 2048;     // samples (stereo)
+static const int max_wait       = 10;       // seconds a tag reader waits
+
+// loop detection works on windows of this many register writes
+static const int window_size    = 64;
+static const int window_step    = 8;        // remember every n-th window
+static const int short_period   = 128;      // windows repeating faster are ignored
+static const int max_writes     = 1 << 18;  // 1 MB per detector
+
+struct TrackKey
+{
+    uint64_t file_hash;
+    int track;
+
+    bool operator==(const TrackKey &b) const
+        { return file_hash == b.file_hash && track == b.track; }
+    unsigned hash() const
+        { return (unsigned) (file_hash ^ (file_hash >> 32)) + track * 0x9e3779b9u; }
+};
+
+struct TrackLength
+{
+    int length, intro, loop; // milliseconds, -1 if unknown
+};
+
+struct WindowKey
+{
+    uint64_t value;
+
+    bool operator==(const WindowKey &b) const
+        { return value == b.value; }
+    unsigned hash() const
+        { return (unsigned) (value ^ (value >> 32)); }
+};
+
+// file data shared by all jobs for the same file
+struct DetectFile
+{
+    uint64_t hash;
+    gme_type_t type;
+    Index<char> data;
+    int refs;
+};
+
+struct Job
+{
+    DetectFile *file;
+    int track;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/* lock mutex to read / set these variables */
+static bool cache_loaded, quit;
+static SimpleHash<TrackKey, TrackLength> results;
+static SimpleHash<TrackKey, bool> pending; // queued or running
+static Index<Job> queue;
+static Index<pthread_t> workers;
+
+static StringBuf cache_path()
+{
+    return filename_build({aud_get_path(AudPath::UserDir), "console-lengths"});
+}
+
+static void write_result(FILE *handle, const TrackKey &key, const TrackLength &length)
+{
+    fprintf(handle, "%016llx %d %d %d %d\n", (unsigned long long) key.file_hash,
+     key.track, length.length, length.intro, length.loop);
+}
+
+/* mutex must be locked */
+static void rewrite_cache()
+{
+    StringBuf path = cache_path();
+    StringBuf temp = str_concat({path, ".tmp"});
+
+    FILE *handle = fopen(temp, "w");
+    if (!handle)
+        return;
+
+    results.iterate([handle](const TrackKey &key, TrackLength &length)
+        { write_result(handle, key, length); });
+
+    if (fclose(handle) || rename(temp, path))
+        unlink(temp);
+}
+
+/* mutex must be locked */
+static void load_cache()
+{
+    cache_loaded = true;
+
+    FILE *handle = fopen(cache_path(), "r");
+    if (!handle)
+        return;
+
+    unsigned long long file_hash;
+    int track, lines = 0;
+    TrackLength length;
+
+    // a later line for the same track replaces an earlier one
+    while (fscanf(handle, "%llx %d %d %d %d", &file_hash, &track,
+     &length.length, &length.intro, &length.loop) == 5)
+    {
+        results.add({(uint64_t) file_hash, track}, std::move(length));
+        lines++;
+    }
+
+    fclose(handle);
+
+    // results are appended as they come, so compact the file now and then
+    if (lines > results.n_items())
+        rewrite_cache();
+}
+
+/* mutex must be locked */
+static void save_result(const TrackKey &key, const TrackLength &length)
+{
+    FILE *handle = fopen(cache_path(), "a");
+    if (!handle)
+        return;
+
+    write_result(handle, key, length);
+    fclose(handle);
+}
+
+static uint64_t hash_data(const Index<char> &data)
+{
+    uint64_t hash = 0xcbf29ce484222325; // FNV-1a
+    for (char c : data)
+        hash = (hash ^ (unsigned char) c) * 0x100000001b3;
+
+    return hash;
+}
+
+static bool aborted()
+{
+    pthread_mutex_lock(&mutex);
+    bool abort = quit;
+    pthread_mutex_unlock(&mutex);
+    return abort;
+}
+
+/* Looks for the point where the stream of sound chip register writes starts
+ * repeating itself.  Every window_step-th window of writes is remembered by
+ * its hash; when a later window matches one, the writes in between are a
+ * candidate loop, which is confirmed once it has played through once more. */
+class LoopDetector
+{
+public:
+    LoopDetector()
+    {
+        for (int i = 0; i < window_size; i++)
+            power *= hash_base;
+    }
+
+    static void log_write(void *data, int addr, int value)
+        { ((LoopDetector *) data)->add_write(addr, value); }
+
+    void set_time(int ms)
+    {
+        if (blocks.len() && blocks[blocks.len() - 1].first_write == writes.len())
+            blocks[blocks.len() - 1].time = ms;
+        else
+            blocks.append(Block{writes.len(), ms});
+    }
+
+    // returns true if a loop has been confirmed
+    bool found(int &intro, int &loop) const
+    {
+        if (!confirmed)
+            return false;
+
+        intro = time_of(cand_start - window_size + 1);
+        loop = time_of(cand_start + cand_period) - time_of(cand_start);
+        return true;
+    }
+
+private:
+    static const uint64_t hash_base = 0x100000001b3;
+
+    // the writes made in each block of audio share its time
+    struct Block
+    {
+        int first_write, time;
+    };
+
+    Index<uint32_t> writes;
+    Index<Block> blocks;
+    SimpleHash<WindowKey, int> windows;
+    uint64_t recent[short_period] {};
+    uint64_t window_hash = 0, power = 1;
+
+    int cand_start = -1, cand_period = 0;
+    bool confirmed = false;
+
+    int time_of(int pos) const
+    {
+        if (!blocks.len())
+            return 0;
+
+        // the last block starting at or before pos
+        int lo = 0, hi = blocks.len() - 1;
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) / 2;
+            if (blocks[mid].first_write <= pos)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        return blocks[lo].time;
+    }
+
+    bool same_window(int a, int b) const
+    {
+        for (int i = 0; i < window_size; i++)
+        {
+            if (writes[a - i] != writes[b - i])
+                return false;
+        }
+        return true;
+    }
+
+    void add_write(int addr, int value)
+    {
+        int pos = writes.len();
+        if (confirmed || pos >= max_writes)
+            return;
+
+        uint32_t token = ((uint32_t) addr << 8 | (value & 0xff)) + 1;
+        writes.append(token);
+
+        window_hash = window_hash * hash_base + token;
+        if (pos >= window_size)
+            window_hash -= writes[pos - window_size] * power;
+        else if (pos < window_size - 1)
+            return;
+
+        uint64_t hash = window_hash;
+        bool periodic = false;
+
+        for (uint64_t prev : recent)
+        {
+            if (prev == hash)
+                periodic = true;
+        }
+
+        recent[pos % short_period] = hash;
+
+        if (cand_start >= 0)
+        {
+            // the candidate holds as long as every write repeats
+            if (token != writes[pos - cand_period])
+                cand_start = -1;
+            else if (pos >= cand_start + 2 * cand_period)
+                confirmed = true;
+
+            return;
+        }
+
+        if (periodic)
+            return;
+
+        int *first = windows.lookup({hash});
+
+        if (first && time_of(pos) - time_of(*first) >= min_loop && same_window(*first, pos))
+        {
+            cand_start = *first;
+            cand_period = pos - *first;
+        }
+        else if (!first && pos % window_step == 0)
+            windows.add({hash}, std::move(pos));
+    }
+};
+
+static int samples_to_ms(long samples, long rate)
+{
+    return (int64_t) samples * 500 / rate; // stereo
+}
+
+static TrackLength detect(DetectFile *file, int track, bool &abort)
+{
+    TrackLength result = {-1, -1, -1};
+    long rate = (file->type == gme_spc_type) ? 32000 : 22050;
+
+    Music_Emu *emu = gme_new_emu(file->type, rate);
+    if (!emu)
+        return result;
+
+    LoopDetector loop;
+    Music_Emu::sample_t buf[block_size];
+
+    long played = 0, silent = 0; // stereo samples
+    bool sound = false;
+
+    if (emu->load_mem(file->data.begin(), file->data.len()) ||
+     emu->start_track(track))
+        goto DONE;
+
+    // silence is handled below, without looking ahead
+    emu->ignore_silence();
+    emu->set_apu_log(LoopDetector::log_write, &loop);
+
+    while (played < max_seconds * 2 * rate)
+    {
+        if ((abort = aborted()))
+            break;
+
+        loop.set_time(samples_to_ms(played, rate));
+
+        if (emu->play(block_size, buf))
+            break;
+
+        played += block_size;
+
+        long count = Music_Emu::count_silence(buf, block_size);
+        if (count < block_size)
+        {
+            silent = count;
+            sound = true;
+        }
+        else
+            silent += block_size;
+
+        if (sound && (samples_to_ms(silent, rate) >= silence_length || emu->track_ended()))
+        {
+            result.length = samples_to_ms(played - silent, rate);
+            break;
+        }
+
+        if (loop.found(result.intro, result.loop))
+            break;
+
+        if (emu->track_ended())
+            break;
+    }
+
+DONE:
+    gme_delete(emu);
+    return result;
+}
+
+static void *worker(void *)
+{
+    pthread_mutex_lock(&mutex);
+
+    while (!quit)
+    {
+        if (!queue.len())
+        {
+            pthread_cond_wait(&work_cond, &mutex);
+            continue;
+        }
+
+        Job job = queue[0];
+        queue.remove(0, 1);
+
+        pthread_mutex_unlock(&mutex);
+
+        bool abort = false;
+        TrackLength length = detect(job.file, job.track, abort);
+
+        pthread_mutex_lock(&mutex);
+
+        TrackKey key = {job.file->hash, job.track};
+        pending.remove(key);
+
+        if (!abort)
+        {
+            AUDDBG("Track %d: length %d, intro %d, loop %d.\n", job.track + 1,
+             length.length, length.intro, length.loop);
+
+            save_result(key, length);
+            results.add(key, std::move(length));
+        }
+
+        if (!--job.file->refs)
+            delete job.file;
+
+        pthread_cond_broadcast(&done_cond);
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return nullptr;
+}
+
+/* mutex must be locked */
+static void queue_tracks(uint64_t hash, gme_type_t type, Index<char> &data,
+ int first, int count, bool urgent)
+{
+    DetectFile *file = nullptr;
+
+    for (int track = first; track < first + count; track++)
+    {
+        TrackKey key = {hash, track};
+
+        if (results.lookup(key))
+            continue;
+
+        if (pending.lookup(key))
+        {
+            // move it to the front if someone is waiting for it
+            for (int i = 0; urgent && i < queue.len(); i++)
+            {
+                if (queue[i].file->hash == hash && queue[i].track == track)
+                {
+                    Job job = queue[i];
+                    queue.remove(i, 1);
+                    queue.insert(&job, 0, 1);
+                    break;
+                }
+            }
+
+            continue;
+        }
+
+        if (!file)
+            file = new DetectFile{hash, type, std::move(data), 0};
+
+        Job job = {file, track};
+        queue.insert(&job, urgent ? 0 : -1, 1);
+        pending.add(key, true);
+        file->refs++;
+    }
+
+    if (!file)
+        return;
+
+    int n_workers = aud::min(max_workers, (int) sysconf(_SC_NPROCESSORS_ONLN));
+
+    while (workers.len() < aud::max(n_workers, 1) && workers.len() < queue.len())
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, worker, nullptr))
+            break;
+
+        workers.append(thread);
+    }
+
+    pthread_cond_broadcast(&work_cond);
+}
+
+static bool read_file(const char *path, Index<char> &data, uint64_t &hash)
+{
+    VFSFile file(path, "r");
+    if (!file || !image_cache_read(file, data))
+        return false;
+
+    hash = hash_data(data);
+    return true;
+}
+
+void length_detect_queue(const char *path, gme_type_t type, int track_count)
+{
+    Index<char> data;
+    uint64_t hash;
+
+    if (!read_file(path, data, hash))
+        return;
+
+    pthread_mutex_lock(&mutex);
+
+    if (!cache_loaded)
+        load_cache();
+
+    queue_tracks(hash, type, data, 0, track_count, false);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void length_detect_get(const char *path, gme_type_t type, int track,
+    int track_count, bool wait, track_info_t &info)
+{
+    Index<char> data;
+    uint64_t hash;
+
+    if (track < 0 || track >= track_count || !read_file(path, data, hash))
+        return;
+
+    TrackKey key = {hash, track};
+
+    pthread_mutex_lock(&mutex);
+
+    if (!cache_loaded)
+        load_cache();
+
+    TrackLength *length = results.lookup(key);
+
+    if (!length && wait)
+    {
+        queue_tracks(hash, type, data, track, 1, true);
+
+        // the result is cached when it comes later; until then the caller
+        // falls back to its default length
+        timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += max_wait;
+
+        while (!(length = results.lookup(key)) && !quit && workers.len())
+        {
+            if (pthread_cond_timedwait(&done_cond, &mutex, &until))
+                break;
+        }
+    }
+
+    if (length)
+    {
+        if (length->length > 0)
+            info.length = length->length;
+        if (length->loop > 0)
+        {
+            info.intro_length = length->intro;
+            info.loop_length = length->loop;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void length_detect_cleanup()
+{
+    pthread_mutex_lock(&mutex);
+    quit = true;
+    pthread_cond_broadcast(&work_cond);
+    pthread_cond_broadcast(&done_cond);
+    pthread_mutex_unlock(&mutex);
+
+    for (pthread_t thread : workers)
+        pthread_join(thread, nullptr);
+
+    workers.clear();
+
+    for (Job &job : queue)
+    {
+        if (!--job.file->refs)
+            delete job.file;
+    }
+
+    queue.clear();
+    pending.clear();
+    results.clear();
+    cache_loaded = false;
+    quit = false;
+}
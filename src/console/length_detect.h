@@ -0,0 +1,33 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2005-2009 Audacious Team
+ *
+ * Driver for Game_Music_Emu library. See details at:
+ * http://www.slack.net/~ant/libs/
+ */
+
+#ifndef CONSOLE_LENGTH_DETECT_H
+#define CONSOLE_LENGTH_DETECT_H
+
+#include "gme.h"
+#include "Gme_File.h"
+
+// Finds the length of tracks that come without timing information by
+// emulating them headless, faster than realtime, on a pool of worker threads.
+// A track ends either in silence or in a loop of the sound chip register
+// writes.  Results are cached per (file contents, track) in the user's
+// config directory.
+
+// Starts detection of every track of a file in the background.
+void length_detect_queue(const char *path, gme_type_t type, int track_count);
+
+// Fills in length, intro_length and loop_length of info if they could be
+// detected.  If wait is true, blocks until detection of the track is done,
+// but for no more than a few seconds; otherwise only the cache is checked.
+void length_detect_get(const char *path, gme_type_t type, int track,
+    int track_count, bool wait, track_info_t &info);
+
+// Stops the worker threads.
+void length_detect_cleanup();
+
+#endif // CONSOLE_LENGTH_DETECT_H
@@ -39,6 +39,8 @@ const PreferencesWidget ConsolePlugin::widgets[] = {
     WidgetSpin (N_("Default song length:"),
         WidgetInt (audcfg.loop_length),
         {1, 7200, 1, N_("seconds")}),
+    WidgetCheck (N_("Detect length of songs without timing information"),
+        WidgetBool (audcfg.detect_length)),
     WidgetLabel (N_("<b>Resampling</b>")),
     WidgetCheck (N_("Enable audio resampling"),
         WidgetBool (audcfg.resample)),
@@ -50,7 +52,12 @@ const PreferencesWidget ConsolePlugin::widgets[] = {
     WidgetCheck (N_("Ignore length from SPC tags"),
         WidgetBool (audcfg.ignore_spc_length)),
     WidgetCheck (N_("Increase reverb"),
-        WidgetBool (audcfg.inc_spc_reverb))
+        WidgetBool (audcfg.inc_spc_reverb)),
+#ifdef PCM_CACHE
+    WidgetLabel (N_("<b>Cache</b>")),
+    WidgetCheck (N_("Keep rendered audio on disk"),
+        WidgetBool ("pcm-cache", "enabled"))
+#endif
 };
 
 const PluginPreferences ConsolePlugin::prefs = {{widgets}};
@@ -50,9 +50,6 @@ public:
     bool play(const char *filename, VFSFile &file);
 };
 
-#define BUFFER_SIZE_SAMP (FLAC__MAX_BLOCK_SIZE * FLAC__MAX_CHANNELS)
-#define BUFFER_SIZE_BYTE (BUFFER_SIZE_SAMP * (FLAC__MAX_BITS_PER_SAMPLE/8))
-
 #define SAMPLE_SIZE(a) (a == 8 ? 1 : (a == 16 ? 2 : 4))
 #define SAMPLE_FMT(a) (a == 8 ? FMT_S8 : (a == 16 ? FMT_S16_NE : (a == 24 ? FMT_S24_NE : FMT_S32_NE)))
 
@@ -62,22 +59,17 @@ struct callback_info
     unsigned sample_rate = 0;
     unsigned channels = 0;
     unsigned long total_samples = 0;
-    Index<int32_t> output_buffer;
-    int32_t *write_pointer = nullptr;
-    unsigned buffer_used = 0;
+    Index<char> output_buffer;  /* interleaved, in SAMPLE_FMT(bits_per_sample) */
+    unsigned buffer_used = 0;   /* in samples */
     VFSFile *fd = nullptr;
     int bitrate = 0;
-
-    void alloc()
-    {
-        output_buffer.resize(BUFFER_SIZE_SAMP);
-        reset();
-    }
+    bool has_seektable = false;
+    bool skipping = false;      /* dropping audio before skip_to after a seek */
+    FLAC__uint64 skip_to = 0;
 
     void reset()
     {
         buffer_used = 0;
-        write_pointer = output_buffer.begin();
     }
 };
 
@@ -99,4 +91,10 @@ void metadata_callback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMet
 /* tools.c */
 bool read_metadata(FLAC__StreamDecoder* decoder, callback_info* info);
 
+/* seekindex.cc */
+void seek_index_open(const char *filename, VFSFile &file, callback_info *info, FLAC__uint64 first_frame);
+void seek_index_frame(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame);
+void seek_index_close();
+bool seek_index_seek(FLAC__StreamDecoder *decoder, callback_info *info, FLAC__uint64 sample);
+
 #endif
@@ -43,6 +43,9 @@ bool FLACng::init()
         return false;
     }
 
+    /* needed to know whether to build our own seek index */
+    FLAC__stream_decoder_set_metadata_respond(decoder, FLAC__METADATA_TYPE_SEEKTABLE);
+
     if (FLAC__STREAM_DECODER_INIT_STATUS_OK != (ret = FLAC__stream_decoder_init_stream(
         decoder,
         read_callback,
@@ -81,39 +84,9 @@ bool FLACng::is_our_file(const char *filename, VFSFile &file)
     return ! strncmp (buf, "fLaC", sizeof buf);
 }
 
-static void squeeze_audio(int32_t* src, void* dst, unsigned count, unsigned res)
-{
-    int32_t* rp = src;
-    int8_t*  wp = (int8_t*) dst;
-    int16_t* wp2 = (int16_t*) dst;
-    int32_t* wp4 = (int32_t*) dst;
-
-    switch (res)
-    {
-        case 8:
-            for (unsigned i = 0; i < count; i++, wp++, rp++)
-                *wp = *rp & 0xff;
-            break;
-
-        case 16:
-            for (unsigned i = 0; i < count; i++, wp2++, rp++)
-                *wp2 = *rp & 0xffff;
-            break;
-
-        case 24:
-        case 32:
-            for (unsigned i = 0; i < count; i++, wp4++, rp++)
-                *wp4 = *rp;
-            break;
-
-        default:
-            AUDERR("Can not convert to %u bps\n", res);
-    }
-}
-
 bool FLACng::play(const char *filename, VFSFile &file)
 {
-    Index<char> play_buffer;
+    FLAC__uint64 first_frame = 0;
     bool error = false;
 
     cinfo->fd = &file;
@@ -125,7 +98,8 @@ bool FLACng::play(const char *filename, VFSFile &file)
         goto ERR_NO_CLOSE;
     }
 
-    play_buffer.resize(BUFFER_SIZE_BYTE);
+    if (FLAC__stream_decoder_get_decode_position(decoder, &first_frame))
+        seek_index_open(filename, file, cinfo, first_frame);
 
     set_stream_bitrate(cinfo->bitrate);
     open_audio(SAMPLE_FMT(cinfo->bits_per_sample), cinfo->sample_rate, cinfo->channels);
@@ -137,8 +111,12 @@ bool FLACng::play(const char *filename, VFSFile &file)
 
         int seek_value = check_seek ();
         if (seek_value >= 0)
-            FLAC__stream_decoder_seek_absolute (decoder, (int64_t)
-             seek_value * cinfo->sample_rate / 1000);
+        {
+            FLAC__uint64 sample = (int64_t) seek_value * cinfo->sample_rate / 1000;
+
+            if (!seek_index_seek(decoder, cinfo, sample))
+                FLAC__stream_decoder_seek_absolute(decoder, sample);
+        }
 
         /* Try to decode a single frame of audio */
         if (FLAC__stream_decoder_process_single(decoder) == false)
@@ -148,14 +126,14 @@ bool FLACng::play(const char *filename, VFSFile &file)
             break;
         }
 
-        squeeze_audio(cinfo->output_buffer.begin(), play_buffer.begin(),
-         cinfo->buffer_used, cinfo->bits_per_sample);
-        write_audio(play_buffer.begin(), cinfo->buffer_used *
+        write_audio(cinfo->output_buffer.begin(), cinfo->buffer_used *
          SAMPLE_SIZE(cinfo->bits_per_sample));
 
         cinfo->reset();
     }
 
+    seek_index_close();
+
 ERR_NO_CLOSE:
     cinfo->reset();
 
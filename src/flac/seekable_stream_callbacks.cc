@@ -112,6 +112,39 @@ FLAC__StreamDecoderLengthStatus length_callback(const FLAC__StreamDecoder *decod
     return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
 }
 
+/* Packs the decoder's per-channel output directly into the interleaved output
+ * format.  Mono and stereo get their own loops, which the compiler is able to
+ * vectorize. */
+template<class T>
+static void interleave(const FLAC__int32 *const in[], T *out, unsigned frames, unsigned channels)
+{
+    if (channels == 1)
+    {
+        const FLAC__int32 *c0 = in[0];
+        for (unsigned i = 0; i < frames; i++)
+            out[i] = c0[i];
+    }
+    else if (channels == 2)
+    {
+        const FLAC__int32 *c0 = in[0], *c1 = in[1];
+        for (unsigned i = 0; i < frames; i++)
+        {
+            out[2 * i] = c0[i];
+            out[2 * i + 1] = c1[i];
+        }
+    }
+    else
+    {
+        for (unsigned channel = 0; channel < channels; channel++)
+        {
+            const FLAC__int32 *c = in[channel];
+            T *o = out + channel;
+            for (unsigned i = 0; i < frames; i++, o += channels)
+                *o = c[i];
+        }
+    }
+}
+
 FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 *const buffer[], void *client_data)
 {
     callback_info *info = (callback_info*) client_data;
@@ -122,18 +155,57 @@ FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder *decoder
         return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
 
-    if (!info->output_buffer.len())
-        info->alloc();
+    seek_index_frame(decoder, frame);
 
-    for (unsigned sample = 0; sample < frame->header.blocksize; sample++)
+    unsigned frames = frame->header.blocksize;
+    unsigned channels = frame->header.channels;
+    unsigned sample_size = SAMPLE_SIZE(info->bits_per_sample);
+
+    const FLAC__int32 *in[FLAC__MAX_CHANNELS];
+    for (unsigned channel = 0; channel < channels; channel++)
+        in[channel] = buffer[channel];
+
+    if (info->skipping)
     {
-        for (unsigned channel = 0; channel < frame->header.channels; channel++)
+        FLAC__uint64 start = frame->header.number.sample_number;
+
+        if (start + frames <= info->skip_to)
+            return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+
+        if (start < info->skip_to)
         {
-            *(info->write_pointer++) = buffer[channel][sample];
-            info->buffer_used += 1;
+            unsigned skip = info->skip_to - start;
+            for (unsigned channel = 0; channel < channels; channel++)
+                in[channel] += skip;
+
+            frames -= skip;
         }
+
+        info->skipping = false;
     }
 
+    /* a seek may leave a decoded frame in the buffer, so append */
+    unsigned needed = (info->buffer_used + frames * channels) * sample_size;
+    if ((unsigned) info->output_buffer.len() < needed)
+        info->output_buffer.resize(needed);
+
+    char *out = info->output_buffer.begin() + info->buffer_used * sample_size;
+
+    switch (info->bits_per_sample)
+    {
+        case 8:
+            interleave<int8_t>(in, (int8_t *) out, frames, channels);
+            break;
+        case 16:
+            interleave<int16_t>(in, (int16_t *) out, frames, channels);
+            break;
+        default:
+            interleave<int32_t>(in, (int32_t *) out, frames, channels);
+            break;
+    }
+
+    info->buffer_used += frames * channels;
+
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
 
@@ -170,4 +242,6 @@ void metadata_callback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMet
 
         AUDDBG("bitrate=%d\n", info->bitrate);
     }
+    else if (metadata->type == FLAC__METADATA_TYPE_SEEKTABLE)
+        info->has_seektable = (metadata->data.seek_table.num_points > 0);
 }
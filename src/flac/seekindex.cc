@@ -0,0 +1,243 @@
+/*
+ *  A FLAC decoder plugin for the Audacious Media Player
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Frame index for files without a SEEKTABLE block.  Without one, libFLAC
+ * bisects the file on every seek, which is slow on remote files in
+ * particular.  Instead, while a file plays, one frame boundary per second of
+ * audio is recorded from the normal decode, for as far as the file has been
+ * played through without a gap.  The index is saved in the user's config
+ * directory when playback ends and extended on later plays, so a file is
+ * never read just to index it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <libaudcore/runtime.h>
+
+#include "flacng.h"
+
+#define INDEX_MAGIC "FLSI"
+#define INDEX_VERSION 2
+
+struct SeekPoint
+{
+    FLAC__uint64 sample;
+    FLAC__uint64 offset;
+};
+
+struct IndexHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t file_size;
+    uint64_t total_samples;
+    uint64_t indexed_samples;
+    uint64_t n_points;
+};
+
+/* playback thread only */
+static Index<SeekPoint> points;
+static FLAC__uint64 indexed_samples;    /* the frames before this are indexed */
+static FLAC__uint64 saved_samples;      /* indexed_samples when last saved */
+static FLAC__uint64 next_point;
+static bool indexing;
+
+static String index_path;
+static FLAC__uint64 index_file_size, index_total_samples;
+static unsigned index_sample_rate;
+
+static String get_index_path(const char *filename)
+{
+    char *hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, filename, -1);
+    char *path = g_build_filename(aud_get_path(AudPath::UserDir), "flac-seek", hash, nullptr);
+
+    String result(path);
+
+    g_free(hash);
+    g_free(path);
+    return result;
+}
+
+static bool load_index()
+{
+    FILE *handle = fopen(index_path, "rb");
+    if (!handle)
+        return false;
+
+    IndexHeader header;
+    bool success = false;
+
+    if (fread(&header, sizeof header, 1, handle) != 1 ||
+        memcmp(header.magic, INDEX_MAGIC, 4) || header.version != INDEX_VERSION ||
+        header.file_size != index_file_size || header.total_samples != index_total_samples ||
+        header.indexed_samples > index_total_samples ||
+        !header.n_points || header.n_points > index_total_samples)
+        goto DONE;
+
+    points.resize(header.n_points);
+
+    if (fread(points.begin(), sizeof(SeekPoint), header.n_points, handle) != header.n_points)
+    {
+        points.clear();
+        goto DONE;
+    }
+
+    indexed_samples = saved_samples = header.indexed_samples;
+    success = true;
+
+DONE:
+    fclose(handle);
+    return success;
+}
+
+static void save_index()
+{
+    char *dir = g_path_get_dirname(index_path);
+    bool have_dir = (g_mkdir_with_parents(dir, 0755) == 0);
+    g_free(dir);
+
+    if (!have_dir)
+        return;
+
+    FILE *handle = fopen(index_path, "wb");
+    if (!handle)
+    {
+        AUDERR("Could not write %s\n", (const char *) index_path);
+        return;
+    }
+
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, 4);
+    header.version = INDEX_VERSION;
+    header.file_size = index_file_size;
+    header.total_samples = index_total_samples;
+    header.indexed_samples = indexed_samples;
+    header.n_points = points.len();
+
+    if (fwrite(&header, sizeof header, 1, handle) != 1 ||
+        fwrite(points.begin(), sizeof(SeekPoint), points.len(), handle) != (size_t) points.len())
+        AUDERR("Could not write %s\n", (const char *) index_path);
+
+    fclose(handle);
+}
+
+void seek_index_open(const char *filename, VFSFile &file, callback_info *info,
+    FLAC__uint64 first_frame)
+{
+    points.clear();
+    indexed_samples = saved_samples = 0;
+    indexing = false;
+
+    int64_t size = file.fsize();
+
+    if (info->has_seektable || size <= 0 || !info->total_samples || !info->sample_rate)
+        return;
+
+    index_path = get_index_path(filename);
+    index_file_size = size;
+    index_total_samples = info->total_samples;
+    index_sample_rate = info->sample_rate;
+
+    if (load_index())
+        AUDDBG("Loaded %d seek points from %s.\n", points.len(), (const char *) index_path);
+    else
+    {
+        SeekPoint point = {0, first_frame};
+        points.append(point);
+    }
+
+    next_point = points[points.len() - 1].sample + index_sample_rate;
+    indexing = true;
+}
+
+void seek_index_frame(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame)
+{
+    /* only a frame following the indexed ones extends the index */
+    if (!indexing || frame->header.number.sample_number != indexed_samples)
+        return;
+
+    FLAC__uint64 end = indexed_samples + frame->header.blocksize;
+    FLAC__uint64 offset;
+
+    /* the end of this frame is where the next one starts */
+    if (end >= next_point && end < index_total_samples)
+    {
+        if (!FLAC__stream_decoder_get_decode_position(decoder, &offset))
+            return;
+
+        SeekPoint point = {end, offset};
+        points.append(point);
+        next_point = end + index_sample_rate;
+    }
+
+    indexed_samples = aud::min(end, index_total_samples);
+}
+
+void seek_index_close()
+{
+    if (indexing && indexed_samples > saved_samples)
+    {
+        save_index();
+        AUDDBG("Saved %d seek points.\n", points.len());
+    }
+
+    points.clear();
+    indexed_samples = saved_samples = 0;
+    indexing = false;
+    index_path = String();
+}
+
+bool seek_index_seek(FLAC__StreamDecoder *decoder, callback_info *info, FLAC__uint64 sample)
+{
+    FLAC__uint64 offset = 0;
+    bool found = false;
+
+    if (sample < indexed_samples && points.len())
+    {
+        /* find the last seek point at or before the target */
+        int lo = 0, hi = points.len();
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+            if (points[mid].sample <= sample)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        offset = points[lo].offset;
+        found = true;
+    }
+
+    if (!found || info->fd->fseek(offset, VFS_SEEK_SET) != 0)
+        return false;
+
+    if (FLAC__stream_decoder_flush(decoder) == false)
+        return false;
+
+    /* write_callback drops audio until the target sample is reached */
+    info->reset();
+    info->skip_to = sample;
+    info->skipping = true;
+
+    return true;
+}
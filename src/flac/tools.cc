@@ -30,6 +30,8 @@ bool read_metadata(FLAC__StreamDecoder *decoder, callback_info *info)
     FLAC__StreamDecoderState ret;
 
     info->reset();
+    info->has_seektable = false;
+    info->skipping = false;
 
     /* Reset the decoder */
     if (FLAC__stream_decoder_reset(decoder) == false)
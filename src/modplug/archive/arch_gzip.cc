@@ -0,0 +1,77 @@
+/* Modplug XMMS Plugin
+ * Authors: Kenton Varda <temporal@gauge3d.org>
+ *
+ * This source code is public domain.
+ */
+
+#include <cstdlib>
+#include <zlib.h>
+
+#include "arch_gzip.h"
+#include "arch_raw.h"
+
+using namespace std;
+
+//header and trailer of the smallest possible gzip file
+#define GZIP_MIN_SIZE   18
+
+//sanity limit for the size in the trailer; no module comes near it
+#define GZIP_MAX_UNPACKED   (256 << 20)
+
+arch_Gzip::arch_Gzip(const string& aFileName)
+{
+    mSize = 0;
+    mMap = nullptr;
+
+    //mapped, if it is a local file
+    arch_Raw lRaw(aFileName);
+    const unsigned char* lData = (const unsigned char*)lRaw.Map();
+    uint32_t lSize = lRaw.Size();
+
+    if (lSize < GZIP_MIN_SIZE || lData[0] != 0x1f || lData[1] != 0x8b)
+        return;
+
+    //the trailer ends with the unpacked size (modulo 4G), so the module can
+    //be inflated straight into a buffer of the right size, in one go
+    const unsigned char* lTrailer = lData + lSize - 4;
+    uint32_t lUnpacked = lTrailer[0] | lTrailer[1] << 8 | lTrailer[2] << 16 |
+        (uint32_t)lTrailer[3] << 24;
+
+    if (lUnpacked == 0 || lUnpacked > GZIP_MAX_UNPACKED)
+        return;
+
+    mMap = malloc(lUnpacked);
+    if (!mMap)
+        return;
+
+    mSize = lUnpacked;
+
+    if (!Inflate(lData, lSize, 16 + MAX_WBITS))
+    {
+        free(mMap);
+        mMap = nullptr;
+        mSize = 0;
+    }
+}
+
+arch_Gzip::~arch_Gzip()
+{
+    if(mSize != 0)
+        free(mMap);
+}
+
+bool arch_Gzip::ContainsMod(const string& aFileName)
+{
+    string lExt = Extension(aFileName);
+
+    if (lExt == ".mdgz")
+        return true;
+    if (lExt == ".s3gz")
+        return true;
+    if (lExt == ".xmgz")
+        return true;
+    if (lExt == ".itgz")
+        return true;
+
+    return false;
+}
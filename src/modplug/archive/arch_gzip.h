@@ -0,0 +1,22 @@
+/* Modplug XMMS Plugin
+ * Authors: Kenton Varda <temporal@gauge3d.org>
+ *
+ * This source code is public domain.
+ */
+
+#ifndef __MODPLUG_ARCH_GZIP_H__INCLUDED__
+#define __MODPLUG_ARCH_GZIP_H__INCLUDED__
+
+#include "archive.h"
+
+//Gzipped modules (.mdgz, .s3gz, .xmgz, .itgz), inflated in memory.
+class arch_Gzip: public Archive
+{
+public:
+    arch_Gzip(const std::string& aFileName);
+    virtual ~arch_Gzip();
+
+    static bool ContainsMod(const std::string& aFileName);
+};
+
+#endif
@@ -5,6 +5,13 @@
  */
 
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/vfs.h>
 
 #include "arch_raw.h"
 
@@ -12,35 +19,86 @@ using namespace std;
 
 arch_Raw::arch_Raw(const string& aFileName)
 {
-    mFileDesc = VFSFile(aFileName.c_str(), "r");
-    if (!mFileDesc)
-    {
-        mSize = 0;
-        return;
-    }
+    mSize = 0;
+    mMap = nullptr;
+    mMapped = false;
 
-    mSize = mFileDesc.fsize ();
-    if (mSize <= 0)
+    if (!MapFile(aFileName))
+        ReadFile(aFileName);
+}
+
+arch_Raw::~arch_Raw()
+{
+    if(mSize != 0)
     {
-        mSize = 0;
-        return;
+        if(mMapped)
+            munmap(mMap, mSize);
+        else
+            free(mMap);
     }
+}
+
+//Local files are mapped rather than read, so that only the pages the loader
+//touches are ever read from disk.
+bool arch_Raw::MapFile(const string& aFileName)
+{
+    StringBuf lPath = uri_to_filename(aFileName.c_str());
+    if (!lPath)
+        return false;
+
+    int lFd = open(lPath, O_RDONLY);
+    if (lFd < 0)
+        return false;
 
-    mMap = malloc(mSize);
-    if (mFileDesc.fread (mMap, 1, mSize) < mSize)
+    struct stat lStat;
+    if (fstat(lFd, &lStat) < 0 || !S_ISREG(lStat.st_mode) ||
+        lStat.st_size <= 0 || lStat.st_size > UINT32_MAX)
     {
-        free(mMap);
-        mSize = 0;
-        return;
+        close(lFd);
+        return false;
     }
+
+    //private and writable, so that a loader patching the data in place
+    //only ever changes its own copy of the page
+    void* lMap = mmap(nullptr, lStat.st_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, lFd, 0);
+    close(lFd);
+
+    if (lMap == MAP_FAILED)
+        return false;
+
+    //the loaders parse the file from start to end
+    madvise(lMap, lStat.st_size, MADV_SEQUENTIAL);
+
+    mMap = lMap;
+    mSize = lStat.st_size;
+    mMapped = true;
+    return true;
 }
 
-arch_Raw::~arch_Raw()
+bool arch_Raw::ReadFile(const string& aFileName)
 {
-    if(mSize != 0)
+    VFSFile lFile(aFileName.c_str(), "r");
+    if (!lFile)
+        return false;
+
+    int64_t lSize = lFile.fsize ();
+    if (lSize <= 0 || lSize > UINT32_MAX)
+        return false;
+
+    mMap = malloc(lSize);
+    if (!mMap)
+        return false;
+
+    if (lFile.fread (mMap, 1, lSize) < lSize)
     {
         free(mMap);
+        mMap = nullptr;
+        return false;
     }
+
+    mSize = lSize;
+    return true;
 }
 
 bool arch_Raw::ContainsMod(const string& aFileName)
@@ -9,11 +9,12 @@
 
 #include "archive.h"
 
-#include <libaudcore/vfs.h>
-
 class arch_Raw: public Archive
 {
-    VFSFile mFileDesc;
+    bool mMapped;    //mMap is a mapping of a local file, not a copy
+
+    bool MapFile(const std::string& aFileName);
+    bool ReadFile(const std::string& aFileName);
 
 public:
     arch_Raw(const std::string& aFileName);
@@ -0,0 +1,154 @@
+/* Modplug XMMS Plugin
+ * Authors: Kenton Varda <temporal@gauge3d.org>
+ *
+ * This source code is public domain.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#include "arch_zip.h"
+#include "arch_raw.h"
+
+using namespace std;
+
+//Only the parts of the zip format needed to find and extract one member:
+//the end of central directory record, the central directory entries, and
+//the local file headers.  All fields are little endian.
+#define ZIP_END_SIG     "PK\5\6"
+#define ZIP_END_SIZE    22
+#define ZIP_ENTRY_SIG   "PK\1\2"
+#define ZIP_ENTRY_SIZE  46
+#define ZIP_LOCAL_SIG   "PK\3\4"
+#define ZIP_LOCAL_SIZE  30
+
+#define ZIP_STORED      0
+#define ZIP_DEFLATED    8
+#define ZIP_ENCRYPTED   0x0001
+
+static uint32_t Get16(const unsigned char* aData)
+{
+    return aData[0] | aData[1] << 8;
+}
+
+static uint32_t Get32(const unsigned char* aData)
+{
+    return aData[0] | aData[1] << 8 | aData[2] << 16 | (uint32_t)aData[3] << 24;
+}
+
+arch_Zip::arch_Zip(const string& aFileName)
+{
+    mSize = 0;
+    mMap = nullptr;
+
+    //mapped, if it is a local file; only the directory and the one member
+    //are read from it
+    arch_Raw lRaw(aFileName);
+    const unsigned char* lData = (const unsigned char*)lRaw.Map();
+    uint32_t lSize = lRaw.Size();
+
+    if (lSize < ZIP_END_SIZE)
+        return;
+
+    //the end record is followed by a comment of up to 64k
+    uint32_t lEnd = lSize - ZIP_END_SIZE;
+    uint32_t lLimit = (lEnd > 0xffff) ? lEnd - 0xffff : 0;
+    while (memcmp(lData + lEnd, ZIP_END_SIG, 4))
+    {
+        if (lEnd == lLimit)
+            return;
+        lEnd--;
+    }
+
+    uint32_t lCount = Get16(lData + lEnd + 10);
+    uint32_t lPos = Get32(lData + lEnd + 16);
+
+    for (uint32_t i = 0; i < lCount; i++)
+    {
+        if (lSize < ZIP_ENTRY_SIZE || lPos > lSize - ZIP_ENTRY_SIZE ||
+            memcmp(lData + lPos, ZIP_ENTRY_SIG, 4))
+            return;
+
+        const unsigned char* lEntry = lData + lPos;
+        uint32_t lNameLength = Get16(lEntry + 28);
+
+        if (lNameLength > lSize - ZIP_ENTRY_SIZE - lPos)
+            return;
+
+        lPos += ZIP_ENTRY_SIZE + lNameLength + Get16(lEntry + 30) + Get16(lEntry + 32);
+
+        string lName((const char*)lEntry + ZIP_ENTRY_SIZE, lNameLength);
+        if (!IsOurFile(lName))
+            continue;
+
+        uint32_t lFlags = Get16(lEntry + 8);
+        uint32_t lMethod = Get16(lEntry + 10);
+        uint32_t lPacked = Get32(lEntry + 20);
+        uint32_t lUnpacked = Get32(lEntry + 24);
+        uint32_t lLocal = Get32(lEntry + 42);
+
+        if ((lFlags & ZIP_ENCRYPTED) || lUnpacked == 0 ||
+            (lMethod != ZIP_STORED && lMethod != ZIP_DEFLATED))
+            return;
+
+        if (lSize < ZIP_LOCAL_SIZE || lLocal > lSize - ZIP_LOCAL_SIZE ||
+            memcmp(lData + lLocal, ZIP_LOCAL_SIG, 4))
+            return;
+
+        uint32_t lStart = lLocal + ZIP_LOCAL_SIZE + Get16(lData + lLocal + 26) +
+            Get16(lData + lLocal + 28);
+
+        if (lStart > lSize || lPacked > lSize - lStart)
+            return;
+
+        //the module is inflated straight into the buffer that is handed
+        //to the loader, without any intermediate copy
+        mMap = malloc(lUnpacked);
+        if (!mMap)
+            return;
+
+        mSize = lUnpacked;
+
+        bool lSuccess;
+        if (lMethod == ZIP_STORED)
+        {
+            lSuccess = (lPacked == lUnpacked);
+            if (lSuccess)
+                memcpy(mMap, lData + lStart, lUnpacked);
+        }
+        else
+            lSuccess = Inflate(lData + lStart, lPacked, -MAX_WBITS);
+
+        if (!lSuccess)
+        {
+            free(mMap);
+            mMap = nullptr;
+            mSize = 0;
+        }
+
+        return;
+    }
+}
+
+arch_Zip::~arch_Zip()
+{
+    if(mSize != 0)
+        free(mMap);
+}
+
+bool arch_Zip::ContainsMod(const string& aFileName)
+{
+    string lExt = Extension(aFileName);
+
+    if (lExt == ".mdz")
+        return true;
+    if (lExt == ".s3z")
+        return true;
+    if (lExt == ".xmz")
+        return true;
+    if (lExt == ".itz")
+        return true;
+
+    return false;
+}
@@ -0,0 +1,23 @@
+/* Modplug XMMS Plugin
+ * Authors: Kenton Varda <temporal@gauge3d.org>
+ *
+ * This source code is public domain.
+ */
+
+#ifndef __MODPLUG_ARCH_ZIP_H__INCLUDED__
+#define __MODPLUG_ARCH_ZIP_H__INCLUDED__
+
+#include "archive.h"
+
+//Zipped modules (.mdz, .s3z, .xmz, .itz), inflated in memory.  The first
+//member of the zip file with a module extension is played.
+class arch_Zip: public Archive
+{
+public:
+    arch_Zip(const std::string& aFileName);
+    virtual ~arch_Zip();
+
+    static bool ContainsMod(const std::string& aFileName);
+};
+
+#endif
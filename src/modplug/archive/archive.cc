@@ -4,33 +4,55 @@
  * This source code is public domain.
  */
 
+#include <zlib.h>
+
 #include "archive.h"
 
 using namespace std;
 
-///* Open a read pipe */ File f;
-//f=popen("gzip -d compressed.file.name","r");
-///* Read some data in the usual manner, for example */
-//fscanf(f,"%d %f %f",name,&age,$id);
-///* Close the pipe */
-//pclose(f);
-
 Archive::~Archive()
 {
 }
 
-bool Archive::IsOurFile(const string& aFileName)
+bool Archive::Inflate(const void* aSrc, uint32_t aSrcSize, int aWindowBits)
+{
+    z_stream lStream = z_stream();
+
+    if (inflateInit2(&lStream, aWindowBits) != Z_OK)
+        return false;
+
+    lStream.next_in = (Bytef*)aSrc;
+    lStream.avail_in = aSrcSize;
+    lStream.next_out = (Bytef*)mMap;
+    lStream.avail_out = mSize;
+
+    //the whole output buffer is there, so a single call does it
+    int lResult = inflate(&lStream, Z_FINISH);
+    bool lComplete = (lResult == Z_STREAM_END && lStream.total_out == mSize);
+
+    inflateEnd(&lStream);
+    return lComplete;
+}
+
+string Archive::Extension(const string& aFileName)
 {
     string lExt;
     uint32_t lPos;
 
     lPos = aFileName.find_last_of('.');
     if((int)lPos == -1)
-        return false;
+        return lExt;
     lExt = aFileName.substr(lPos);
     for(uint32_t i = 0; i < lExt.length(); i++)
         lExt[i] = tolower(lExt[i]);
 
+    return lExt;
+}
+
+bool Archive::IsOurFile(const string& aFileName)
+{
+    string lExt = Extension(aFileName);
+
     if (lExt == ".669")
         return true;
     if (lExt == ".amf")
@@ -16,9 +16,17 @@ protected:
     uint32_t mSize;
     void* mMap;
 
+    //the extension of aFileName in lower case, including the dot
+    static std::string Extension(const std::string& aFileName);
+
     //This version of IsOurFile is slightly different...
     static bool IsOurFile(const std::string& aFileName);
 
+    //Inflates aSrc into mMap, which must hold exactly mSize bytes.
+    //aWindowBits is passed on to zlib: negative for the raw deflate data of
+    //zip files, 16 + MAX_WBITS for gzip files.
+    bool Inflate(const void* aSrc, uint32_t aSrcSize, int aWindowBits);
+
 public:
     virtual ~Archive();
 
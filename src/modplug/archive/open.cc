@@ -6,10 +6,22 @@
 
 #include "open.h"
 #include "arch_raw.h"
+#include "arch_zip.h"
+#include "arch_gzip.h"
 
 using namespace std;
 
 Archive* OpenArchive(const string& aFileName) //aFilename is url --yaz
 {
+    if (arch_Zip::ContainsMod(aFileName))
+        return new arch_Zip(aFileName);
+    if (arch_Gzip::ContainsMod(aFileName))
+        return new arch_Gzip(aFileName);
+
     return new arch_Raw(aFileName);
 }
+
+bool IsCompressedMod(const string& aFileName)
+{
+    return arch_Zip::ContainsMod(aFileName) || arch_Gzip::ContainsMod(aFileName);
+}
@@ -12,4 +12,7 @@
 Archive* OpenArchive(const std::string& aFileName);
 bool ContainsMod(const std::string& aFileName);
 
+//true for the zipped and gzipped variants (.mdz, .s3gz, ...)
+bool IsCompressedMod(const std::string& aFileName);
+
 #endif
@@ -39,6 +39,13 @@ bool ModplugXMMS::is_our_file (const char * filename, VFSFile & file)
 
     if (file.fread (magic, 1, magicSize) < magicSize)
         return false;
+
+    /* Zipped and gzipped modules are recognized by their extension and the
+     * magic bytes of the container; the module itself is only unpacked when
+     * it is played. */
+    if (IsCompressedMod(filename))
+        return !memcmp(magic, "PK\3\4", 4) || !memcmp(magic, "\x1f\x8b", 2);
+
     if (!memcmp(magic, UMX_MAGIC, 4))
         return true;
     if (!memcmp(magic, "Extended Module:", 16))
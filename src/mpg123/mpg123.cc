@@ -20,6 +20,7 @@
  */
 
 #include <string.h>
+#include <time.h>
 
 #undef EXPORT
 #include <mpg123.h>
@@ -36,6 +37,7 @@
 
 #define WANT_VFS_STDIO_COMPAT
 #include <libaudcore/audstrings.h>
+#include <libaudcore/hook.h>
 #include <libaudcore/runtime.h>
 #include <libaudcore/i18n.h>
 #include <libaudcore/plugin.h>
@@ -73,16 +75,44 @@ EXPORT MPG123Plugin aud_plugin_instance;
 
 const char * const MPG123Plugin::defaults[] = {
     "full_scan", "FALSE",
+    "decoder", "",  // chosen by benchmark_decoders() on first run
     nullptr
 };
 
+static Index<ComboItem> decoder_items;
+
+static void benchmark_decoders ();
+
+static ArrayRef<ComboItem> decoder_combo_fill ()
+    { return {decoder_items.begin (), decoder_items.len ()}; }
+
 const PreferencesWidget MPG123Plugin::widgets[] = {
     WidgetLabel (N_("<b>Advanced</b>")),
     WidgetCheck (N_("Use accurate length calculation (slow)"),
-        WidgetBool ("mpg123", "full_scan"))
+        WidgetBool ("mpg123", "full_scan")),
+    WidgetCombo (N_("Decoder:"),
+        WidgetString ("mpg123", "decoder", nullptr, "mpg123 decoder changed"),
+        {nullptr, decoder_combo_fill}),
+    WidgetButton (N_("Select fastest decoder"), {benchmark_decoders})
 };
 
-const PluginPreferences MPG123Plugin::prefs = {{widgets}};
+static void mpg123_prefs_init ()
+{
+    for (const char * const * name = mpg123_supported_decoders (); * name; name ++)
+        decoder_items.append (* name, * name);
+}
+
+static void mpg123_prefs_cleanup ()
+{
+    decoder_items.clear ();
+}
+
+const PluginPreferences MPG123Plugin::prefs = {
+    {widgets},
+    mpg123_prefs_init,
+    nullptr,  // apply
+    mpg123_prefs_cleanup
+};
 
 #define DECODE_OPTIONS (MPG123_QUIET | MPG123_GAPLESS | MPG123_SEEKBUFFER | MPG123_FUZZY)
 
@@ -108,6 +138,115 @@ static off_t replace_lseek_dummy (void * file, off_t to, int whence)
     return -1;
 }
 
+static bool decoder_supported (const char * decoder)
+{
+    for (const char * const * name = mpg123_supported_decoders (); * name; name ++)
+    {
+        if (! strcmp (* name, decoder))
+            return true;
+    }
+
+    return false;
+}
+
+/* Decodes a synthetic stream of silent MPEG-1 layer 3 frames and returns the
+ * elapsed time in microseconds, or -1 on error.  The frames have empty side
+ * info, so the Huffman decoding is trivial, but the synthesis filter (which
+ * is where the optimized decoders differ) still runs in full. */
+static int64_t time_decoder (const char * decoder)
+{
+    constexpr int frame_size = 417;  // 128 kbps, 44.1 kHz, no padding
+    constexpr int n_frames = 256;
+    constexpr int n_passes = 4;
+
+    static unsigned char stream[frame_size * n_frames];
+    static float out[1152 * 2];
+
+    if (! stream[0])
+    {
+        for (int i = 0; i < n_frames; i ++)
+        {
+            unsigned char * frame = stream + frame_size * i;
+            frame[0] = 0xff;
+            frame[1] = 0xfb;  // MPEG-1 layer 3, no CRC
+            frame[2] = 0x90;  // 128 kbps, 44.1 kHz
+            frame[3] = 0x00;  // stereo
+        }
+    }
+
+    mpg123_handle * dec = mpg123_new (decoder, nullptr);
+    if (! dec)
+        return -1;
+
+    mpg123_param (dec, MPG123_ADD_FLAGS, MPG123_QUIET, 0);
+    mpg123_format_none (dec);
+    mpg123_format (dec, 44100, MPG123_STEREO, MPG123_ENC_FLOAT_32);
+
+    timespec start, end;
+    clock_gettime (CLOCK_MONOTONIC, & start);
+
+    bool error = false;
+
+    for (int pass = 0; pass < n_passes && ! error; pass ++)
+    {
+        if (mpg123_open_feed (dec) < 0 || mpg123_feed (dec, stream, sizeof stream) < 0)
+        {
+            error = true;
+            break;
+        }
+
+        while (1)
+        {
+            size_t done;
+            int ret = mpg123_read (dec, (unsigned char *) out, sizeof out, & done);
+
+            if (ret == MPG123_NEED_MORE || ret == MPG123_DONE)
+                break;
+            if (ret < 0 && ret != MPG123_NEW_FORMAT)
+            {
+                error = true;
+                break;
+            }
+        }
+
+        mpg123_close (dec);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, & end);
+    mpg123_delete (dec);
+
+    if (error)
+        return -1;
+
+    return (int64_t) (end.tv_sec - start.tv_sec) * 1000000 +
+     (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+static void benchmark_decoders ()
+{
+    const char * best = nullptr;
+    int64_t best_time = 0;
+
+    for (const char * const * name = mpg123_supported_decoders (); * name; name ++)
+    {
+        int64_t time = time_decoder (* name);
+        AUDDBG ("mpg123 decoder %s: %d us\n", * name, (int) time);
+
+        if (time >= 0 && (! best || time < best_time))
+        {
+            best = * name;
+            best_time = time;
+        }
+    }
+
+    if (best)
+    {
+        AUDINFO ("Using mpg123 decoder: %s\n", best);
+        aud_set_str ("mpg123", "decoder", best);
+        hook_call ("mpg123 decoder changed", nullptr);
+    }
+}
+
 bool MPG123Plugin::init ()
 {
     aud_config_set_defaults ("mpg123", defaults);
@@ -115,6 +254,11 @@ bool MPG123Plugin::init ()
     AUDDBG("initializing mpg123 library\n");
     mpg123_init();
 
+    /* benchmark once, and again if the library no longer has our decoder */
+    String decoder = aud_get_str ("mpg123", "decoder");
+    if (! decoder[0] || ! decoder_supported (decoder))
+        benchmark_decoders ();
+
     return true;
 }
 
@@ -142,7 +286,13 @@ struct DecodeState
 
 bool DecodeState::init (const char * filename, VFSFile & file, bool probing, bool stream)
 {
-    dec = mpg123_new (nullptr, nullptr);
+    String decoder = aud_get_str ("mpg123", "decoder");
+
+    /* falls back to the library default if the decoder is not available */
+    dec = mpg123_new (decoder[0] ? (const char *) decoder : nullptr, nullptr);
+    if (! dec)
+        dec = mpg123_new (nullptr, nullptr);
+
     mpg123_param (dec, MPG123_ADD_FLAGS, DECODE_OPTIONS, 0);
     mpg123_replace_reader_handle (dec, replace_read,
      stream ? replace_lseek_dummy : replace_lseek, nullptr);
@@ -207,10 +357,195 @@ static bool detect_id3 (VFSFile & file)
     return is_id3;
 }
 
-static StringBuf make_format_string (const mpg123_frameinfo * info)
+static StringBuf make_format_string (int version, int layer)
 {
     static const char * vers[] = {"1", "2", "2.5"};
-    return str_printf ("MPEG-%s layer %d", vers[info->version], info->layer);
+    return str_printf ("MPEG-%s layer %d", vers[version], layer);
+}
+
+static StringBuf make_format_string (const mpg123_frameinfo * info)
+    { return make_format_string (info->version, info->layer); }
+
+/* Lightweight header parser, used to avoid setting up a full mpg123 decoder
+ * when scanning files.  Only the first frame header and the Xing/Info, VBRI,
+ * and LAME tags embedded in the first frame are examined.  If no such tag is
+ * found, the caller should fall back to the decoder. */
+
+struct HeaderInfo
+{
+    int version, layer;    // version: 0 = MPEG-1, 1 = MPEG-2, 2 = MPEG-2.5
+    int rate, channels;
+    int bitrate;           // kbps, from the first frame header
+    int64_t start;         // file offset of the first frame
+    int64_t frames;        // number of audio frames, excluding the tag frame
+    int64_t bytes;         // audio data size, or -1 if unknown
+    int64_t samples;       // total samples, minus encoder delay and padding
+};
+
+struct FrameHeader
+{
+    int version, layer, rate, channels, bitrate;
+    int length;            // bytes, including the header itself
+    int samples;           // per frame
+};
+
+static uint32_t read_be32 (const unsigned char * p)
+    { return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+static bool parse_frame_header (const unsigned char * p, FrameHeader & h)
+{
+    static const short bitrates[2][3][15] = {
+        {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+         {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+         {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}},
+        {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}}
+    };
+
+    static const int rates[3][3] = {
+        {44100, 48000, 32000},
+        {22050, 24000, 16000},
+        {11025, 12000, 8000}
+    };
+
+    uint32_t word = read_be32 (p);
+
+    if ((word & 0xffe00000) != 0xffe00000)
+        return false;
+
+    int ver_bits = (word >> 19) & 3;
+    int layer_bits = (word >> 17) & 3;
+    int br_index = (word >> 12) & 15;
+    int rate_index = (word >> 10) & 3;
+    int padding = (word >> 9) & 1;
+    int mode = (word >> 6) & 3;
+
+    /* reject reserved values and free-format streams */
+    if (ver_bits == 1 || layer_bits == 0 || br_index == 0 || br_index == 15 || rate_index == 3)
+        return false;
+
+    h.version = (ver_bits == 3) ? 0 : (ver_bits == 2) ? 1 : 2;
+    h.layer = 4 - layer_bits;
+    h.rate = rates[h.version][rate_index];
+    h.channels = (mode == 3) ? 1 : 2;
+    h.bitrate = bitrates[h.version ? 1 : 0][h.layer - 1][br_index];
+
+    if (h.layer == 1)
+    {
+        h.length = (12000 * h.bitrate / h.rate + padding) * 4;
+        h.samples = 384;
+    }
+    else if (h.layer == 3 && h.version)
+    {
+        h.length = 72000 * h.bitrate / h.rate + padding;
+        h.samples = 576;
+    }
+    else
+    {
+        h.length = 144000 * h.bitrate / h.rate + padding;
+        h.samples = 1152;
+    }
+
+    return true;
+}
+
+static int64_t skip_id3v2 (VFSFile & file)
+{
+    unsigned char id3[10];
+
+    if (file.fread (id3, 1, 10) != 10 || memcmp (id3, "ID3", 3))
+        return 0;
+
+    int64_t size = ((id3[6] & 0x7f) << 21) | ((id3[7] & 0x7f) << 14) |
+     ((id3[8] & 0x7f) << 7) | (id3[9] & 0x7f);
+
+    /* footer present? */
+    return (id3[5] & 0x10) ? size + 20 : size + 10;
+}
+
+static bool read_header_info (VFSFile & file, HeaderInfo & info)
+{
+    /* large enough for the longest possible first frame plus one header */
+    unsigned char buf[4096];
+
+    int64_t start = skip_id3v2 (file);
+    if (file.fseek (start, VFS_SEEK_SET) < 0)
+        return false;
+
+    int64_t len = file.fread (buf, 1, sizeof buf);
+
+    FrameHeader h, next;
+    if (len < 4 || ! parse_frame_header (buf, h) || h.length + 4 > len)
+        return false;
+
+    /* require a matching second frame header as a sanity check */
+    if (! parse_frame_header (buf + h.length, next) || next.version != h.version ||
+     next.layer != h.layer || next.rate != h.rate)
+        return false;
+
+    info.version = h.version;
+    info.layer = h.layer;
+    info.rate = h.rate;
+    info.channels = h.channels;
+    info.bitrate = h.bitrate;
+
+    int xing_offset = 4 + ((h.version == 0) ? ((h.channels == 2) ? 32 : 17) :
+     ((h.channels == 2) ? 17 : 9));
+
+    const unsigned char * xing = buf + xing_offset;
+    const unsigned char * vbri = buf + 36;
+
+    if (h.layer == 3 && xing_offset + 8 <= h.length &&
+     (! memcmp (xing, "Xing", 4) || ! memcmp (xing, "Info", 4)))
+    {
+        uint32_t flags = read_be32 (xing + 4);
+        const unsigned char * field = xing + 8;
+
+        if (! (flags & 1) || field + 4 > buf + h.length)
+            return false;
+
+        info.start = start + h.length;
+        info.frames = read_be32 (field);
+        field += 4;
+
+        info.bytes = -1;
+        if ((flags & 2) && field + 4 <= buf + h.length)
+        {
+            info.bytes = read_be32 (field);
+            field += 4;
+        }
+
+        info.samples = info.frames * h.samples;
+
+        /* The LAME tag follows the full 120-byte Xing tag, and stores the
+         * encoder delay and padding as two 12-bit values at offset 21. */
+        const unsigned char * lame = xing + 120;
+
+        if ((flags & 0xf) == 0xf && lame + 24 <= buf + h.length &&
+         (! memcmp (lame, "LAME", 4) || ! memcmp (lame, "Lavc", 4) ||
+          ! memcmp (lame, "Lavf", 4)))
+        {
+            int delay = (lame[21] << 4) | (lame[22] >> 4);
+            int padding = ((lame[22] & 0xf) << 8) | lame[23];
+
+            if (delay + padding < info.samples)
+                info.samples -= delay + padding;
+        }
+
+        return true;
+    }
+
+    if (h.layer == 3 && 36 + 18 <= h.length && ! memcmp (vbri, "VBRI", 4))
+    {
+        info.start = start + h.length;
+        info.bytes = read_be32 (vbri + 10);
+        info.frames = read_be32 (vbri + 14);
+        info.samples = info.frames * h.samples;
+        return true;
+    }
+
+    return false;
 }
 
 bool MPG123Plugin::is_our_file (const char * filename, VFSFile & file)
@@ -223,6 +558,22 @@ bool MPG123Plugin::is_our_file (const char * filename, VFSFile & file)
     if (detect_id3 (file))
         return true;
 
+    if (! stream)
+    {
+        HeaderInfo h;
+        bool found = read_header_info (file, h);
+
+        if (file.fseek (0, VFS_SEEK_SET) < 0)
+            return false;
+
+        if (found)
+        {
+            AUDDBG ("Accepted as %s: %s.\n", (const char *)
+             make_format_string (h.version, h.layer), filename);
+            return true;
+        }
+    }
+
     DecodeState s;
     if (! s.init (filename, file, true, stream))
         return false;
@@ -236,6 +587,29 @@ static bool read_mpg123_info (const char * filename, VFSFile & file, Tuple & tup
     int64_t size = file.fsize ();
     bool stream = (size < 0);
 
+    HeaderInfo h;
+    if (! stream && read_header_info (file, h) && h.samples > 0)
+    {
+        int length = h.samples * 1000 / h.rate;
+        int64_t bytes = (h.bytes > 0) ? h.bytes : size - h.start;
+
+        tuple.set_str (Tuple::Codec, make_format_string (h.version, h.layer));
+        tuple.set_str (Tuple::Quality, str_printf ("%s, %d Hz", (h.channels == 2) ?
+         _("Stereo") : _("Mono"), h.rate));
+        tuple.set_int (Tuple::Bitrate, h.bitrate);
+
+        if (length > 0)
+        {
+            tuple.set_int (Tuple::Length, length);
+            tuple.set_int (Tuple::Bitrate, 8 * bytes / length);
+        }
+
+        return true;
+    }
+
+    if (! stream && file.fseek (0, VFS_SEEK_SET) < 0)
+        return false;
+
     DecodeState s;
     if (! s.init (filename, file, false, stream))
         return false;
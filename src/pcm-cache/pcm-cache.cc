@@ -0,0 +1,424 @@
+/*
+ * pcm-cache.cc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include "pcm-cache.h"
+
+#include <string.h>
+
+#include <libaudcore/runtime.h>
+
+#define CFG_SECTION "pcm-cache"
+
+static const char * const pcm_cache_defaults[] = {
+    "enabled", "FALSE",
+    "size", "1024",  /* megabytes */
+    nullptr
+};
+
+void pcm_cache_init ()
+{
+    aud_config_set_defaults (CFG_SECTION, pcm_cache_defaults);
+}
+
+void PCMCacheKey::add (const void * data, int64_t len)
+{
+    const unsigned char * bytes = (const unsigned char *) data;
+
+    for (int64_t i = 0; i < len; i ++)
+        m_hash = (m_hash ^ bytes[i]) * 0x100000001b3;
+}
+
+/* the terminator keeps "ab" + "c" apart from "a" + "bc" */
+void PCMCacheKey::add (const char * str)
+    { add (str, strlen (str) + 1); }
+
+void PCMCacheKey::add (int val)
+    { add (& val, sizeof val); }
+
+#ifdef PCM_CACHE
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include <FLAC/all.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/index.h>
+
+bool pcm_cache_enabled ()
+{
+    return aud_get_bool (CFG_SECTION, "enabled");
+}
+
+static StringBuf cache_dir ()
+{
+    return filename_build ({aud_get_path (AudPath::UserDir), "pcm-cache"});
+}
+
+static StringBuf cache_path (const PCMCacheKey & key)
+{
+    return filename_build ({cache_dir (), str_printf ("%016" PRIx64 ".flac", key.hash ())});
+}
+
+struct CachedFile
+{
+    String path;
+    time_t mtime;
+    int64_t size;
+};
+
+/* Removes the least recently played tracks until the cache fits its limit.
+ * Leftovers of interrupted writes are old as well, and go the same way. */
+static void evict ()
+{
+    int64_t limit = (int64_t) aud_get_int (CFG_SECTION, "size") << 20;
+
+    StringBuf dir = cache_dir ();
+    DIR * handle = opendir (dir);
+    if (! handle)
+        return;
+
+    Index<CachedFile> files;
+    int64_t total = 0;
+
+    struct dirent * entry;
+    while ((entry = readdir (handle)))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        StringBuf path = filename_build ({dir, entry->d_name});
+
+        struct stat st;
+        if (stat (path, & st) < 0 || ! S_ISREG (st.st_mode))
+            continue;
+
+        files.append (CachedFile {String (path), st.st_mtime, (int64_t) st.st_size});
+        total += st.st_size;
+    }
+
+    closedir (handle);
+
+    if (total <= limit)
+        return;
+
+    files.sort ([] (const CachedFile & a, const CachedFile & b)
+        { return (a.mtime > b.mtime) - (a.mtime < b.mtime); });
+
+    for (const CachedFile & file : files)
+    {
+        if (total <= limit)
+            break;
+
+        if (unlink (file.path) == 0)
+            total -= file.size;
+    }
+}
+
+struct PCMCacheWriter::Private
+{
+    FLAC__StreamEncoder * encoder;
+    String path, temp_path;
+    int channels;
+    Index<FLAC__int32> buffer;
+};
+
+bool PCMCacheWriter::open (const PCMCacheKey & key, int rate, int channels)
+{
+    abandon ();
+
+    StringBuf dir = cache_dir ();
+    if (mkdir (dir, 0755) < 0 && errno != EEXIST)
+    {
+        AUDERR ("Cannot create %s: %s.\n", (const char *) dir, strerror (errno));
+        return false;
+    }
+
+    /* written under a unique name, so that the same track can be played by
+     * two threads at once, and renamed when complete */
+    StringBuf path = cache_path (key);
+    StringBuf temp_path = str_concat ({path, ".XXXXXX"});
+
+    int fd = mkstemp (temp_path);
+    if (fd < 0)
+        return false;
+
+    FILE * file = fdopen (fd, "w+b");
+    if (! file)
+    {
+        close (fd);
+        unlink (temp_path);
+        return false;
+    }
+
+    FLAC__StreamEncoder * encoder = FLAC__stream_encoder_new ();
+    if (! encoder)
+    {
+        fclose (file);
+        unlink (temp_path);
+        return false;
+    }
+
+    FLAC__stream_encoder_set_channels (encoder, channels);
+    FLAC__stream_encoder_set_bits_per_sample (encoder, 16);
+    FLAC__stream_encoder_set_sample_rate (encoder, rate);
+
+    /* closes the file when finished, even if initialization fails */
+    if (FLAC__stream_encoder_init_FILE (encoder, file, nullptr, nullptr) !=
+     FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+    {
+        FLAC__stream_encoder_delete (encoder);
+        unlink (temp_path);
+        return false;
+    }
+
+    m_priv = new Private {encoder, String (path), String (temp_path), channels};
+    return true;
+}
+
+void PCMCacheWriter::write (const void * data, int bytes)
+{
+    if (! m_priv)
+        return;
+
+    const int16_t * samples = (const int16_t *) data;
+    int count = bytes / 2;
+
+    m_priv->buffer.resize (count);
+    for (int i = 0; i < count; i ++)
+        m_priv->buffer[i] = samples[i];
+
+    if (! FLAC__stream_encoder_process_interleaved (m_priv->encoder,
+     m_priv->buffer.begin (), count / m_priv->channels))
+        abandon ();
+}
+
+void PCMCacheWriter::commit ()
+{
+    if (! m_priv)
+        return;
+
+    bool success = FLAC__stream_encoder_finish (m_priv->encoder);
+    FLAC__stream_encoder_delete (m_priv->encoder);
+
+    if (! success || rename (m_priv->temp_path, m_priv->path) < 0)
+    {
+        AUDERR ("Cannot write %s.\n", (const char *) m_priv->path);
+        unlink (m_priv->temp_path);
+        success = false;
+    }
+
+    delete m_priv;
+    m_priv = nullptr;
+
+    if (success)
+        evict ();
+}
+
+void PCMCacheWriter::abandon ()
+{
+    if (! m_priv)
+        return;
+
+    FLAC__stream_encoder_delete (m_priv->encoder);
+    unlink (m_priv->temp_path);
+
+    delete m_priv;
+    m_priv = nullptr;
+}
+
+struct PCMCacheReader::Private
+{
+    FLAC__StreamDecoder * decoder;
+    int rate, channels;
+
+    bool valid;         /* STREAMINFO matches what the plugin expects */
+    int64_t length;     /* samples per channel */
+    bool ended;
+
+    Index<int16_t> pending;  /* decoded, but not yet read */
+    int pending_pos;
+};
+
+static FLAC__StreamDecoderWriteStatus read_cb (const FLAC__StreamDecoder * decoder,
+ const FLAC__Frame * frame, const FLAC__int32 * const buffer[], void * data)
+{
+    auto p = (PCMCacheReader::Private *) data;
+
+    if ((int) frame->header.channels != p->channels)
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+    int frames = frame->header.blocksize;
+    int pos = p->pending.len ();
+
+    p->pending.resize (pos + frames * p->channels);
+    int16_t * out = & p->pending[pos];
+
+    for (int i = 0; i < frames; i ++)
+    {
+        for (int ch = 0; ch < p->channels; ch ++)
+            * out ++ = buffer[ch][i];
+    }
+
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void metadata_cb (const FLAC__StreamDecoder * decoder,
+ const FLAC__StreamMetadata * metadata, void * data)
+{
+    auto p = (PCMCacheReader::Private *) data;
+
+    if (metadata->type != FLAC__METADATA_TYPE_STREAMINFO)
+        return;
+
+    const FLAC__StreamMetadata_StreamInfo & info = metadata->data.stream_info;
+
+    p->valid = ((int) info.sample_rate == p->rate &&
+     (int) info.channels == p->channels && info.bits_per_sample == 16 &&
+     info.total_samples > 0);
+    p->length = info.total_samples;
+}
+
+static void error_cb (const FLAC__StreamDecoder * decoder,
+ FLAC__StreamDecoderErrorStatus status, void * data)
+{
+    AUDERR ("FLAC error: %s\n", FLAC__StreamDecoderErrorStatusString[status]);
+}
+
+bool PCMCacheReader::open (const PCMCacheKey & key, int rate, int channels)
+{
+    close ();
+
+    StringBuf path = cache_path (key);
+    if (access (path, R_OK) < 0)
+        return false;
+
+    m_priv = new Private {FLAC__stream_decoder_new (), rate, channels};
+
+    if (FLAC__stream_decoder_init_file (m_priv->decoder, path, read_cb,
+     metadata_cb, error_cb, m_priv) != FLAC__STREAM_DECODER_INIT_STATUS_OK ||
+     ! FLAC__stream_decoder_process_until_end_of_metadata (m_priv->decoder) ||
+     ! m_priv->valid)
+    {
+        AUDERR ("Ignoring invalid cached audio in %s.\n", (const char *) path);
+        close ();
+        return false;
+    }
+
+    /* the modification time orders the tracks for eviction */
+    utime (path, nullptr);
+
+    return true;
+}
+
+void PCMCacheReader::close ()
+{
+    if (! m_priv)
+        return;
+
+    FLAC__stream_decoder_delete (m_priv->decoder);
+
+    delete m_priv;
+    m_priv = nullptr;
+}
+
+int PCMCacheReader::read (void * data, int bytes)
+{
+    if (! m_priv)
+        return 0;
+
+    int16_t * out = (int16_t *) data;
+    int wanted = bytes / (2 * m_priv->channels) * m_priv->channels;
+    int count = 0;
+
+    while (count < wanted)
+    {
+        Index<int16_t> & pending = m_priv->pending;
+
+        if (m_priv->pending_pos == pending.len ())
+        {
+            pending.clear ();
+            m_priv->pending_pos = 0;
+
+            if (m_priv->ended || FLAC__stream_decoder_get_state (m_priv->decoder) ==
+             FLAC__STREAM_DECODER_END_OF_STREAM)
+                break;
+
+            if (! FLAC__stream_decoder_process_single (m_priv->decoder))
+            {
+                m_priv->ended = true;
+                break;
+            }
+
+            continue;
+        }
+
+        int copy = aud::min (wanted - count, pending.len () - m_priv->pending_pos);
+        memcpy (out + count, & pending[m_priv->pending_pos], 2 * copy);
+
+        m_priv->pending_pos += copy;
+        count += copy;
+    }
+
+    return 2 * count;
+}
+
+void PCMCacheReader::seek (int time)
+{
+    if (! m_priv)
+        return;
+
+    m_priv->pending.clear ();
+    m_priv->pending_pos = 0;
+
+    int64_t sample = (int64_t) time * m_priv->rate / 1000;
+
+    if (sample >= m_priv->length)
+        m_priv->ended = true;
+    else
+    {
+        /* the frame containing the sample is passed to read_cb, trimmed */
+        m_priv->ended = ! FLAC__stream_decoder_seek_absolute (m_priv->decoder, sample);
+    }
+}
+
+#else /* ! PCM_CACHE */
+
+bool pcm_cache_enabled ()
+    { return false; }
+
+bool PCMCacheWriter::open (const PCMCacheKey &, int, int)
+    { return false; }
+void PCMCacheWriter::write (const void *, int) {}
+void PCMCacheWriter::commit () {}
+void PCMCacheWriter::abandon () {}
+
+bool PCMCacheReader::open (const PCMCacheKey &, int, int)
+    { return false; }
+void PCMCacheReader::close () {}
+int PCMCacheReader::read (void *, int)
+    { return 0; }
+void PCMCacheReader::seek (int) {}
+
+#endif /* PCM_CACHE */
@@ -0,0 +1,112 @@
+/*
+ * pcm-cache.h
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <stdint.h>
+
+/* Cache of rendered audio for input plugins whose decoders are emulators.
+ * The output of an emulator depends only on the file, the subtune and the
+ * emulator settings, so it is identical on every play.  When a track plays
+ * through to its end without being seeked, its audio is stored as FLAC in
+ * the user's config directory, under a hash of everything it depends on.
+ * Later plays of the same track (including seeks) are decoded from the cache
+ * instead of being emulated.
+ *
+ * The cache is disabled unless pcm-cache/enabled is set.  It is limited to
+ * pcm-cache/size megabytes, the least recently played tracks being removed
+ * first.  Without libFLAC, nothing is ever cached.
+ *
+ * Only 16-bit native-endian audio (FMT_S16_NE) is supported. */
+
+/* sets the default configuration; call from the init() of the plugin */
+void pcm_cache_init ();
+
+/* whether the cache is enabled and available */
+bool pcm_cache_enabled ();
+
+/* Identifies a rendered track.  Add everything that affects the audio: the
+ * name of the decoder, the contents of the file and of any libraries it
+ * uses, the subtune, and the settings of the emulator. */
+class PCMCacheKey
+{
+public:
+    void add (const void * data, int64_t len);
+    void add (const char * str);
+    void add (int val);
+
+    uint64_t hash () const
+        { return m_hash; }
+
+private:
+    uint64_t m_hash = 0xcbf29ce484222325;  /* FNV-1a 64 */
+};
+
+/* Stores a track while it is being rendered.  The track is only added to the
+ * cache by commit(); if the writer is destroyed first (for example because
+ * playback was stopped), or abandon() is called (for example because of a
+ * seek), what was written so far is discarded. */
+class PCMCacheWriter
+{
+public:
+    PCMCacheWriter () {}
+    ~PCMCacheWriter ()
+        { abandon (); }
+
+    PCMCacheWriter (const PCMCacheWriter &) = delete;
+    PCMCacheWriter & operator= (const PCMCacheWriter &) = delete;
+
+    bool open (const PCMCacheKey & key, int rate, int channels);
+    void write (const void * data, int bytes);
+    void commit ();
+    void abandon ();
+
+private:
+    struct Private;
+    Private * m_priv = nullptr;
+};
+
+/* Streams a track from the cache. */
+class PCMCacheReader
+{
+public:
+    PCMCacheReader () {}
+    ~PCMCacheReader ()
+        { close (); }
+
+    PCMCacheReader (const PCMCacheReader &) = delete;
+    PCMCacheReader & operator= (const PCMCacheReader &) = delete;
+
+    /* returns false if the track is not in the cache */
+    bool open (const PCMCacheKey & key, int rate, int channels);
+    void close ();
+
+    /* returns the number of bytes read, 0 at the end of the track */
+    int read (void * data, int bytes);
+
+    /* time in milliseconds; past the end, the next read() returns 0 */
+    void seek (int time);
+
+    struct Private;  /* public for the decoder callbacks */
+
+private:
+    Private * m_priv = nullptr;
+};
+
+#endif
@@ -33,6 +33,22 @@ enum
 	COMMAND_JUMP
 };
 
-Index<char> ao_get_lib(char *filename);
+struct PSFContext;
+struct PSFLib;
+
+bool ao_get_lib(PSFContext *ctx, const char *filename, PSFLib &lib);
+
+// Emulator state is saved and restored (for seeking) as the raw contents of
+// a list of memory regions.  Pointers within the state stay valid as long as
+// the engine is not restarted.
+typedef struct
+{
+	void *data;
+	uint32_t size;
+} ao_state_region;
+
+typedef Index<ao_state_region> ao_state;
+
+#define AO_STATE_ADD(state, var) ((state).append(ao_state_region{(void *) &(var), sizeof(var)}))
 
 #endif // AO_H
@@ -0,0 +1,331 @@
+/*
+ * psf-bench.cc
+ * Benchmark of the PSF1 engine: runs synthetic programs through
+ * PSX::mips_execute() and reports emulated instructions per host second,
+ * then renders audio with psf_execute() and reports the speed relative to
+ * real time.
+ *
+ * Build the reference interpreter (every instruction decoded again by the
+ * full decoder) with -DPSX_NO_DECODE_CACHE to compare; "make compare" in
+ * this directory builds and runs both.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include "../ao.h"
+#include "../eng_protos.h"
+#include "../lib_cache.h"
+#include "../psx.h"
+
+/* the synthetic programs use no libraries */
+bool ao_get_lib(PSFContext *, const char *, PSFLib &)
+{
+	return false;
+}
+
+/* A minimal R3000 assembler; branch and jump targets are labels, resolved
+ * once the program is complete. */
+struct Assembler
+{
+	static const uint32_t base = 0x80010000;
+
+	Index<uint32_t> code;
+	int labels[16];
+	struct Fixup { int pos, label; bool jump; };
+	Index<Fixup> fixups;
+
+	void emit(uint32_t op) { code.append(op); }
+	void label(int n) { labels[n] = code.len(); }
+
+	void i(int op, int rs, int rt, int imm)
+		{ emit(op << 26 | rs << 21 | rt << 16 | (imm & 0xffff)); }
+	void r(int rs, int rt, int rd, int sa, int funct)
+		{ emit(rs << 21 | rt << 16 | rd << 11 | sa << 6 | funct); }
+
+	void branch(int op, int rs, int rt, int n)
+	{
+		fixups.append(Fixup {code.len(), n, false});
+		i(op, rs, rt, 0);
+		emit(0);	/* delay slot */
+	}
+
+	void jump(int n)
+	{
+		fixups.append(Fixup {code.len(), n, true});
+		emit(0);
+		emit(0);	/* delay slot */
+	}
+
+	void lui(int rt, int imm) { i(0x0f, 0, rt, imm); }
+	void ori(int rt, int rs, int imm) { i(0x0d, rs, rt, imm); }
+	void andi(int rt, int rs, int imm) { i(0x0c, rs, rt, imm); }
+	void addiu(int rt, int rs, int imm) { i(0x09, rs, rt, imm); }
+	void lw(int rt, int off, int rs) { i(0x23, rs, rt, off); }
+	void lhu(int rt, int off, int rs) { i(0x25, rs, rt, off); }
+	void sw(int rt, int off, int rs) { i(0x2b, rs, rt, off); }
+	void sh(int rt, int off, int rs) { i(0x29, rs, rt, off); }
+	void sll(int rd, int rt, int sa) { r(0, rt, rd, sa, 0x00); }
+	void srl(int rd, int rt, int sa) { r(0, rt, rd, sa, 0x02); }
+	void addu(int rd, int rs, int rt) { r(rs, rt, rd, 0, 0x21); }
+	void xor_(int rd, int rs, int rt) { r(rs, rt, rd, 0, 0x26); }
+	void or_(int rd, int rs, int rt) { r(rs, rt, rd, 0, 0x25); }
+	void multu(int rs, int rt) { r(rs, rt, 0, 0, 0x19); }
+	void mflo(int rd) { r(0, 0, rd, 0, 0x12); }
+	void beq(int rs, int rt, int n) { branch(0x04, rs, rt, n); }
+	void bne(int rs, int rt, int n) { branch(0x05, rs, rt, n); }
+
+	void resolve()
+	{
+		for (const Fixup &f : fixups)
+		{
+			int target = labels[f.label];
+			if (f.jump)
+				code[f.pos] = 0x02 << 26 | (((base + target * 4) >> 2) & 0x3ffffff);
+			else
+				code[f.pos] |= (target - (f.pos + 1)) & 0xffff;
+		}
+	}
+};
+
+enum {zero = 0, t0 = 8, t1, t2, t3, t4, t5, t6, t7, s0, s1};
+
+/* register arithmetic and a backward branch, nothing else */
+static void program_alu(Assembler &a)
+{
+	a.ori(s0, zero, 0xace1);
+	a.label(0);
+	a.addiu(t1, t1, 1);
+	a.xor_(t2, t2, t1);
+	a.sll(t3, t2, 3);
+	a.addu(t4, t4, t3);
+	a.srl(t5, t4, 7);
+	a.or_(s0, s0, t5);
+	a.jump(0);
+}
+
+/* loads and stores through a 4 KB buffer */
+static void program_memory(Assembler &a)
+{
+	a.lui(t0, 0x8008);
+	a.label(0);
+	a.ori(t1, zero, 1024);
+	a.or_(t2, t0, zero);
+	a.label(1);
+	a.lw(t3, 0, t2);
+	a.addiu(t1, t1, -1);	/* load delay slot */
+	a.addu(t3, t3, t1);
+	a.sw(t3, 0, t2);
+	a.addiu(t2, t2, 4);
+	a.bne(t1, zero, 1);
+	a.jump(0);
+}
+
+/* plays two SPU voices and keeps changing their pitch and volume from a
+ * pseudo-random sequence, like a sound driver polling a timer */
+static void program_driver(Assembler &a)
+{
+	/* SPU registers, and a table of ADPCM data to upload */
+	a.lui(t0, 0x1f80);
+	a.ori(t0, t0, 0x1c00);
+	a.ori(t1, zero, 0x200);
+	a.sh(t1, 0x1a6, t0);
+	a.lui(t2, 0x8001);
+	a.ori(t2, t2, 0x0800);
+	a.ori(t3, zero, 16);
+	a.label(0);
+	a.lhu(t1, 0, t2);
+	a.emit(0);
+	a.sh(t1, 0x1a8, t0);
+	a.addiu(t2, t2, 2);
+	a.addiu(t3, t3, -1);
+	a.bne(t3, zero, 0);
+
+	static const int pitches[2] = {0x1000, 0x0800};
+	for (int ch = 0; ch < 2; ch++)
+	{
+		int o = ch * 16;
+		a.ori(t1, zero, 0x3fff); a.sh(t1, o + 0, t0); a.sh(t1, o + 2, t0);
+		a.ori(t1, zero, pitches[ch]); a.sh(t1, o + 4, t0);
+		a.ori(t1, zero, 0x200); a.sh(t1, o + 6, t0);
+		a.ori(t1, zero, 0x00ff); a.sh(t1, o + 8, t0);
+		a.ori(t1, zero, 0); a.sh(t1, o + 10, t0);
+	}
+
+	a.ori(t1, zero, 0xf000); a.sh(t1, 0x1a2, t0);
+	a.ori(t1, zero, 0x2000); a.sh(t1, 0x184, t0); a.sh(t1, 0x186, t0);
+	a.ori(t1, zero, 3); a.sh(t1, 0x198, t0);
+	a.ori(t1, zero, 0xc080); a.sh(t1, 0x1aa, t0);
+	a.ori(t1, zero, 3); a.sh(t1, 0x188, t0);
+	a.ori(s0, zero, 0xace1);
+	a.lui(t7, 0x8002);
+
+	a.label(1);
+	a.lui(t4, 0x0001);
+	a.label(2);
+	a.addiu(t4, t4, -1);
+	a.bne(t4, zero, 2);
+
+	/* 16-bit LFSR */
+	a.srl(t5, s0, 2); a.xor_(t5, t5, s0);
+	a.srl(t6, s0, 3); a.xor_(t5, t5, t6);
+	a.srl(t6, s0, 5); a.xor_(t5, t5, t6);
+	a.andi(t5, t5, 1); a.sll(t5, t5, 15);
+	a.srl(s0, s0, 1); a.or_(s0, s0, t5);
+
+	a.andi(t1, s0, 0x1fff); a.addiu(t1, t1, 0x400); a.sh(t1, 4, t0);
+	a.multu(s0, s0); a.mflo(t6); a.sw(t6, 0, t7); a.lw(s1, 0, t7); a.emit(0);
+	a.andi(t1, s1, 0x0fff); a.sh(t1, 0x14, t0);
+	a.andi(t5, s1, 0x8);
+	a.beq(t5, zero, 3);
+	a.ori(t1, zero, 3); a.sh(t1, 0x188, t0);
+	a.label(3);
+	a.jump(1);
+}
+
+/* wraps a program in a PS-X EXE and that in a PSF */
+static Index<char> make_psf(void (*program)(Assembler &))
+{
+	Assembler a;
+	program(a);
+	a.resolve();
+
+	Index<unsigned char> exe;
+	exe.insert(0, 2048 + 0x1000);
+
+	unsigned char *text = exe.begin() + 2048;
+	for (int i = 0; i < a.code.len(); i++)
+		for (int b = 0; b < 4; b++)
+			text[4 * i + b] = a.code[i] >> (8 * b);
+
+	/* ADPCM data for program_driver, at base + 0x800 */
+	static const uint16_t adpcm[16] = {0x0402, 0x7777, 0x7777, 0x7777,
+	 0x9999, 0x9999, 0x9999, 0x9999, 0x0302, 0x7777, 0x7777, 0x7777,
+	 0x9999, 0x9999, 0x9999, 0x9999};
+	for (int i = 0; i < 16; i++)
+	{
+		text[0x800 + 2 * i] = adpcm[i];
+		text[0x800 + 2 * i + 1] = adpcm[i] >> 8;
+	}
+
+	auto put32 = [&](int pos, uint32_t val)
+	{
+		for (int b = 0; b < 4; b++)
+			exe[pos + b] = val >> (8 * b);
+	};
+
+	memcpy(exe.begin(), "PS-X EXE", 8);
+	put32(0x10, Assembler::base);	/* PC */
+	put32(0x18, Assembler::base);	/* text address */
+	put32(0x1c, 0x1000);		/* text size */
+	put32(0x30, 0x801fff00);	/* SP */
+
+	uLongf packed_len = compressBound(exe.len());
+	Index<char> psf;
+	psf.insert(0, 16 + packed_len);
+
+	compress((Bytef *)psf.begin() + 16, &packed_len, exe.begin(), exe.len());
+	psf.remove(16 + packed_len, -1);
+
+	uint32_t crc = crc32(0, (Bytef *)psf.begin() + 16, packed_len);
+	uint32_t header[3] = {0, (uint32_t)packed_len, crc};
+
+	memcpy(psf.begin(), "PSF\x01", 4);
+	for (int i = 0; i < 3; i++)
+		for (int b = 0; b < 4; b++)
+			psf[4 + 4 * i + b] = header[i] >> (8 * b);
+
+	return psf;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const int render_seconds = 60;
+static int64_t rendered;
+
+static void count_audio(PSFContext *ctx, const void *data, int bytes)
+{
+	rendered += bytes / 4;
+	if (!data || rendered >= (int64_t)render_seconds * 44100)
+		ctx->stop_flag = true;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct {
+		const char *name;
+		void (*program)(Assembler &);
+	} programs[] = {
+		{"alu", program_alu},
+		{"memory", program_memory},
+		{"driver", program_driver}
+	};
+
+	int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+
+#ifdef PSX_NO_DECODE_CACHE
+	printf("interpreter: full decoder\n");
+#else
+	printf("interpreter: decoded instruction cache\n");
+#endif
+
+	for (auto &p : programs)
+	{
+		Index<char> psf = make_psf(p.program);
+
+		/* the CPU alone, in slices of 1M instructions */
+		PSFContext cpu;
+		if (psf_start(&cpu, (uint8_t *)psf.begin(), psf.len()) != AO_SUCCESS)
+		{
+			fprintf(stderr, "%s: psf_start failed\n", p.name);
+			return 1;
+		}
+
+		double start = now();
+		for (int i = 0; i < rounds; i++)
+			cpu.psx->mips_execute(1 << 20);
+		double cpu_time = now() - start;
+
+		psf_stop(&cpu);
+
+		/* the whole engine, CPU, hardware and SPU */
+		PSFContext render;
+		psf_start(&render, (uint8_t *)psf.begin(), psf.len());
+
+		rendered = 0;
+		start = now();
+		psf_execute(&render, count_audio);
+		double render_time = now() - start;
+
+		psf_stop(&render);
+
+		printf("%-8s %7.1f M instructions/s  %6.1fx real time\n", p.name,
+		 rounds * (double)(1 << 20) / cpu_time / 1e6,
+		 render_seconds / render_time);
+	}
+
+	return 0;
+}
@@ -1,21 +1,86 @@
+#ifndef ENG_PROTOS_H
+#define ENG_PROTOS_H
+
 #include <stdint.h>
-#include <libaudcore/tuple.h>
-
-int32_t psf2_start(uint8_t *, uint32_t length);
-int32_t psf2_execute(void (*update)(const void *, int));
-int32_t psf2_stop(void);
-int32_t psf2_command(int32_t, int32_t);
-int32_t psf2_fill_info(Tuple *);
-int   psf2_seek(uint32_t);
-
-int32_t psf_start(uint8_t *buffer, uint32_t length);
-int32_t psf_execute(void (*update)(const void *, int));
-int   psf_seek(uint32_t);
-int32_t psf_stop(void);
-
-int32_t spx_start(uint8_t *buffer, uint32_t length);
-int32_t spx_execute(void (*update)(const void *, int));
-int   spx_seek(uint32_t);
-int32_t spx_stop(void);
-
-extern bool stop_flag;
+#include <libaudcore/objects.h>
+
+#include "ao.h"
+#include "corlett.h"
+
+#define MAX_FS		(32)	// maximum # of filesystems (libs and subdirectories)
+
+class PSX;
+class SPU;
+class SPU2;
+
+/* Everything needed to emulate one file.  The engines keep no global state,
+ * so any number of files can be emulated at once, each on its own thread.
+ * A plain PSFContext is enough to run an engine (to scan tags or find the
+ * length of a song); playback derives from it to hook into the engine. */
+struct PSFContext
+{
+	virtual ~PSFContext() {}
+
+	// called at the start of each frame, where the state can be saved or
+	// restored
+	virtual void frame_hook() {}
+
+	// called for each library loaded through ao_get_lib()
+	virtual void lib_loaded(const PSFLib &) {}
+
+	PSX *psx = nullptr;		// PSF1 and PSF2
+	SPU *spu = nullptr;		// PSF1 and SPU
+	SPU2 *spu2 = nullptr;		// PSF2
+
+	String dirpath;			// where to look for libraries
+	bool stop_flag = false;
+
+	// eng_psf.cc and eng_psf2.cc
+	corlett_t *c = nullptr;
+	char psfby[256] {};
+	uint32_t initialPC = 0, initialGP = 0, initialSP = 0;
+
+	// eng_psf2.cc
+	uint32_t loadAddr = 0;
+	uint8_t *filesys[MAX_FS] {};
+	Index<char> lib_fs;		// reserved area of the library
+	uint32_t fssize[MAX_FS] {};
+	int num_fs = 0;
+
+	// eng_spx.cc
+	uint8_t *start_of_file = nullptr, *song_ptr = nullptr;
+	uint32_t cur_tick = 0, cur_event = 0, num_events = 0, next_tick = 0, end_tick = 0;
+	int old_fmt = 0;
+	char name[128] {}, song[128] {}, company[128] {};
+};
+
+/* receives each block of audio; data is nullptr when the song has ended */
+typedef void (*psf_update_func)(PSFContext *ctx, const void *data, int bytes);
+
+int32_t psf2_start(PSFContext *ctx, uint8_t *, uint32_t length);
+int32_t psf2_execute(PSFContext *ctx, psf_update_func update);
+int32_t psf2_stop(PSFContext *ctx);
+int32_t psf2_command(PSFContext *ctx, int32_t, int32_t);
+int   psf2_seek(PSFContext *ctx, uint32_t);
+uint32_t psf2_tell(PSFContext *ctx);
+void psf2_get_state(PSFContext *ctx, ao_state &state);
+
+int32_t psf_start(PSFContext *ctx, uint8_t *buffer, uint32_t length);
+int32_t psf_execute(PSFContext *ctx, psf_update_func update);
+int   psf_seek(PSFContext *ctx, uint32_t);
+uint32_t psf_tell(PSFContext *ctx);
+int32_t psf_stop(PSFContext *ctx);
+void psf_get_state(PSFContext *ctx, ao_state &state);
+
+int32_t spx_start(PSFContext *ctx, uint8_t *buffer, uint32_t length);
+int32_t spx_execute(PSFContext *ctx, psf_update_func update);
+int32_t spx_stop(PSFContext *ctx);
+void spx_get_state(PSFContext *ctx, ao_state &state);
+
+/* used by the PSX hardware to load IOP modules */
+uint32_t psf2_load_file(PSFContext *ctx, const char *file, uint8_t *buf, uint32_t buflen);
+uint32_t psf2_load_elf(PSFContext *ctx, uint8_t *start, uint32_t len);
+uint32_t psf2_get_loadaddr(PSFContext *ctx);
+void psf2_set_loadaddr(PSFContext *ctx, uint32_t addr);
+
+#endif
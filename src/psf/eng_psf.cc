@@ -32,12 +32,12 @@
 
 #include "ao.h"
 #include "eng_protos.h"
+#include "lib_cache.h"
 #include "cpuintrf.h"
 #include "psx.h"
 
 #include "peops/stdafx.h"
 #include "peops/externals.h"
-#include "peops/regs.h"
 #include "peops/registers.h"
 #include "peops/spu.h"
 
@@ -47,48 +47,29 @@
 
 #define LE32(x) FROM_LE32(x)
 
-static corlett_t	*c = nullptr;
-static char 		psfby[256];
-int			psf_refresh  = -1;
-
-
-// main RAM
-extern uint32_t psx_ram[((2*1024*1024)/4)+4];
-extern uint32_t psx_scratch[0x400];
-extern uint32_t initial_ram[((2*1024*1024)/4)+4];
-extern uint32_t initial_scratch[0x400];
-static uint32_t initialPC, initialGP, initialSP;
-
-extern void mips_init( void );
-extern void mips_reset( void *param );
-extern int mips_execute( int cycles );
-extern void mips_set_info(uint32_t state, union cpuinfo *info);
-extern void psx_hw_init(void);
-extern void psx_hw_slice(void);
-extern void psx_hw_frame(void);
-extern void setlength(int32_t stop, int32_t fade);
-
-int32_t psf_start(uint8_t *buffer, uint32_t length)
+int32_t psf_start(PSFContext *ctx, uint8_t *buffer, uint32_t length)
 {
+	PSX *psx = ctx->psx = new PSX(ctx);
+	SPU *spu = ctx->spu = new SPU(ctx);
 	uint8_t *file, *lib_decoded, *alib_decoded;
 	uint32_t offset, plength, PC, SP, GP, lengthMS, fadeMS;
 	uint64_t file_len, lib_len, alib_len;
-	corlett_t *lib;
+	PSFLib lib;
 	int i;
 	union cpuinfo mipsinfo;
 
 	// clear PSX work RAM before we start scribbling in it
-	memset(psx_ram, 0, 2*1024*1024);
+	memset(psx->psx_ram, 0, 2*1024*1024);
 
 //	printf("Length = %d\n", length);
 
 	// Decode the current GSF
-	if (corlett_decode(buffer, length, &file, &file_len, &c) != AO_SUCCESS)
+	if (corlett_decode(buffer, length, &file, &file_len, &ctx->c) != AO_SUCCESS)
 	{
 		return AO_FAIL;
 	}
 
-//	printf("file_len %d reserve %d\n", file_len, c->res_size);
+//	printf("file_len %d reserve %d\n", file_len, ctx->c->res_size);
 
 	// check for PSX EXE signature
 	if (strncmp((char *)file, "PS-X EXE", 8))
@@ -102,16 +83,16 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	offset = file[0x1c] | file[0x1d]<<8 | file[0x1e]<<16 | file[0x1f]<<24;
 	printf("Text section size: %x\n", offset);
 	printf("Region: [%s]\n", &file[0x4c]);
-	printf("refresh: [%s]\n", c->inf_refresh);
+	printf("refresh: [%s]\n", ctx->c->inf_refresh);
 	#endif
 
-	if (c->inf_refresh[0] == '5')
+	if (ctx->c->inf_refresh[0] == '5')
 	{
-		psf_refresh = 50;
+		psx->psf_refresh = 50;
 	}
-	if (c->inf_refresh[0] == '6')
+	if (ctx->c->inf_refresh[0] == '6')
 	{
-		psf_refresh = 60;
+		psx->psf_refresh = 60;
 	}
 
 	PC = file[0x10] | file[0x11]<<8 | file[0x12]<<16 | file[0x13]<<24;
@@ -123,24 +104,21 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	#endif
 
 	// Get the library file, if any
-	if (c->lib[0] != 0)
+	if (ctx->c->lib[0] != 0)
 	{
 		#if DEBUG_LOADER
-		printf("Loading library: %s\n", c->lib);
+		printf("Loading library: %s\n", ctx->c->lib);
 		#endif
 
-		Index<char> buf = ao_get_lib(c->lib);
-
-		if (!buf.len())
+		if (!ao_get_lib(ctx, ctx->c->lib, lib))
 			return AO_FAIL;
 
-		if (corlett_decode((uint8_t *)buf.begin(), buf.len(), &lib_decoded, &lib_len, &lib) != AO_SUCCESS)
-			return AO_FAIL;
+		lib_decoded = (uint8_t *)lib.program.begin();
+		lib_len = lib.program.len();
 
 		if (strncmp((char *)lib_decoded, "PS-X EXE", 8))
 		{
 			printf("Major error!  PSF was OK, but referenced library is not!\n");
-			free(lib);
 			return AO_FAIL;
 		}
 
@@ -150,19 +128,19 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		offset = lib_decoded[0x1c] | lib_decoded[0x1d]<<8 | lib_decoded[0x1e]<<16 | lib_decoded[0x1f]<<24;
 		printf("Text section size: %x\n", offset);
 		printf("Region: [%s]\n", &lib_decoded[0x4c]);
-		printf("refresh: [%s]\n", lib->inf_refresh);
+		printf("refresh: [%s]\n", lib.tags.inf_refresh);
 		#endif
 
 		// if the original file had no refresh tag, give the lib a shot
-		if (psf_refresh == -1)
+		if (psx->psf_refresh == -1)
 		{
-			if (lib->inf_refresh[0] == '5')
+			if (lib.tags.inf_refresh[0] == '5')
 			{
-				psf_refresh = 50;
+				psx->psf_refresh = 50;
 			}
-			if (lib->inf_refresh[0] == '6')
+			if (lib.tags.inf_refresh[0] == '6')
 			{
-				psf_refresh = 60;
+				psx->psf_refresh = 60;
 			}
 		}
 
@@ -188,10 +166,7 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		#if DEBUG_LOADER
 		printf("library offset: %x plength: %d\n", offset, plength);
 		#endif
-		memcpy(&psx_ram[offset/4], lib_decoded + 2048, plength);
-
-		// Dispose the corlett structure for the lib - we don't use it
-		free(lib);
+		memcpy(&psx->psx_ram[offset/4], lib_decoded + 2048, plength);
 	}
 
 	// now patch the main file into RAM OVER the libraries (but not the aux lib)
@@ -203,29 +178,26 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	else
 		plength = file_len - 2048;
 
-	memcpy(&psx_ram[offset/4], file + 2048, plength);
+	memcpy(&psx->psx_ram[offset/4], file + 2048, plength);
 
 	// load any auxiliary libraries now
 	for (i = 0; i < 8; i++)
 	{
-		if (c->libaux[i][0] != 0)
+		if (ctx->c->libaux[i][0] != 0)
 		{
 			#if DEBUG_LOADER
-			printf("Loading aux library: %s\n", c->libaux[i]);
+			printf("Loading aux library: %s\n", ctx->c->libaux[i]);
 			#endif
 
-			Index<char> buf = ao_get_lib(c->libaux[i]);
-
-			if (!buf.len())
+			if (!ao_get_lib(ctx, ctx->c->libaux[i], lib))
 				return AO_FAIL;
 
-			if (corlett_decode((uint8_t *)buf.begin(), buf.len(), &alib_decoded, &alib_len, &lib) != AO_SUCCESS)
-				return AO_FAIL;
+			alib_decoded = (uint8_t *)lib.program.begin();
+			alib_len = lib.program.len();
 
 			if (strncmp((char *)alib_decoded, "PS-X EXE", 8))
 			{
 				printf("Major error!  PSF was OK, but referenced library is not!\n");
-				free(lib);
 				return AO_FAIL;
 			}
 
@@ -246,38 +218,34 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 			else
 				plength = alib_len - 2048;
 
-			memcpy(&psx_ram[offset/4], alib_decoded + 2048, plength);
-
-			// Dispose the corlett structure for the lib - we don't use it
-			free(lib);
+			memcpy(&psx->psx_ram[offset/4], alib_decoded + 2048, plength);
 		}
 	}
 
 	free(file);
-//	free(lib_decoded);
 
 	// Finally, set psfby tag
-	strcpy(psfby, "n/a");
-	if (c)
+	strcpy(ctx->psfby, "n/a");
+	if (ctx->c)
 	{
 		int i;
 		for (i = 0; i < MAX_UNKNOWN_TAGS; i++)
 		{
-			if (!strcmp_nocase(c->tag_name[i], "psfby"))
-				strcpy(psfby, c->tag_data[i]);
+			if (!strcmp_nocase(ctx->c->tag_name[i], "psfby"))
+				strcpy(ctx->psfby, ctx->c->tag_data[i]);
 		}
 	}
 
-	mips_init();
-	mips_reset(nullptr);
+	psx->mips_init();
+	psx->mips_reset(nullptr);
 
 	// set the initial PC, SP, GP
 	#if DEBUG_LOADER
 	printf("Initial PC %x, GP %x, SP %x\n", PC, GP, SP);
-	printf("Refresh = %d\n", psf_refresh);
+	printf("Refresh = %d\n", psx->psf_refresh);
 	#endif
 	mipsinfo.i = PC;
-	mips_set_info(CPUINFO_INT_PC, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_PC, &mipsinfo);
 
 	// set some reasonable default for the stack
 	if (SP == 0)
@@ -286,28 +254,28 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	}
 
 	mipsinfo.i = SP;
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
 
 	mipsinfo.i = GP;
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R28, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R28, &mipsinfo);
 
 	#if DEBUG_LOADER && 1
 	{
 		FILE *f;
 
 		f = fopen("psxram.bin", "wb");
-		fwrite(psx_ram, 2*1024*1024, 1, f);
+		fwrite(psx->psx_ram, 2*1024*1024, 1, f);
 		fclose(f);
 	}
 	#endif
 
-	psx_hw_init();
-	SPUinit();
-	SPUopen();
+	psx->psx_hw_init();
+	spu->SPUinit();
+	spu->SPUopen();
 
-	lengthMS = psfTimeToMS(c->inf_length);
-	fadeMS = psfTimeToMS(c->inf_fade);
+	lengthMS = psfTimeToMS(ctx->c->inf_length);
+	fadeMS = psfTimeToMS(ctx->c->inf_fade);
 
 	#if DEBUG_LOADER
 	printf("length %d fade %d\n", lengthMS, fadeMS);
@@ -318,55 +286,84 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		lengthMS = ~0;
 	}
 
-	setlength(lengthMS, fadeMS);
+	spu->setlength(lengthMS, fadeMS);
 
 	// patch illegal Chocobo Dungeon 2 code - CaitSith2 put a jump in the delay slot from a BNE
 	// and rely on Highly Experimental's buggy-ass CPU to rescue them.  Verified on real hardware
 	// that the initial code is wrong.
-	if (!strcmp(c->inf_game, "Chocobo Dungeon 2"))
+	if (!strcmp(ctx->c->inf_game, "Chocobo Dungeon 2"))
 	{
-		if (psx_ram[0xbc090/4] == LE32(0x0802f040))
+		if (psx->psx_ram[0xbc090/4] == LE32(0x0802f040))
 		{
-			psx_ram[0xbc090/4] = LE32(0);
-			psx_ram[0xbc094/4] = LE32(0x0802f040);
-			psx_ram[0xbc098/4] = LE32(0);
+			psx->psx_ram[0xbc090/4] = LE32(0);
+			psx->psx_ram[0xbc094/4] = LE32(0x0802f040);
+			psx->psx_ram[0xbc098/4] = LE32(0);
 		}
 	}
 
-//	psx_ram[0x118b8/4] = LE32(0);	// crash 2 hack
+//	psx->psx_ram[0x118b8/4] = LE32(0);	// crash 2 hack
 
 	// backup the initial state for restart
-	memcpy(initial_ram, psx_ram, 2*1024*1024);
-	memcpy(initial_scratch, psx_scratch, 0x400);
-	initialPC = PC;
-	initialGP = GP;
-	initialSP = SP;
+	memcpy(psx->initial_ram, psx->psx_ram, 2*1024*1024);
+	memcpy(psx->initial_scratch, psx->psx_scratch, 0x400);
+	ctx->initialPC = PC;
+	ctx->initialGP = GP;
+	ctx->initialSP = SP;
 
-	mips_execute(5000);
+	psx->mips_execute(5000);
 
 	return AO_SUCCESS;
 }
 
-int32_t psf_execute(void (*update)(const void *, int))
+int32_t psf_execute(PSFContext *ctx, psf_update_func update)
 {
+	PSX *psx = ctx->psx;
+	SPU *spu = ctx->spu;
 	int i;
 
-	while (!stop_flag) {
+	while (!ctx->stop_flag) {
+		ctx->frame_hook();
+
 		for (i = 0; i < 44100 / 60; i++) {
-			psx_hw_slice();
-			SPUasync(384, update);
+			psx->psx_hw_slice();
+			spu->SPUasync(384, update);
 		}
 
-		psx_hw_frame();
+		psx->psx_hw_frame();
 	}
 
 	return AO_SUCCESS;
 }
 
-int32_t psf_stop(void)
+int psf_seek(PSFContext *ctx, uint32_t t)
+{
+	return ctx->spu->psf_seek(t);
+}
+
+uint32_t psf_tell(PSFContext *ctx)
+{
+	return ctx->spu->psf_tell();
+}
+
+void psf_get_state(PSFContext *ctx, ao_state &state)
+{
+	PSX *psx = ctx->psx;
+
+	psx->mips_get_state(state);
+	psx->psx_hw_get_state(state);
+	ctx->spu->SPUgetState(state);
+}
+
+int32_t psf_stop(PSFContext *ctx)
 {
-	SPUclose();
-	free(c);
+	ctx->spu->SPUclose();
+	free(ctx->c);
+	ctx->c = nullptr;
+
+	delete ctx->spu;
+	delete ctx->psx;
+	ctx->spu = nullptr;
+	ctx->psx = nullptr;
 
 	return AO_SUCCESS;
 }
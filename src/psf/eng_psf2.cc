@@ -51,19 +51,18 @@
 
 #include "ao.h"
 #include "eng_protos.h"
+#include "lib_cache.h"
 #include "cpuintrf.h"
 #include "psx.h"
 
 #include "peops2/stdafx.h"
 #include "peops2/externals.h"
-#include "peops2/regs.h"
 #include "peops2/registers.h"
 #include "peops2/spu.h"
 
 #include "corlett.h"
 
 #define DEBUG_LOADER	(0)
-#define MAX_FS		(32)	// maximum # of filesystems (libs and subdirectories)
 
 // ELF relocation helpers
 #define ELF32_R_SYM(val)                ((val) >> 8)
@@ -71,28 +70,6 @@
 
 #define LE32(x) FROM_LE32(x)
 
-static corlett_t	*c = nullptr;
-
-// main RAM
-extern uint32_t psx_ram[(2*1024*1024)/4];
-extern uint32_t initial_ram[(2*1024*1024)/4];
-static uint32_t initialPC, initialSP;
-static uint32_t loadAddr, lengthMS, fadeMS;
-
-static uint8_t *filesys[MAX_FS];
-static Index<char> lib_raw_file;
-static uint32_t fssize[MAX_FS];
-static int num_fs;
-
-extern void mips_init( void );
-extern void mips_reset( void *param );
-extern int mips_execute( int cycles );
-extern void mips_set_info(uint32_t state, union cpuinfo *info);
-extern void psx_hw_init(void);
-extern void ps2_hw_slice(void);
-extern void ps2_hw_frame(void);
-extern void setlength2(int32_t stop, int32_t fade);
-
 static void do_iopmod(uint8_t *start, uint32_t offset)
 {
 	#if DEBUG_LOADER
@@ -112,23 +89,25 @@ static void do_iopmod(uint8_t *start, uint32_t offset)
 	#endif
 }
 
-uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
+uint32_t psf2_load_elf(PSFContext *ctx, uint8_t *start, uint32_t len)
 {
+	PSX *psx = ctx->psx;
 	uint32_t entry, shoff, shentsize, shnum;
 	uint32_t type, addr, offset, size, shent;
 //	uint32_t phoff, phentsize, phnum, shstrndx, name, flags;
 	uint32_t totallen;
+	uint32_t hi16offs = 0, hi16target = 0;
 	int i, rec;
 //	FILE *f;
 
-	if (loadAddr & 3)
+	if (ctx->loadAddr & 3)
 	{
-		loadAddr &= ~3;
-		loadAddr += 4;
+		ctx->loadAddr &= ~3;
+		ctx->loadAddr += 4;
 	}
 
 	#if DEBUG_LOADER
-	printf("psf2_load_elf: starting at %08x\n", loadAddr | 0x80000000);
+	printf("psf2_load_elf: starting at %08x\n", ctx->loadAddr | 0x80000000);
 	#endif
 
 	if ((start[0] != 0x7f) || (start[1] != 'E') || (start[2] != 'L') || (start[3] != 'F'))
@@ -171,7 +150,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 				break;
 
 			case 1:			// PROGBITS: copy data to destination
-				memcpy(&psx_ram[(loadAddr + addr)/4], &start[offset], size);
+				memcpy(&psx->psx_ram[(ctx->loadAddr + addr)/4], &start[offset], size);
 				totallen += size;
 				break;
 
@@ -182,7 +161,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 				break;
 
 			case 8:			// NOBITS: BSS region, zero out destination
-				memset(&psx_ram[(loadAddr + addr)/4], 0, size);
+				memset(&psx->psx_ram[(ctx->loadAddr + addr)/4], 0, size);
 				totallen += size;
 				break;
 
@@ -190,25 +169,24 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 		  		for (rec = 0; rec < (size/8); rec++)
 				{
 					uint32_t offs, info, target, temp, val, vallo;
-					static uint32_t hi16offs = 0, hi16target = 0;
 
 					offs = start[offset+(rec*8)] | start[offset+1+(rec*8)]<<8 | start[offset+2+(rec*8)]<<16 | start[offset+3+(rec*8)]<<24;
 					info = start[offset+4+(rec*8)] | start[offset+5+(rec*8)]<<8 | start[offset+6+(rec*8)]<<16 | start[offset+7+(rec*8)]<<24;
-					target = LE32(psx_ram[(loadAddr+offs)/4]);
+					target = LE32(psx->psx_ram[(ctx->loadAddr+offs)/4]);
 
 //					printf("[%04d] offs %08x type %02x info %08x => %08x\n", rec, offs, ELF32_R_TYPE(info), ELF32_R_SYM(info), target);
 
 					switch (ELF32_R_TYPE(info))
 					{
 						case 2:	      	// R_MIPS_32
-							target += loadAddr;
+							target += ctx->loadAddr;
 //							target |= 0x80000000;
 							break;
 
 						case 4:		// R_MIPS_26
 							temp = (target & 0x03ffffff);
 							target &= 0xfc000000;
-							temp += (loadAddr>>2);
+							temp += (ctx->loadAddr>>2);
 							target |= temp;
 							break;
 
@@ -221,7 +199,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 							vallo = ((target & 0xffff) ^ 0x8000) - 0x8000;
 
 							val = ((hi16target & 0xffff) << 16) +	vallo;
-							val += loadAddr;
+							val += ctx->loadAddr;
 //							val |= 0x80000000;
 
 							/* Account for the sign extension that will happen in the low bits.  */
@@ -230,10 +208,10 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 							hi16target = (hi16target & ~0xffff) | val;
 
 							/* Ok, we're done with the HI16 relocs.  Now deal with the LO16.  */
-							val = loadAddr + vallo;
+							val = ctx->loadAddr + vallo;
 							target = (target & ~0xffff) | (val & 0xffff);
 
-							psx_ram[(loadAddr+hi16offs)/4] = LE32(hi16target);
+							psx->psx_ram[(ctx->loadAddr+hi16offs)/4] = LE32(hi16target);
 							break;
 
 						default:
@@ -242,7 +220,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 							break;
 					}
 
-					psx_ram[(loadAddr+offs)/4] = LE32(target);
+					psx->psx_ram[(ctx->loadAddr+offs)/4] = LE32(target);
 				}
 				break;
 
@@ -260,9 +238,9 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 		shent += shentsize;
 	}
 
-	entry += loadAddr;
+	entry += ctx->loadAddr;
 	entry |= 0x80000000;
-	loadAddr += totallen;
+	ctx->loadAddr += totallen;
 
 	#if DEBUG_LOADER
 	printf("psf2_load_elf: entry PC %08x\n", entry);
@@ -349,13 +327,13 @@ static uint32_t load_file_ex(uint8_t *top, uint8_t *start, uint32_t len, const c
 	return 0xffffffff;
 }
 
-static uint32_t load_file(int fs, const char *file, uint8_t *buf, uint32_t buflen)
+static uint32_t load_file(PSFContext *ctx, int fs, const char *file, uint8_t *buf, uint32_t buflen)
 {
-	return load_file_ex(filesys[fs], filesys[fs], fssize[fs], file, buf, buflen);
+	return load_file_ex(ctx->filesys[fs], ctx->filesys[fs], ctx->fssize[fs], file, buf, buflen);
 }
 
 #if 0
-static dump_files(int fs, uint8_t *buf, uint32_t buflen)
+static dump_files(PSFContext *ctx, int fs, uint8_t *buf, uint32_t buflen)
 {
 	int32_t numfiles, i, j;
 	uint8_t *cptr;
@@ -370,8 +348,8 @@ static dump_files(int fs, uint8_t *buf, uint32_t buflen)
 
 	printf("Dumping FS %d\n", fs);
 
-	start = filesys[fs];
-	len = fssize[fs];
+	start = ctx->filesys[fs];
+	len = ctx->fssize[fs];
 
 	cptr = start + 4;
 
@@ -428,14 +406,14 @@ static dump_files(int fs, uint8_t *buf, uint32_t buflen)
 #endif
 
 // find a file on our filesystems
-uint32_t psf2_load_file(const char *file, uint8_t *buf, uint32_t buflen)
+uint32_t psf2_load_file(PSFContext *ctx, const char *file, uint8_t *buf, uint32_t buflen)
 {
 	int i;
 	uint32_t flen;
 
-	for (i = 0; i < num_fs; i++)
+	for (i = 0; i < ctx->num_fs; i++)
 	{
-		flen = load_file(i, file, buf, buflen);
+		flen = load_file(ctx, i, file, buf, buflen);
 		if (flen != 0xffffffff)
 		{
 			return flen;
@@ -445,23 +423,24 @@ uint32_t psf2_load_file(const char *file, uint8_t *buf, uint32_t buflen)
 	return 0xffffffff;
 }
 
-int32_t psf2_start(uint8_t *buffer, uint32_t length)
+int32_t psf2_start(PSFContext *ctx, uint8_t *buffer, uint32_t length)
 {
-	uint8_t *file, *lib_decoded;
-	uint32_t irx_len;
-	uint64_t file_len, lib_len;
+	PSX *psx = ctx->psx = new PSX(ctx);
+	SPU2 *spu2 = ctx->spu2 = new SPU2(ctx);
+	uint8_t *file;
+	uint32_t irx_len, lengthMS, fadeMS;
+	uint64_t file_len;
 	uint8_t *buf;
 	union cpuinfo mipsinfo;
-	corlett_t *lib;
 
-	loadAddr = 0x23f00;	// this value makes allocations work out similarly to how they would
+	ctx->loadAddr = 0x23f00;	// this value makes allocations work out similarly to how they would
 				// in Highly Experimental (as per Shadow Hearts' hard-coded assumptions)
 
 	// clear IOP work RAM before we start scribbling in it
-	memset(psx_ram, 0, 2*1024*1024);
+	memset(psx->psx_ram, 0, 2*1024*1024);
 
 	// Decode the current PSF2
-	if (corlett_decode(buffer, length, &file, &file_len, &c) != AO_SUCCESS)
+	if (corlett_decode(buffer, length, &file, &file_len, &ctx->c) != AO_SUCCESS)
 	{
 		return AO_FAIL;
 	}
@@ -470,180 +449,208 @@ int32_t psf2_start(uint8_t *buffer, uint32_t length)
 		printf ("ERROR: PSF2 can't have a program section!  ps %lx\n", (unsigned long) file_len);
 
 	#if DEBUG_LOADER
-	printf("FS section: size %x\n", c->res_size);
+	printf("FS section: size %x\n", ctx->c->res_size);
 	#endif
 
-	num_fs = 1;
-	filesys[0] = (uint8_t *)c->res_section;
-	fssize[0] = c->res_size;
+	ctx->num_fs = 1;
+	ctx->filesys[0] = (uint8_t *)ctx->c->res_section;
+	ctx->fssize[0] = ctx->c->res_size;
 
 	// Get the library file, if any
-	if (c->lib[0] != 0)
+	if (ctx->c->lib[0] != 0)
 	{
 		#if DEBUG_LOADER
-		printf("Loading library: %s\n", c->lib);
+		printf("Loading library: %s\n", ctx->c->lib);
 		#endif
 
-		lib_raw_file = ao_get_lib(c->lib);
+		PSFLib lib;
 
-		if (!lib_raw_file.len())
-			return AO_FAIL;
-
-		if (corlett_decode((uint8_t *)lib_raw_file.begin(), lib_raw_file.len(),
-		 &lib_decoded, &lib_len, &lib) != AO_SUCCESS)
+		if (!ao_get_lib(ctx, ctx->c->lib, lib))
 			return AO_FAIL;
 
 		#if DEBUG_LOADER
-		printf("Lib FS section: size %x bytes\n", lib->res_size);
+		printf("Lib FS section: size %x bytes\n", lib.tags.res_size);
 		#endif
 
-		num_fs++;
-		filesys[1] = (uint8_t *)lib->res_section;
- 		fssize[1] = lib->res_size;
+		ctx->lib_fs = std::move(lib.reserved);
+
+		ctx->num_fs++;
+		ctx->filesys[1] = (uint8_t *)ctx->lib_fs.begin();
+ 		ctx->fssize[1] = ctx->lib_fs.len();
 	}
 
 	// dump all files
 	#if 0
 	buf = (uint8_t *)malloc(16*1024*1024);
-	dump_files(0, buf, 16*1024*1024);
-	if (c->lib[0] != 0)
-		dump_files(1, buf, 16*1024*1024);
+	dump_files(ctx, 0, buf, 16*1024*1024);
+	if (ctx->c->lib[0] != 0)
+		dump_files(ctx, 1, buf, 16*1024*1024);
 	free(buf);
 	#endif
 
 	// load psf2.irx, which kicks everything off
 	buf = (uint8_t *)malloc(512*1024);
-	irx_len = psf2_load_file("psf2.irx", buf, 512*1024);
+	irx_len = psf2_load_file(ctx, "psf2.irx", buf, 512*1024);
 
 	if (irx_len != 0xffffffff)
 	{
-		initialPC = psf2_load_elf(buf, irx_len);
-		initialSP = 0x801ffff0;
+		ctx->initialPC = psf2_load_elf(ctx, buf, irx_len);
+		ctx->initialSP = 0x801ffff0;
 	}
 	free(buf);
 
-	if (initialPC == 0xffffffff)
+	if (ctx->initialPC == 0xffffffff)
 	{
 		return AO_FAIL;
 	}
 
-	lengthMS = psfTimeToMS(c->inf_length);
-	fadeMS = psfTimeToMS(c->inf_fade);
+	lengthMS = psfTimeToMS(ctx->c->inf_length);
+	fadeMS = psfTimeToMS(ctx->c->inf_fade);
 	if (lengthMS == 0)
 	{
 		lengthMS = ~0;
 	}
-	setlength2(lengthMS, fadeMS);
+	spu2->setlength2(lengthMS, fadeMS);
 
-	mips_init();
-	mips_reset(nullptr);
+	psx->mips_init();
+	psx->mips_reset(nullptr);
 
-	mipsinfo.i = initialPC;
-	mips_set_info(CPUINFO_INT_PC, &mipsinfo);
+	mipsinfo.i = ctx->initialPC;
+	psx->mips_set_info(CPUINFO_INT_PC, &mipsinfo);
 
-	mipsinfo.i = initialSP;
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
+	mipsinfo.i = ctx->initialSP;
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
 
 	// set RA
 	mipsinfo.i = 0x80000000;
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R31, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R31, &mipsinfo);
 
 	// set A0 & A1 to point to "aofile:/"
 	mipsinfo.i = 2;	// argc
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R4, &mipsinfo);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R4, &mipsinfo);
 
 	mipsinfo.i = 0x80000004;	// argv
-	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R5, &mipsinfo);
-	psx_ram[1] = LE32(0x80000008);
+	psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R5, &mipsinfo);
+	psx->psx_ram[1] = LE32(0x80000008);
 
-	buf = (uint8_t *)&psx_ram[2];
+	buf = (uint8_t *)&psx->psx_ram[2];
 	strcpy((char *)buf, "aofile:/");
 
-	psx_ram[0] = LE32(FUNCT_HLECALL);
+	psx->psx_ram[0] = LE32(FUNCT_HLECALL);
 
 	// back up initial RAM image to quickly restart songs
-	memcpy(initial_ram, psx_ram, 2*1024*1024);
+	memcpy(psx->initial_ram, psx->psx_ram, 2*1024*1024);
 
-	psx_hw_init();
-	SPU2init();
-	SPU2open(nullptr);
+	psx->psx_hw_init();
+	spu2->SPU2init();
+	spu2->SPU2open(nullptr);
 
 	return AO_SUCCESS;
 }
 
-int32_t psf2_execute(void (*update)(const void *, int))
+int32_t psf2_execute(PSFContext *ctx, psf_update_func update)
 {
+	PSX *psx = ctx->psx;
+	SPU2 *spu2 = ctx->spu2;
 	int i;
 
-	while (!stop_flag)
+	while (!ctx->stop_flag)
 	{
+		ctx->frame_hook();
+
 		for (i = 0; i < 44100 / 60; i++)
 		{
-			SPU2async(update);
-			ps2_hw_slice();
+			spu2->SPU2async(update);
+			psx->ps2_hw_slice();
 		}
 
-		ps2_hw_frame();
+		psx->ps2_hw_frame();
 	}
 
 	return AO_SUCCESS;
 }
 
-int32_t psf2_stop(void)
+int psf2_seek(PSFContext *ctx, uint32_t t)
+{
+	return ctx->spu2->psf2_seek(t);
+}
+
+uint32_t psf2_tell(PSFContext *ctx)
+{
+	return ctx->spu2->psf2_tell();
+}
+
+void psf2_get_state(PSFContext *ctx, ao_state &state)
 {
-	SPU2close();
-	lib_raw_file.clear();
-	free(c);
+	ctx->psx->mips_get_state(state);
+	ctx->psx->psx_hw_get_state(state);
+	ctx->spu2->SPU2getState(state);
+	AO_STATE_ADD(state, ctx->loadAddr);
+}
+
+int32_t psf2_stop(PSFContext *ctx)
+{
+	ctx->spu2->SPU2close();
+	ctx->lib_fs.clear();
+	free(ctx->c);
+	ctx->c = nullptr;
+
+	delete ctx->spu2;
+	delete ctx->psx;
+	ctx->spu2 = nullptr;
+	ctx->psx = nullptr;
 
 	return AO_SUCCESS;
 }
 
-int32_t psf2_command(int32_t command, int32_t parameter)
+int32_t psf2_command(PSFContext *ctx, int32_t command, int32_t parameter)
 {
+	PSX *psx = ctx->psx;
+	SPU2 *spu2 = ctx->spu2;
 	union cpuinfo mipsinfo;
 	uint32_t lengthMS, fadeMS;
 
 	switch (command)
 	{
 		case COMMAND_RESTART:
-			SPU2close();
+			spu2->SPU2close();
 
-			memcpy(psx_ram, initial_ram, 2*1024*1024);
+			memcpy(psx->psx_ram, psx->initial_ram, 2*1024*1024);
 
-			mips_init();
-			mips_reset(nullptr);
-			psx_hw_init();
-			SPU2init();
-			SPU2open(nullptr);
+			psx->mips_init();
+			psx->mips_reset(nullptr);
+			psx->psx_hw_init();
+			spu2->SPU2init();
+			spu2->SPU2open(nullptr);
 
-			mipsinfo.i = initialPC;
-			mips_set_info(CPUINFO_INT_PC, &mipsinfo);
+			mipsinfo.i = ctx->initialPC;
+			psx->mips_set_info(CPUINFO_INT_PC, &mipsinfo);
 
-			mipsinfo.i = initialSP;
-			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
-			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
+			mipsinfo.i = ctx->initialSP;
+			psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
+			psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
 
 			// set RA
 			mipsinfo.i = 0x80000000;
-			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R31, &mipsinfo);
+			psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R31, &mipsinfo);
 
 			// set A0 & A1 to point to "aofile:/"
 			mipsinfo.i = 2;	// argc
-			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R4, &mipsinfo);
+			psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R4, &mipsinfo);
 
 			mipsinfo.i = 0x80000004;	// argv
-			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R5, &mipsinfo);
+			psx->mips_set_info(CPUINFO_INT_REGISTER + MIPS_R5, &mipsinfo);
 
-			psx_hw_init();
+			psx->psx_hw_init();
 
-			lengthMS = psfTimeToMS(c->inf_length);
-			fadeMS = psfTimeToMS(c->inf_fade);
+			lengthMS = psfTimeToMS(ctx->c->inf_length);
+			fadeMS = psfTimeToMS(ctx->c->inf_fade);
 			if (lengthMS == 0)
 			{
 				lengthMS = ~0;
 			}
-			setlength2(lengthMS, fadeMS);
+			spu2->setlength2(lengthMS, fadeMS);
 
 			return AO_SUCCESS;
 
@@ -651,12 +658,12 @@ int32_t psf2_command(int32_t command, int32_t parameter)
 	return AO_FAIL;
 }
 
-uint32_t psf2_get_loadaddr(void)
+uint32_t psf2_get_loadaddr(PSFContext *ctx)
 {
-	return loadAddr;
+	return ctx->loadAddr;
 }
 
-void psf2_set_loadaddr(uint32_t addr)
+void psf2_set_loadaddr(PSFContext *ctx, uint32_t addr)
 {
-	loadAddr = addr;
+	ctx->loadAddr = addr;
 }
@@ -42,24 +42,12 @@
 
 #include "peops/stdafx.h"
 #include "peops/externals.h"
-#include "peops/regs.h"
 #include "peops/registers.h"
 #include "peops/spu.h"
 
-extern int SPUinit(void);
-extern int SPUopen(void);
-extern int SPUclose(void);
-extern void SPUinjectRAMImage(unsigned short *source);
-
-extern void setlength(int32_t stop, int32_t fade);
-
-static uint8_t *start_of_file, *song_ptr;
-static uint32_t cur_tick, cur_event, num_events, next_tick, end_tick;
-static int old_fmt;
-static char name[128], song[128], company[128];
-
-int32_t spx_start(uint8_t *buffer, uint32_t length)
+int32_t spx_start(PSFContext *ctx, uint8_t *buffer, uint32_t length)
 {
+	SPU *spu = ctx->spu = new SPU(ctx);
 	int i;
 	uint16_t reg;
 
@@ -68,135 +56,136 @@ int32_t spx_start(uint8_t *buffer, uint32_t length)
 		return AO_FAIL;
 	}
 
-	start_of_file = buffer;
+	ctx->start_of_file = buffer;
 
-	SPUinit();
-	SPUopen();
-	setlength(~0, 0);
+	spu->SPUinit();
+	spu->SPUopen();
+	spu->setlength(~0, 0);
 
 	// upload the SPU RAM image
-	SPUinjectRAMImage((unsigned short *)&buffer[0]);
+	spu->SPUinjectRAMImage((unsigned short *)&buffer[0]);
 
 	// apply the register image
 	for (i = 0; i < 512; i += 2)
 	{
 		reg = buffer[0x80000+i] | buffer[0x80000+i+1]<<8;
 
-		SPUwriteRegister((i/2)+0x1f801c00, reg);
+		spu->SPUwriteRegister((i/2)+0x1f801c00, reg);
 	}
 
-	old_fmt = 1;
+	ctx->old_fmt = 1;
 
 	if ((buffer[0x80200] != 0x44) || (buffer[0x80201] != 0xac) || (buffer[0x80202] != 0x00) || (buffer[0x80203] != 0x00))
 	{
-		old_fmt = 0;
+		ctx->old_fmt = 0;
 	}
 
-	if (old_fmt)
+	if (ctx->old_fmt)
 	{
-		num_events = buffer[0x80204] | buffer[0x80205]<<8 | buffer[0x80206]<<16 | buffer[0x80207]<<24;
+		ctx->num_events = buffer[0x80204] | buffer[0x80205]<<8 | buffer[0x80206]<<16 | buffer[0x80207]<<24;
 
-		if (((num_events * 12) + 0x80208) > length)
+		if (((ctx->num_events * 12) + 0x80208) > length)
 		{
-			old_fmt = 0;
+			ctx->old_fmt = 0;
 		}
 		else
 		{
-			cur_tick = 0;
+			ctx->cur_tick = 0;
 		}
 	}
 
-	if (!old_fmt)
+	if (!ctx->old_fmt)
 	{
-		end_tick = buffer[0x80200] | buffer[0x80201]<<8 | buffer[0x80202]<<16 | buffer[0x80203]<<24;
-		cur_tick = buffer[0x80204] | buffer[0x80205]<<8 | buffer[0x80206]<<16 | buffer[0x80207]<<24;
-		next_tick = cur_tick;
+		ctx->end_tick = buffer[0x80200] | buffer[0x80201]<<8 | buffer[0x80202]<<16 | buffer[0x80203]<<24;
+		ctx->cur_tick = buffer[0x80204] | buffer[0x80205]<<8 | buffer[0x80206]<<16 | buffer[0x80207]<<24;
+		ctx->next_tick = ctx->cur_tick;
 	}
 
-	song_ptr = &buffer[0x80208];
-	cur_event = 0;
+	ctx->song_ptr = &buffer[0x80208];
+	ctx->cur_event = 0;
 
-	strncpy((char *)&buffer[4], name, 128);
-	strncpy((char *)&buffer[0x44], song, 128);
-	strncpy((char *)&buffer[0x84], company, 128);
+	strncpy((char *)&buffer[4], ctx->name, 128);
+	strncpy((char *)&buffer[0x44], ctx->song, 128);
+	strncpy((char *)&buffer[0x84], ctx->company, 128);
 
 	return AO_SUCCESS;
 }
 
-static void spx_tick(void)
+static void spx_tick(PSFContext *ctx)
 {
+	SPU *spu = ctx->spu;
 	uint32_t time, reg, size;
 	uint16_t rdata;
 	uint8_t opcode;
 
-	if (old_fmt)
+	if (ctx->old_fmt)
 	{
-		time = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
+		time = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
 
-		while ((time == cur_tick) && (cur_event < num_events))
+		while ((time == ctx->cur_tick) && (ctx->cur_event < ctx->num_events))
 		{
-			reg = song_ptr[4] | song_ptr[5]<<8 | song_ptr[6]<<16 | song_ptr[7]<<24;
-			rdata = song_ptr[8] | song_ptr[9]<<8;
+			reg = ctx->song_ptr[4] | ctx->song_ptr[5]<<8 | ctx->song_ptr[6]<<16 | ctx->song_ptr[7]<<24;
+			rdata = ctx->song_ptr[8] | ctx->song_ptr[9]<<8;
 
-			SPUwriteRegister(reg, rdata);
+			spu->SPUwriteRegister(reg, rdata);
 
-			cur_event++;
-			song_ptr += 12;
+			ctx->cur_event++;
+			ctx->song_ptr += 12;
 
-			time = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
+			time = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
 		}
 	}
 	else
 	{
-		if (cur_tick < end_tick)
+		if (ctx->cur_tick < ctx->end_tick)
 		{
-			while (cur_tick == next_tick)
+			while (ctx->cur_tick == ctx->next_tick)
 			{
-				opcode = song_ptr[0];
-				song_ptr++;
+				opcode = ctx->song_ptr[0];
+				ctx->song_ptr++;
 
 				switch (opcode)
 				{
 					case 0:	// write register
-						reg = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						rdata = song_ptr[4] | song_ptr[5]<<8;
+						reg = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						rdata = ctx->song_ptr[4] | ctx->song_ptr[5]<<8;
 
-						SPUwriteRegister(reg, rdata);
+						spu->SPUwriteRegister(reg, rdata);
 
-						next_tick = song_ptr[6] | song_ptr[7]<<8 | song_ptr[8]<<16 | song_ptr[9]<<24;
-						song_ptr += 10;
+						ctx->next_tick = ctx->song_ptr[6] | ctx->song_ptr[7]<<8 | ctx->song_ptr[8]<<16 | ctx->song_ptr[9]<<24;
+						ctx->song_ptr += 10;
 						break;
 
 					case 1:	// read register
-				 		reg = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						SPUreadRegister(reg);
-						next_tick = song_ptr[4] | song_ptr[5]<<8 | song_ptr[6]<<16 | song_ptr[7]<<24;
-						song_ptr += 8;
+				 		reg = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						spu->SPUreadRegister(reg);
+						ctx->next_tick = ctx->song_ptr[4] | ctx->song_ptr[5]<<8 | ctx->song_ptr[6]<<16 | ctx->song_ptr[7]<<24;
+						ctx->song_ptr += 8;
 						break;
 
 					case 2: // dma write
-						size = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						song_ptr += (4 + size);
-						next_tick = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						song_ptr += 4;
+						size = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						ctx->song_ptr += (4 + size);
+						ctx->next_tick = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						ctx->song_ptr += 4;
 						break;
 
 					case 3: // dma read
-						next_tick = song_ptr[4] | song_ptr[5]<<8 | song_ptr[6]<<16 | song_ptr[7]<<24;
-						song_ptr += 8;
+						ctx->next_tick = ctx->song_ptr[4] | ctx->song_ptr[5]<<8 | ctx->song_ptr[6]<<16 | ctx->song_ptr[7]<<24;
+						ctx->song_ptr += 8;
 						break;
 
 					case 4: // xa play
-						song_ptr += (32 + 16384);
-						next_tick = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						song_ptr += 4;
+						ctx->song_ptr += (32 + 16384);
+						ctx->next_tick = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						ctx->song_ptr += 4;
 						break;
 
 					case 5: // cdda play
-						size = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						song_ptr += (4 + size);
-						next_tick = song_ptr[0] | song_ptr[1]<<8 | song_ptr[2]<<16 | song_ptr[3]<<24;
-						song_ptr += 4;
+						size = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						ctx->song_ptr += (4 + size);
+						ctx->next_tick = ctx->song_ptr[0] | ctx->song_ptr[1]<<8 | ctx->song_ptr[2]<<16 | ctx->song_ptr[3]<<24;
+						ctx->song_ptr += 4;
 						break;
 
 					default:
@@ -208,26 +197,29 @@ static void spx_tick(void)
 		}
 	}
 
-	cur_tick++;
+	ctx->cur_tick++;
 }
 
-int32_t spx_execute(void (*update)(const void *, int))
+int32_t spx_execute(PSFContext *ctx, psf_update_func update)
 {
+	SPU *spu = ctx->spu;
 	int i, run = 1;
 
-	while (!stop_flag)
+	while (!ctx->stop_flag)
 	{
-		if (old_fmt && (cur_event >= num_events))
+		if (ctx->old_fmt && (ctx->cur_event >= ctx->num_events))
 			run = 0;
-		else if (cur_tick >= end_tick)
+		else if (ctx->cur_tick >= ctx->end_tick)
 			run = 0;
 
 		if (run)
 		{
+			ctx->frame_hook();
+
 			for (i = 0; i < 44100 / 60; i++)
 			{
-			  	spx_tick();
-				SPUasync(384, update);
+			  	spx_tick(ctx);
+				spu->SPUasync(384, update);
 			}
 		}
 	}
@@ -235,9 +227,21 @@ int32_t spx_execute(void (*update)(const void *, int))
 	return AO_SUCCESS;
 }
 
-int32_t spx_stop(void)
+void spx_get_state(PSFContext *ctx, ao_state &state)
 {
-	SPUclose();
+	ctx->spu->SPUgetState(state);
+	AO_STATE_ADD(state, ctx->song_ptr);
+	AO_STATE_ADD(state, ctx->cur_tick);
+	AO_STATE_ADD(state, ctx->cur_event);
+	AO_STATE_ADD(state, ctx->next_tick);
+}
+
+int32_t spx_stop(PSFContext *ctx)
+{
+	ctx->spu->SPUclose();
+
+	delete ctx->spu;
+	ctx->spu = nullptr;
 
 	return AO_SUCCESS;
 }
@@ -0,0 +1,197 @@
+/*
+ * Cache of decoded PSF libraries
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libaudcore/objects.h>
+#include <libaudcore/runtime.h>
+#include <libaudcore/vfs.h>
+
+#include "lib_cache.h"
+
+static const int max_libs = 8;
+static const int64_t max_bytes = 64 << 20; /* total size of cached libraries */
+
+static const int header_size = 16; /* signature, reserved size, program size and CRC */
+
+struct CachedLib
+{
+    String path;
+    int64_t file_size;
+    char header[header_size];
+    PSFLib lib;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* lock mutex to read / set these variables */
+static Index<CachedLib> libs; /* least recently used first */
+static int64_t total_bytes;
+
+static int64_t lib_bytes (const PSFLib & lib)
+{
+    return lib.reserved.len () + lib.program.len ();
+}
+
+static void copy_lib (const PSFLib & from, PSFLib & to)
+{
+    to.tags = from.tags;
+
+    to.reserved.clear ();
+    to.reserved.insert (from.reserved.begin (), 0, from.reserved.len ());
+    to.program.clear ();
+    to.program.insert (from.program.begin (), 0, from.program.len ());
+
+    to.tags.res_section = (uint32_t *) to.reserved.begin ();
+}
+
+static bool decode (Index<char> & raw, PSFLib & lib)
+{
+    if (raw.len () < header_size)
+        return false;
+
+    uint8_t * program;
+    uint64_t program_len = 0;
+    corlett_t * tags;
+
+    if (corlett_decode ((uint8_t *) raw.begin (), raw.len (), & program,
+     & program_len, & tags) != AO_SUCCESS)
+        return false;
+
+    int reserved_len = aud::min ((int64_t) tags->res_size, (int64_t) raw.len () - header_size);
+
+    lib.tags = * tags;
+    lib.reserved.clear ();
+    lib.reserved.insert (raw.begin () + header_size, 0, reserved_len);
+    lib.program.clear ();
+    lib.program.insert ((const char *) program, 0, program_len);
+    lib.tags.res_section = (uint32_t *) lib.reserved.begin ();
+    lib.tags.res_size = reserved_len;
+
+    free (program);
+    free (tags);
+    return true;
+}
+
+/* mutex must be locked */
+static int find (const char * path)
+{
+    for (int i = libs.len () - 1; i >= 0; i --)
+    {
+        if (! strcmp (libs[i].path, path))
+            return i;
+    }
+
+    return -1;
+}
+
+/* mutex must be locked */
+static bool lookup (const char * path, int64_t file_size, const char * header, PSFLib & lib)
+{
+    int i = find (path);
+    if (i < 0)
+        return false;
+
+    if (libs[i].file_size != file_size || memcmp (libs[i].header, header, header_size))
+    {
+        /* the file has changed */
+        total_bytes -= lib_bytes (libs[i].lib);
+        libs.remove (i, 1);
+        return false;
+    }
+
+    /* move it to the most recently used end */
+    CachedLib cached = std::move (libs[i]);
+    libs.remove (i, 1);
+
+    copy_lib (cached.lib, lib);
+    libs.append (std::move (cached));
+    return true;
+}
+
+/* mutex must be locked */
+static void add (const char * path, int64_t file_size, const char * header, const PSFLib & lib)
+{
+    int64_t bytes = lib_bytes (lib);
+    if (bytes > max_bytes)
+        return;
+
+    while (libs.len () && (libs.len () >= max_libs || total_bytes + bytes > max_bytes))
+    {
+        total_bytes -= lib_bytes (libs[0].lib);
+        libs.remove (0, 1);
+    }
+
+    CachedLib & cached = libs.append ();
+    cached.path = String (path);
+    cached.file_size = file_size;
+    memcpy (cached.header, header, header_size);
+    copy_lib (lib, cached.lib);
+    total_bytes += bytes;
+}
+
+bool lib_cache_read (const char * path, PSFLib & lib)
+{
+    VFSFile file (path, "r");
+    if (! file)
+        return false;
+
+    /* the size and header identify the contents well enough: the header holds
+     * the CRC of the compressed program */
+    char header[header_size];
+    int64_t file_size = file.fsize ();
+
+    if (file.fread (header, 1, header_size) != header_size)
+        return false;
+
+    pthread_mutex_lock (& mutex);
+    bool found = lookup (path, file_size, header, lib);
+    pthread_mutex_unlock (& mutex);
+
+    if (found)
+        return true;
+
+    if (file.fseek (0, VFS_SEEK_SET) != 0)
+        return false;
+
+    /* decode without holding the lock; another thread may race us to it */
+    Index<char> raw = file.read_all ();
+    if (! decode (raw, lib))
+    {
+        AUDERR ("Corrupt PSF library: %s\n", path);
+        return false;
+    }
+
+    pthread_mutex_lock (& mutex);
+
+    if (file_size >= 0 && find (path) < 0)
+        add (path, file_size, header, lib);
+
+    pthread_mutex_unlock (& mutex);
+    return true;
+}
+
+void lib_cache_cleanup ()
+{
+    pthread_mutex_lock (& mutex);
+    libs.clear ();
+    total_bytes = 0;
+    pthread_mutex_unlock (& mutex);
+}
@@ -0,0 +1,43 @@
+/*
+ * Cache of decoded PSF libraries
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef PSF_LIB_CACHE_H
+#define PSF_LIB_CACHE_H
+
+#include "ao.h"
+#include "corlett.h"
+
+/* a decoded library, as referenced by the _lib tags of a minipsf */
+struct PSFLib
+{
+    corlett_t tags;        /* res_section points into reserved */
+    Index<char> reserved;  /* reserved area (the filesystem of a PSF2 library) */
+    Index<char> program;   /* decompressed program (the EXE of a PSF1 library) */
+};
+
+/* Reads and decodes a library.  Every track of an album references the same
+ * library, so decoded libraries are kept in a small LRU cache shared by all
+ * playback threads.  An entry is found by path and is used as long as the size
+ * and header (which holds the CRC of the compressed program) of the file have
+ * not changed.  Returns false if the file cannot be read or is corrupt. */
+bool lib_cache_read (const char * path, PSFLib & lib);
+
+/* frees all cached libraries */
+void lib_cache_cleanup ();
+
+#endif
@@ -36,9 +36,7 @@
 // ADSR func
 ////////////////////////////////////////////////////////////////////////
 
-static u32 RateTable[160];
-
-static void InitADSR(void)                                    // INIT ADSR
+void SPU::InitADSR(void)                                      // INIT ADSR
 {
  u32 r,rs,rd;int i;
 
@@ -61,7 +59,7 @@ static void InitADSR(void)                                    // INIT ADSR
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void StartADSR(int ch)                          // MIX ADSR
+inline void SPU::StartADSR(int ch)                            // MIX ADSR
 {
  s_chan[ch].ADSRX.lVolume=1;                           // and init some adsr vars
  s_chan[ch].ADSRX.State=0;
@@ -70,7 +68,7 @@ static inline void StartADSR(int ch)                          // MIX ADSR
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline int MixADSR(int ch)                             // MIX ADSR
+inline int SPU::MixADSR(int ch)                               // MIX ADSR
 {
  static const int sexytable[8]=
 	{0,4,6,8,9,10,11,12};
@@ -28,17 +28,15 @@
 
 #define _IN_DMA
 
-extern uint32_t psx_ram[(2*1024*1024)/4];
-
 //#include "externals.h"
 ////////////////////////////////////////////////////////////////////////
 // READ DMA (many values)
 ////////////////////////////////////////////////////////////////////////
 
-void SPUreadDMAMem(u32 usPSXMem,int iSize)
+void SPU::SPUreadDMAMem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
@@ -61,10 +59,10 @@ void SPUreadDMAMem(u32 usPSXMem,int iSize)
 // WRITE DMA (many values)
 ////////////////////////////////////////////////////////////////////////
 
-void SPUwriteDMAMem(u32 usPSXMem,int iSize)
+void SPU::SPUwriteDMAMem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
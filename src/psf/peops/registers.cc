@@ -44,20 +44,13 @@
 
 #include "../peops/externals.h"
 #include "../peops/registers.h"
-#include "../peops/regs.h"
 
-static void SoundOn(int start,int end,u16 val);
-static void SoundOff(int start,int end,u16 val);
-static void FModOn(int start,int end,u16 val);
-static void NoiseOn(int start,int end,u16 val);
-static void SetVolumeLR(int right, u8 ch,s16 vol);
-static void SetPitch(int ch,u16 val);
 
 ////////////////////////////////////////////////////////////////////////
 // WRITE REGISTERS: called by main emu
 ////////////////////////////////////////////////////////////////////////
 
-void SPUwriteRegister(u32 reg, u16 val)
+void SPU::SPUwriteRegister(u32 reg, u16 val)
 {
  const u32 r=reg&0xfff;
  regArea[(r-0xc00)>>1] = val;
@@ -297,7 +290,7 @@ void SPUwriteRegister(u32 reg, u16 val)
 // READ REGISTER: called by main emu
 ////////////////////////////////////////////////////////////////////////
 
-u16 SPUreadRegister(u32 reg)
+u16 SPU::SPUreadRegister(u32 reg)
 {
  const u32 r=reg&0xfff;
 
@@ -361,7 +354,7 @@ u16 SPUreadRegister(u32 reg)
 // SOUND ON register write
 ////////////////////////////////////////////////////////////////////////
 
-static void SoundOn(int start,int end,u16 val)     // SOUND ON PSX COMAND
+void SPU::SoundOn(int start,int end,u16 val)       // SOUND ON PSX COMAND
 {
  int ch;
 
@@ -379,7 +372,7 @@ static void SoundOn(int start,int end,u16 val)     // SOUND ON PSX COMAND
 // SOUND OFF register write
 ////////////////////////////////////////////////////////////////////////
 
-static void SoundOff(int start,int end,u16 val)    // SOUND OFF PSX COMMAND
+void SPU::SoundOff(int start,int end,u16 val)      // SOUND OFF PSX COMMAND
 {
  int ch;
  for(ch=start;ch<end;ch++,val>>=1)                     // loop channels
@@ -395,7 +388,7 @@ static void SoundOff(int start,int end,u16 val)    // SOUND OFF PSX COMMAND
 // FMOD register write
 ////////////////////////////////////////////////////////////////////////
 
-static void FModOn(int start,int end,u16 val)      // FMOD ON PSX COMMAND
+void SPU::FModOn(int start,int end,u16 val)        // FMOD ON PSX COMMAND
 {
  int ch;
 
@@ -420,7 +413,7 @@ static void FModOn(int start,int end,u16 val)      // FMOD ON PSX COMMAND
 // NOISE register write
 ////////////////////////////////////////////////////////////////////////
 
-static void NoiseOn(int start,int end,u16 val)     // NOISE ON PSX COMMAND
+void SPU::NoiseOn(int start,int end,u16 val)       // NOISE ON PSX COMMAND
 {
  int ch;
 
@@ -443,7 +436,7 @@ static void NoiseOn(int start,int end,u16 val)     // NOISE ON PSX COMMAND
 
 // please note: sweep is wrong.
 
-static void SetVolumeLR(int right, u8 ch,s16 vol)            // LEFT VOLUME
+void SPU::SetVolumeLR(int right, u8 ch,s16 vol)              // LEFT VOLUME
 {
  //if(vol&0xc000)
  //printf("%d %08x\n",right,vol);
@@ -485,7 +478,7 @@ static void SetVolumeLR(int right, u8 ch,s16 vol)            // LEFT VOLUME
 // PITCH register write
 ////////////////////////////////////////////////////////////////////////
 
-static void SetPitch(int ch,u16 val)               // SET PITCH
+void SPU::SetPitch(int ch,u16 val)                 // SET PITCH
 {
  int NP;
  if(val>0x3fff) NP=0x3fff;                             // get pitch val
@@ -81,56 +81,25 @@
 
 #include "../peops/stdafx.h"
 #include "../peops/externals.h"
-#include "../peops/regs.h"
 #include "../peops/registers.h"
 #include "../peops/spu.h"
+#include "../cpuintrf.h"
+#include "../psx.h"
 
 // Enable experimental silence skipping
 // Currently it is too aggressive, destroying the rhythm of some songs
 // See http://redmine.audacious-media-player.org/issues/201
 // #define ENABLE_SILENCE_SKIPPING
 
-void SPUirq(void) ;
-
 //#include "PsxMem.h"
 //#include "driver.h"
 
-////////////////////////////////////////////////////////////////////////
-// globals
-////////////////////////////////////////////////////////////////////////
-
-// psx buffer / addresses
-
-static u16  regArea[0x200];
-static u16  spuMem[256*1024];
-static u8 * spuMemC;
-static u8 * pSpuIrq=0;
-static u8 * pSpuBuffer;
-
-// user settings
-static int             iVolume;
-
-// MAIN infos struct for each channel
-
-static SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
-static REVERBInfo      rvb;
-
-static u32   dwNoiseVal=1;                          // global noise generator
-
-static u16  spuCtrl=0;                             // some vars to store psx reg infos
-static u16  spuStat=0;
-static u16  spuIrq=0;
-static u32  spuAddr=0xffffffff;                    // address into spu mem
-static int  bSPUIsOpen=0;
-
 static const int f[5][2] = {
 			{    0,  0  },
                         {   60,  0  },
                         {  115, -52 },
                         {   98, -55 },
                         {  122, -60 } };
-static s16 * pS;
-static s32 ttemp;
 
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
@@ -159,7 +128,7 @@ static s32 ttemp;
 // START SOUND... called by main thread to setup a new sound on a channel
 ////////////////////////////////////////////////////////////////////////
 
-static inline void StartSound(int ch)
+inline void SPU::StartSound(int ch)
 {
  StartADSR(ch);
 
@@ -179,26 +148,47 @@ static inline void StartSound(int ch)
  s_chan[ch].spos=0x40000L;s_chan[ch].SB[28]=0;  // -> start with more decoding
 }
 
+////////////////////////////////////////////////////////////////////////
+// MIX CHANNELS... adds up what the channel loop has collected for this
+// sample. No branches in here, so the compiler can use SIMD for it.
+////////////////////////////////////////////////////////////////////////
+
+inline void SPU::MixChannels(s32 &sl, s32 &sr, s32 &revLeft, s32 &revRight)
+{
+ int ch;
+
+ for(ch=0;ch<MAXCHAN;ch++)
+  {
+   s32 tmpl=(mix.sval[ch]*mix.volL[ch])>>14;
+   s32 tmpr=(mix.sval[ch]*mix.volR[ch])>>14;
+
+   sl+=tmpl;
+   sr+=tmpr;
+   revLeft+=tmpl&mix.rvb[ch];
+   revRight+=tmpr&mix.rvb[ch];
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // MAIN SPU FUNCTION
 // here is the main job handler... thread, timer or direct func call
 // basically the whole sound processing is done in this fat func!
 ////////////////////////////////////////////////////////////////////////
 
-static u32 sampcount;
-static u32 decaybegin;
-static u32 decayend;
-
-static u32 seektime;
-int psf_seek(u32 t)
+int SPU::psf_seek(u32 t)
 {
  seektime=t*441/10;
  if(seektime>=sampcount) return(1);
  return(0);
 }
 
+u32 SPU::psf_tell(void)
+{
+ return (u32)((u64)sampcount*10/441);
+}
+
 // Counting to 65536 results in full volume offage.
-void setlength(s32 stop, s32 fade)
+void SPU::setlength(s32 stop, s32 fade)
 {
  if(stop==~0)
  {
@@ -215,10 +205,9 @@ void setlength(s32 stop, s32 fade)
 }
 
 #define CLIP(_x) {if(_x>32767) _x=32767; if(_x<-32767) _x=-32767;}
-int SPUasync(u32 cycles, void (*update)(const void *, int))
+int SPU::SPUasync(u32 cycles, psf_update_func update)
 {
  int volmul=iVolume;
- static s32 dosampies;
  s32 temp;
 
  ttemp+=cycles;
@@ -238,6 +227,8 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
    //- main channel loop                              -//
    //--------------------------------------------------//
     {
+     memset(mix.sval,0,sizeof(mix.sval));              // channels which don't play add nothing
+
      for(ch=0;ch<MAXCHAN;ch++)                         // loop em all.
       {
        if(s_chan[ch].bNew) StartSound(ch);             // start new sound
@@ -316,7 +307,7 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
                {
 		 //extern s32 spuirqvoodoo;
                  s_chan[ch].iIrqDone=1;                // -> debug flag
-		 SPUirq();
+		 if(ctx->psx) ctx->psx->SPUirq();
 		//puts("IRQ");
 		 //if(spuirqvoodoo!=-1)
 		 //{
@@ -429,24 +420,11 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
           {
            //////////////////////////////////////////////
            // ok, left/right sound volume (psx volume goes from 0 ... 0x3fff)
-	   int tmpl,tmpr;
-
-		if (1) //ao_channel_enable[ch+PSF_1]) {
-		{
-			tmpl=(s_chan[ch].sval*s_chan[ch].iLeftVolume)>>14;
-			tmpr=(s_chan[ch].sval*s_chan[ch].iRightVolume)>>14;
-		} else {
-			tmpl = 0;
-			tmpr = 0;
-		}
-	   sl+=tmpl;
-	   sr+=tmpr;
-
-	   if(((rvb.Enabled>>ch)&1) && (spuCtrl&0x80))
-	   {
-	    revLeft+=tmpl;
-	    revRight+=tmpr;
-	   }
+
+	   mix.sval[ch]=s_chan[ch].sval;               // -> mixed by MixChannels, with all other channels
+	   mix.volL[ch]=s_chan[ch].iLeftVolume;
+	   mix.volR[ch]=s_chan[ch].iRightVolume;
+	   mix.rvb[ch]=(((rvb.Enabled>>ch)&1) && (spuCtrl&0x80)) ? ~0 : 0;
           }
 
          s_chan[ch].spos += s_chan[ch].sinc;
@@ -456,6 +434,7 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
 
   ///////////////////////////////////////////////////////
   // mix all channels (including reverb) into one buffer
+  MixChannels(sl,sr,revLeft,revRight);
   MixREVERBLeftRight(&sl,&sr,revLeft,revRight);
 //  printf("sampcount %d decaybegin %d decayend %d\n", sampcount, decaybegin, decayend);
   if(sampcount>=decaybegin)
@@ -466,7 +445,7 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
    {
     if(sampcount>=decayend)
     {
-      update(nullptr, 0);
+      update(ctx, nullptr, 0);
       return(0);
     }
     dmul=256-(256*(sampcount-decaybegin)/(decayend-decaybegin));
@@ -523,7 +502,7 @@ int SPUasync(u32 cycles, void (*update)(const void *, int))
 
    if (iSilenceCount < 20)
 #endif
-     update((u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
+     update(ctx, (u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
 
    pS=(short *)pSpuBuffer;
  }
@@ -553,7 +532,7 @@ static u64 gettime64(void)
 // SPUINIT: this func will be called first by the main emu
 ////////////////////////////////////////////////////////////////////////
 
-int SPUinit(void)
+int SPU::SPUinit(void)
 {
  spuMemC=(u8*)spuMem;                      // just small setup
  memset((void *)s_chan,0,MAXCHAN*sizeof(SPUCHAN));
@@ -573,7 +552,7 @@ int SPUinit(void)
 // SETUPSTREAMS: init most of the spu buffers
 ////////////////////////////////////////////////////////////////////////
 
-void SetupStreams(void)
+void SPU::SetupStreams(void)
 {
  int i;
 
@@ -594,7 +573,7 @@ void SetupStreams(void)
 // REMOVESTREAMS: free most buffer
 ////////////////////////////////////////////////////////////////////////
 
-void RemoveStreams(void)
+void SPU::RemoveStreams(void)
 {
  free(pSpuBuffer);                                     // free mixing buffer
  pSpuBuffer=nullptr;
@@ -616,7 +595,7 @@ void RemoveStreams(void)
 // SPUOPEN: called by main emu after init
 ////////////////////////////////////////////////////////////////////////
 
-int SPUopen(void)
+int SPU::SPUopen(void)
 {
  if(bSPUIsOpen) return 0;                              // security for some stupid main emus
  spuIrq=0;
@@ -643,7 +622,7 @@ int SPUopen(void)
 // SPUCLOSE: called before shutdown
 ////////////////////////////////////////////////////////////////////////
 
-int SPUclose(void)
+int SPU::SPUclose(void)
 {
  if(!bSPUIsOpen) return 0;                             // some security
 
@@ -658,12 +637,12 @@ int SPUclose(void)
 // SPUSHUTDOWN: called by main emu on final exit
 ////////////////////////////////////////////////////////////////////////
 
-int SPUshutdown(void)
+int SPU::SPUshutdown(void)
 {
  return 0;
 }
 
-void SPUinjectRAMImage(u16 *pIncoming)
+void SPU::SPUinjectRAMImage(u16 *pIncoming)
 {
 	int i;
 
@@ -672,3 +651,37 @@ void SPUinjectRAMImage(u16 *pIncoming)
 		spuMem[i] = pIncoming[i];
 	}
 }
+
+////////////////////////////////////////////////////////////////////////
+// SPUGETSTATE: lists the spu variables for saving/restoring the state
+////////////////////////////////////////////////////////////////////////
+
+void SPU::SPUgetState(ao_state &state)
+{
+ AO_STATE_ADD(state, regArea);
+ AO_STATE_ADD(state, spuMem);
+ AO_STATE_ADD(state, pSpuIrq);
+ AO_STATE_ADD(state, s_chan);
+ AO_STATE_ADD(state, rvb);
+ AO_STATE_ADD(state, dwNoiseVal);
+ AO_STATE_ADD(state, spuCtrl);
+ AO_STATE_ADD(state, spuStat);
+ AO_STATE_ADD(state, spuIrq);
+ AO_STATE_ADD(state, spuAddr);
+ AO_STATE_ADD(state, pS);
+ AO_STATE_ADD(state, ttemp);
+ AO_STATE_ADD(state, sampcount);
+ AO_STATE_ADD(state, seektime);
+ AO_STATE_ADD(state, downbuf);
+ AO_STATE_ADD(state, upbuf);
+ AO_STATE_ADD(state, dbpos);
+ AO_STATE_ADD(state, ubpos);
+
+ // samples not yet passed to update()
+ state.append(ao_state_region{pSpuBuffer, 735*4});
+}
+
+u16 SPUreadRegister(SPU *spu, u32 reg) { return spu->SPUreadRegister(reg); }
+void SPUwriteRegister(SPU *spu, u32 reg, u16 val) { spu->SPUwriteRegister(reg, val); }
+void SPUreadDMAMem(SPU *spu, u32 usPSXMem, int iSize) { spu->SPUreadDMAMem(usPSXMem, iSize); }
+void SPUwriteDMAMem(SPU *spu, u32 usPSXMem, int iSize) { spu->SPUwriteDMAMem(usPSXMem, iSize); }
@@ -24,16 +24,114 @@
 //
 //*************************************************************************//
 
-void sexyd_update(unsigned char* pSound,long lBytes);
-
-int SPUasync(u32 cycles, void (*update)(const void *, int));
-void SPU_flushboot(void);
-int SPUinit(void);
-int SPUopen(void);
-int SPUclose(void);
-int SPUshutdown(void);
-void SPUinjectRAMImage(u16 *pIncoming);
-void SPUreadDMAMem(u32 usPSXMem,int iSize);
-void SPUwriteDMAMem(u32 usPSXMem,int iSize);
-u16 SPUreadRegister(u32 reg);
+#ifndef PEOPS_SPU_H
+#define PEOPS_SPU_H
 
+#include "../eng_protos.h"
+#include "../peops/externals.h"
+
+class SPU
+{
+public:
+ SPU(PSFContext *ctx) : ctx(ctx) {}
+
+ int SPUasync(u32 cycles, psf_update_func update);
+ int SPUinit(void);
+ int SPUopen(void);
+ int SPUclose(void);
+ int SPUshutdown(void);
+ void SPUinjectRAMImage(u16 *pIncoming);
+ void SPUreadDMAMem(u32 usPSXMem,int iSize);
+ void SPUwriteDMAMem(u32 usPSXMem,int iSize);
+ void SPUwriteRegister(u32 reg, u16 val);
+ u16 SPUreadRegister(u32 reg);
+ void SPUgetState(ao_state &state);
+
+ int psf_seek(u32 t);
+ u32 psf_tell(void);
+ void setlength(s32 stop, s32 fade);
+
+private:
+ PSFContext *ctx;
+
+ // psx buffer / addresses
+
+ u16  regArea[0x200] {};
+ u16  spuMem[256*1024] {};
+ u8 * spuMemC = nullptr;
+ u8 * pSpuIrq = nullptr;
+ u8 * pSpuBuffer = nullptr;
+
+ // user settings
+ int             iVolume = 0;
+
+ // MAIN infos struct for each channel
+
+ SPUCHAN         s_chan[MAXCHAN+1] {};                  // channel + 1 infos (1 is security for fmod handling)
+ REVERBInfo      rvb {};
+
+ // what every channel adds to the current sample: the channel loop fills
+ // these in, MixChannels() sums them up for all channels at once
+ struct
+  {
+   s32 sval[MAXCHAN];                                   // 0 if the channel is silent
+   s32 volL[MAXCHAN], volR[MAXCHAN];
+   s32 rvb[MAXCHAN];                                    // ~0 if the channel goes to reverb, else 0
+  } mix {};
+
+ u32   dwNoiseVal=1;                                    // global noise generator
+
+ u16  spuCtrl=0;                                        // some vars to store psx reg infos
+ u16  spuStat=0;
+ u16  spuIrq=0;
+ u32  spuAddr=0xffffffff;                               // address into spu mem
+ int  bSPUIsOpen=0;
+
+ s16 * pS = nullptr;
+ s32 ttemp = 0;
+ s32 dosampies = 0;
+
+ u32 sampcount = 0;
+ u32 decaybegin = 0;
+ u32 decayend = 0;
+ u32 seektime = 0;
+
+ // reverb resampling buffers, part of the saved state
+ s32 downbuf[2][8] {};
+ s32 upbuf[2][8] {};
+ int dbpos=0,ubpos=0;
+
+ u32 RateTable[160] {};
+
+ void StartSound(int ch);
+ void MixChannels(s32 &sl, s32 &sr, s32 &revLeft, s32 &revRight);
+ void SetupStreams(void);
+ void RemoveStreams(void);
+
+ // reverb.cc
+ s64 g_buffer(int iOff);
+ void s_buffer(int iOff,int iVal);
+ void s_buffer1(int iOff,int iVal);
+ void MixREVERBLeftRight(s32 *oleft, s32 *oright, s32 inleft, s32 inright);
+
+ // adsr.cc
+ void InitADSR(void);
+ void StartADSR(int ch);
+ int MixADSR(int ch);
+
+ // registers.cc
+ void SoundOn(int start,int end,u16 val);
+ void SoundOff(int start,int end,u16 val);
+ void FModOn(int start,int end,u16 val);
+ void NoiseOn(int start,int end,u16 val);
+ void SetVolumeLR(int right, u8 ch,s16 vol);
+ void SetPitch(int ch,u16 val);
+};
+
+// entry points for the PSX hardware, which can't include this header
+u16 SPUreadRegister(SPU *spu, u32 reg);
+void SPUwriteRegister(SPU *spu, u32 reg, u16 val);
+void SPUreadDMAMem(SPU *spu, u32 usPSXMem, int iSize);
+void SPUwriteDMAMem(SPU *spu, u32 usPSXMem, int iSize);
+
+#endif
@@ -41,9 +41,7 @@
 // ADSR func
 ////////////////////////////////////////////////////////////////////////
 
-unsigned long RateTable[160];
-
-void InitADSR(void)                                    // INIT ADSR
+void SPU2::InitADSR(void)                              // INIT ADSR
 {
  unsigned long r,rs,rd;int i;
 
@@ -66,7 +64,7 @@ void InitADSR(void)                                    // INIT ADSR
 
 ////////////////////////////////////////////////////////////////////////
 
-void StartADSR(int ch)                          // MIX ADSR
+void SPU2::StartADSR(int ch)                    // MIX ADSR
 {
  s_chan[ch].ADSRX.lVolume=1;                           // and init some adsr vars
  s_chan[ch].ADSRX.State=0;
@@ -75,7 +73,7 @@ void StartADSR(int ch)                          // MIX ADSR
 
 ////////////////////////////////////////////////////////////////////////
 
-int MixADSR(int ch)                             // MIX ADSR
+int SPU2::MixADSR(int ch)                       // MIX ADSR
 {
  if(s_chan[ch].bStop)                                  // should be stopped:
   {                                                    // do release
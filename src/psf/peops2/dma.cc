@@ -33,18 +33,19 @@
 
 #include "../peops2/externals.h"
 #include "../peops2/registers.h"
+#include "../peops2/spu.h"
+#include "../cpuintrf.h"
+#include "../psx.h"
 //#include "debug.h"
 
-extern uint32_t psx_ram[(2*1024*1024)/4];
-
 ////////////////////////////////////////////////////////////////////////
 // READ DMA (many values)
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2readDMA4Mem(u32 usPSXMem,int iSize)
+EXPORT_GCC void CALLBACK SPU2::SPU2readDMA4Mem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
@@ -64,10 +65,10 @@ EXPORT_GCC void CALLBACK SPU2readDMA4Mem(u32 usPSXMem,int iSize)
  spuStat2[0]=0x80;                                     // DMA complete
 }
 
-EXPORT_GCC void CALLBACK SPU2readDMA7Mem(u32 usPSXMem,int iSize)
+EXPORT_GCC void CALLBACK SPU2::SPU2readDMA7Mem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
@@ -98,10 +99,10 @@ EXPORT_GCC void CALLBACK SPU2readDMA7Mem(u32 usPSXMem,int iSize)
 // WRITE DMA (many values)
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2writeDMA4Mem(u32 usPSXMem,int iSize)
+EXPORT_GCC void CALLBACK SPU2::SPU2writeDMA4Mem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
@@ -117,10 +118,10 @@ EXPORT_GCC void CALLBACK SPU2writeDMA4Mem(u32 usPSXMem,int iSize)
  spuStat2[0]=0x80;                                     // DMA complete
 }
 
-EXPORT_GCC void CALLBACK SPU2writeDMA7Mem(u32 usPSXMem,int iSize)
+EXPORT_GCC void CALLBACK SPU2::SPU2writeDMA7Mem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&ctx->psx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
@@ -139,7 +140,7 @@ EXPORT_GCC void CALLBACK SPU2writeDMA7Mem(u32 usPSXMem,int iSize)
 // INTERRUPTS
 ////////////////////////////////////////////////////////////////////////
 
-void InterruptDMA4(void)
+void SPU2::InterruptDMA4(void)
 {
 // taken from linuzappz nullptr spu2
 //	spu2Rs16(CORE0_ATTR)&= ~0x30;
@@ -151,12 +152,12 @@ void InterruptDMA4(void)
  spuStat2[0]|=0x80;
 }
 
-EXPORT_GCC void CALLBACK SPU2interruptDMA4(void)
+EXPORT_GCC void CALLBACK SPU2::SPU2interruptDMA4(void)
 {
  InterruptDMA4();
 }
 
-void InterruptDMA7(void)
+void SPU2::InterruptDMA7(void)
 {
 // taken from linuzappz nullptr spu2
 //	spu2Rs16(CORE1_ATTR)&= ~0x30;
@@ -168,8 +169,16 @@ void InterruptDMA7(void)
  spuStat2[1]|=0x80;
 }
 
-EXPORT_GCC void CALLBACK SPU2interruptDMA7(void)
+EXPORT_GCC void CALLBACK SPU2::SPU2interruptDMA7(void)
 {
  InterruptDMA7();
 }
 
+////////////////////////////////////////////////////////////////////////
+
+void SPU2readDMA4Mem(SPU2 *spu2, u32 usPSXMem, int iSize) { spu2->SPU2readDMA4Mem(usPSXMem, iSize); }
+void SPU2readDMA7Mem(SPU2 *spu2, u32 usPSXMem, int iSize) { spu2->SPU2readDMA7Mem(usPSXMem, iSize); }
+void SPU2writeDMA4Mem(SPU2 *spu2, u32 usPSXMem, int iSize) { spu2->SPU2writeDMA4Mem(usPSXMem, iSize); }
+void SPU2writeDMA7Mem(SPU2 *spu2, u32 usPSXMem, int iSize) { spu2->SPU2writeDMA7Mem(usPSXMem, iSize); }
+void SPU2interruptDMA4(SPU2 *spu2) { spu2->SPU2interruptDMA4(); }
+void SPU2interruptDMA7(SPU2 *spu2) { spu2->SPU2interruptDMA7(); }
@@ -43,8 +43,7 @@
 
 #include "../peops2/externals.h"
 #include "../peops2/registers.h"
-#include "../peops2/regs.h"
-#include "../peops2/reverb.h"
+#include "../peops2/spu.h"
 
 /*
 // adsr time values (in ms) by James Higgs ... see the end of
@@ -64,18 +63,11 @@
 #define SUSTAIN_MS     441L
 #define RELEASE_MS     437L
 
-// Prototypes
-void SetVolumeL(unsigned char ch,short vol);
-void SetVolumeR(unsigned char ch,short vol);
-void ReverbOn(int start,int end,unsigned short val,int iRight);
-void SetReverbAddr(int core);
-void VolumeOn(int start,int end,unsigned short val,int iRight);
-
 ////////////////////////////////////////////////////////////////////////
 // WRITE REGISTERS: called by main emu
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
+EXPORT_GCC void CALLBACK SPU2::SPU2write(unsigned long reg, unsigned short val)
 {
  long r=reg&0xffff;
 
@@ -786,7 +778,7 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
 // READ REGISTER: called by main emu
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
+EXPORT_GCC unsigned short CALLBACK SPU2::SPU2read(unsigned long reg)
 {
  long r=reg&0xffff;
 
@@ -906,7 +898,7 @@ EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
  return regArea[r>>1];
 }
 
-EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
+EXPORT_GCC void CALLBACK SPU2::SPU2writePS1Port(unsigned long reg, unsigned short val)
 {
  const u32 r=reg&0xfff;
 
@@ -1070,7 +1062,7 @@ EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
    }
 }
 
-EXPORT_GCC unsigned short CALLBACK SPU2readPS1Port(unsigned long reg)
+EXPORT_GCC unsigned short CALLBACK SPU2::SPU2readPS1Port(unsigned long reg)
 {
  const u32 r=reg&0xfff;
 
@@ -1114,7 +1106,7 @@ EXPORT_GCC unsigned short CALLBACK SPU2readPS1Port(unsigned long reg)
 // SOUND ON register write
 ////////////////////////////////////////////////////////////////////////
 
-void SoundOn(int start,int end,unsigned short val)     // SOUND ON PSX COMAND
+void SPU2::SoundOn(int start,int end,unsigned short val) // SOUND ON PSX COMAND
 {
  int ch;
 
@@ -1133,7 +1125,7 @@ void SoundOn(int start,int end,unsigned short val)     // SOUND ON PSX COMAND
 // SOUND OFF register write
 ////////////////////////////////////////////////////////////////////////
 
-void SoundOff(int start,int end,unsigned short val)    // SOUND OFF PSX COMMAND
+void SPU2::SoundOff(int start,int end,unsigned short val) // SOUND OFF PSX COMMAND
 {
  int ch;
  for(ch=start;ch<end;ch++,val>>=1)                     // loop channels
@@ -1149,7 +1141,7 @@ void SoundOff(int start,int end,unsigned short val)    // SOUND OFF PSX COMMAND
 // FMOD register write
 ////////////////////////////////////////////////////////////////////////
 
-void FModOn(int start,int end,unsigned short val)      // FMOD ON PSX COMMAND
+void SPU2::FModOn(int start,int end,unsigned short val) // FMOD ON PSX COMMAND
 {
  int ch;
 
@@ -1174,7 +1166,7 @@ void FModOn(int start,int end,unsigned short val)      // FMOD ON PSX COMMAND
 // NOISE register write
 ////////////////////////////////////////////////////////////////////////
 
-void NoiseOn(int start,int end,unsigned short val)     // NOISE ON PSX COMMAND
+void SPU2::NoiseOn(int start,int end,unsigned short val) // NOISE ON PSX COMMAND
 {
  int ch;
 
@@ -1198,7 +1190,7 @@ void NoiseOn(int start,int end,unsigned short val)     // NOISE ON PSX COMMAND
 // please note: sweep and phase invert are wrong... but I've never seen
 // them used
 
-void SetVolumeL(unsigned char ch,short vol)            // LEFT VOLUME
+void SPU2::SetVolumeL(unsigned char ch,short vol)      // LEFT VOLUME
 {
  s_chan[ch].iLeftVolRaw=vol;
 
@@ -1226,7 +1218,7 @@ void SetVolumeL(unsigned char ch,short vol)            // LEFT VOLUME
 // RIGHT VOLUME register write
 ////////////////////////////////////////////////////////////////////////
 
-void SetVolumeR(unsigned char ch,short vol)            // RIGHT VOLUME
+void SPU2::SetVolumeR(unsigned char ch,short vol)      // RIGHT VOLUME
 {
  s_chan[ch].iRightVolRaw=vol;
 
@@ -1253,7 +1245,7 @@ void SetVolumeR(unsigned char ch,short vol)            // RIGHT VOLUME
 // PITCH register write
 ////////////////////////////////////////////////////////////////////////
 
-void SetPitch(int ch,unsigned short val)               // SET PITCH
+void SPU2::SetPitch(int ch,unsigned short val)         // SET PITCH
 {
  int NP;
  double intr;
@@ -1276,7 +1268,7 @@ void SetPitch(int ch,unsigned short val)               // SET PITCH
 // REVERB register write
 ////////////////////////////////////////////////////////////////////////
 
-void ReverbOn(int start,int end,unsigned short val,int iRight)  // REVERB ON PSX COMMAND
+void SPU2::ReverbOn(int start,int end,unsigned short val,int iRight) // REVERB ON PSX COMMAND
 {
  int ch;
 
@@ -1299,7 +1291,7 @@ void ReverbOn(int start,int end,unsigned short val,int iRight)  // REVERB ON PSX
 // REVERB START register write
 ////////////////////////////////////////////////////////////////////////
 
-void SetReverbAddr(int core)
+void SPU2::SetReverbAddr(int core)
 {
  long val=spuRvbAddr2[core];
 
@@ -1321,7 +1313,7 @@ void SetReverbAddr(int core)
 // DRY LEFT/RIGHT per voice switches
 ////////////////////////////////////////////////////////////////////////
 
-void VolumeOn(int start,int end,unsigned short val,int iRight)  // VOLUME ON PSX COMMAND
+void SPU2::VolumeOn(int start,int end,unsigned short val,int iRight) // VOLUME ON PSX COMMAND
 {
  int ch;
 
@@ -1340,4 +1332,7 @@ void VolumeOn(int start,int end,unsigned short val,int iRight)  // VOLUME ON PSX
   }
 }
 
+////////////////////////////////////////////////////////////////////////
 
+void SPU2write(SPU2 *spu2, unsigned long reg, unsigned short val) { spu2->SPU2write(reg, val); }
+unsigned short SPU2read(SPU2 *spu2, unsigned long reg) { return spu2->SPU2read(reg); }
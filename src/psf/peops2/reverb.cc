@@ -43,21 +43,11 @@
 // will be included from spu.c
 #ifdef _IN_SPU
 
-////////////////////////////////////////////////////////////////////////
-// globals
-////////////////////////////////////////////////////////////////////////
-
-// REVERB info and timing vars...
-
-int *          sRVBPlay[2];
-int *          sRVBEnd[2];
-int *          sRVBStart[2];
-
 ////////////////////////////////////////////////////////////////////////
 // START REVERB
 ////////////////////////////////////////////////////////////////////////
 
-void StartREVERB(int ch)
+void SPU2::StartREVERB(int ch)
 {
  int core=ch/24;
 
@@ -72,7 +62,7 @@ void StartREVERB(int ch)
 // HELPER FOR NEILL'S REVERB: re-inits our reverb mixing buf
 ////////////////////////////////////////////////////////////////////////
 
-static inline void InitREVERB(void)
+inline void SPU2::InitREVERB(void)
 {
  if(iUseReverb==1)
   {
@@ -81,31 +71,9 @@ static inline void InitREVERB(void)
   }
 }
 
-////////////////////////////////////////////////////////////////////////
-// STORE REVERB
-////////////////////////////////////////////////////////////////////////
-
-void StoreREVERB(int ch,int ns)
-{
- int core=ch/24;
-
- if(iUseReverb==0) return;
- else
- if(iUseReverb==1) // -------------------------------- // Neil's reverb
-  {
-   const int iRxl=(s_chan[ch].sval*s_chan[ch].iLeftVolume*s_chan[ch].bReverbL)/0x4000;
-   const int iRxr=(s_chan[ch].sval*s_chan[ch].iRightVolume*s_chan[ch].bReverbR)/0x4000;
-
-   ns<<=1;
-
-   *(sRVBStart[core]+ns)  +=iRxl;                      // -> we mix all active reverb channels into an extra buffer
-   *(sRVBStart[core]+ns+1)+=iRxr;
-  }
-}
-
 ////////////////////////////////////////////////////////////////////////
 
-static inline int g_buffer(int iOff,int core)                   // get_buffer content helper: takes care about wraps
+inline int SPU2::g_buffer(int iOff,int core)                    // get_buffer content helper: takes care about wraps
 {
  short * p=(short *)spuMem;
  iOff=(iOff)+rvb[core].CurrAddr;
@@ -116,7 +84,7 @@ static inline int g_buffer(int iOff,int core)                   // get_buffer co
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void s_buffer(int iOff,int iVal,int core)        // set_buffer content helper: takes care about wraps and clipping
+inline void SPU2::s_buffer(int iOff,int iVal,int core)         // set_buffer content helper: takes care about wraps and clipping
 {
  short * p=(short *)spuMem;
  iOff=(iOff)+rvb[core].CurrAddr;
@@ -129,7 +97,7 @@ static inline void s_buffer(int iOff,int iVal,int core)        // set_buffer con
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void s_buffer1(int iOff,int iVal,int core)      // set_buffer (+1 sample) content helper: takes care about wraps and clipping
+inline void SPU2::s_buffer1(int iOff,int iVal,int core)       // set_buffer (+1 sample) content helper: takes care about wraps and clipping
 {
  short * p=(short *)spuMem;
  iOff=(iOff)+rvb[core].CurrAddr+1;
@@ -142,7 +110,7 @@ static inline void s_buffer1(int iOff,int iVal,int core)      // set_buffer (+1
 
 ////////////////////////////////////////////////////////////////////////
 
-int MixREVERBLeft(int ns,int core)
+int SPU2::MixREVERBLeft(int ns,int core)
 {
  if(iUseReverb==1)
   {
@@ -229,7 +197,7 @@ int MixREVERBLeft(int ns,int core)
 
 ////////////////////////////////////////////////////////////////////////
 
-int MixREVERBRight(int core)
+int SPU2::MixREVERBRight(int core)
 {
  if(iUseReverb==1)                                     // Neill's reverb:
   {
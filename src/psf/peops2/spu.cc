@@ -100,71 +100,13 @@
 #define _IN_SPU
 
 #include "../peops2/externals.h"
-#include "../peops2/regs.h"
-#include "../peops2/dma.h"
+#include "../peops2/spu.h"
 
-////////////////////////////////////////////////////////////////////////
-// globals
-////////////////////////////////////////////////////////////////////////
-
-// psx buffer / addresses
-
-unsigned short  regArea[32*1024];
-unsigned short  spuMem[1*1024*1024];
-unsigned char * spuMemC;
-unsigned char * pSpuIrq[2];
-unsigned char * pSpuBuffer;
-
-// user settings
-
-int             iUseXA=0;
-int             iXAPitch=1;
-int             iUseTimer=2;
-int             iSPUIRQWait=1;
-int             iDebugMode=0;
-int             iRecordMode=0;
-int             iUseReverb=1;
-int             iUseInterpolation=2;
-
-// MAIN infos struct for each channel
-
-SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
-REVERBInfo      rvb[2];
-
-unsigned long   dwNoiseVal=1;                          // global noise generator
-
-unsigned short  spuCtrl2[2];                           // some vars to store psx reg infos
-unsigned short  spuStat2[2];
-unsigned long   spuIrq2[2];
-unsigned long   spuAddr2[2];                           // address into spu mem
-unsigned long   spuRvbAddr2[2];
-unsigned long   spuRvbAEnd2[2];
-int             bEndThread=0;                          // thread handlers
-int             bThreadEnded=0;
-int             bSpuInit=0;
-int             bSPUIsOpen=0;
-
-unsigned long dwNewChannel2[2];                        // flags for faster testing, if new channel starts
-unsigned long dwEndChannel2[2];
-
-// UNUSED IN PS2 YET
-void (CALLBACK *irqCallback)(void)=0;                  // func of main emu, called on spu irq
-void (CALLBACK *cddavCallback)(unsigned short,unsigned short)=0;
-
-// certain globals (were local before, but with the new timeproc I need em global)
-
-const int f[5][2] = {   {    0,  0  },
+static const int f[5][2] = {   {    0,  0  },
                         {   60,  0  },
                         {  115, -52 },
                         {   98, -55 },
                         {  122, -60 } };
-int SSumR[NSSIZE];
-int SSumL[NSSIZE];
-int iCycle=0;
-short * pS;
-
-static int lastch=-1;      // last channel processed on spu irq in timer mode
-static int iSecureStart=0; // secure start counter
 
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
@@ -218,7 +160,7 @@ static int iSecureStart=0; // secure start counter
 //
 
 
-static inline void InterpolateUp(int ch)
+inline void SPU2::InterpolateUp(int ch)
 {
  if(s_chan[ch].SB[32]==1)                              // flag == 1? calc step and set flag... and don't change the value in this pass
   {
@@ -266,7 +208,7 @@ static inline void InterpolateUp(int ch)
 // even easier interpolation on downsampling, also no special filter, again just "Pete's common sense" tm
 //
 
-static inline void InterpolateDown(int ch)
+inline void SPU2::InterpolateDown(int ch)
 {
  if(s_chan[ch].sinc>=0x20000L)                                 // we would skip at least one val?
   {
@@ -292,7 +234,7 @@ static inline void InterpolateDown(int ch)
 // START SOUND... called by main thread to setup a new sound on a channel
 ////////////////////////////////////////////////////////////////////////
 
-static inline void StartSound(int ch)
+inline void SPU2::StartSound(int ch)
 {
  dwNewChannel2[ch/24]&=~(1<<(ch%24));                  // clear new channel bit
  dwEndChannel2[ch/24]&=~(1<<(ch%24));                  // clear end channel bit
@@ -318,26 +260,54 @@ static inline void StartSound(int ch)
  else {s_chan[ch].spos=0x10000L;s_chan[ch].SB[31]=0;}  // -> no/simple interpolation starts with one 44100 decoding
 }
 
+////////////////////////////////////////////////////////////////////////
+// MIX CHANNELS... adds up what the channel loop has collected for this
+// sample. No branches in here, so the compiler can use SIMD for it.
+////////////////////////////////////////////////////////////////////////
+
+inline void SPU2::MixChannels(void)
+{
+ int core,ch;
+
+ for(core=0;core<2;core++)
+  {
+   int l=0,r=0,rl=0,rr=0;
+
+   for(ch=core*24;ch<core*24+24;ch++)
+    {
+     l +=(mix.sval[ch]*mix.volL[ch])/0x4000;
+     r +=(mix.sval[ch]*mix.volR[ch])/0x4000;
+     rl+=(mix.sval[ch]*mix.rvbL[ch])/0x4000;           // -> we mix all active reverb channels into an extra buffer
+     rr+=(mix.sval[ch]*mix.rvbR[ch])/0x4000;
+    }
+
+   SSumL[0]+=l;
+   SSumR[0]+=r;
+   sRVBStart[core][0]+=rl;
+   sRVBStart[core][1]+=rr;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // MAIN SPU FUNCTION
 // here is the main job handler... thread, timer or direct func call
 // basically the whole sound processing is done in this fat func!
 ////////////////////////////////////////////////////////////////////////
 
-static u32 sampcount;
-static u32 decaybegin;
-static u32 decayend;
-
-static u32 seektime;
-int psf2_seek(u32 t)
+int SPU2::psf2_seek(u32 t)
 {
  seektime=t*441/10;
  if(seektime>=sampcount) return(1);
  return(0);
 }
 
+u32 SPU2::psf2_tell(void)
+{
+ return (u32)((u64)sampcount*10/441);
+}
+
 // Counting to 65536 results in full volume offage.
-void setlength2(s32 stop, s32 fade)
+void SPU2::setlength2(s32 stop, s32 fade)
 {
  if(stop==~0)
  {
@@ -361,9 +331,7 @@ void setlength2(s32 stop, s32 fade)
 
 ////////////////////////////////////////////////////////////////////////
 
-int iSpuAsyncWait=0;
-
-static void *MAINThread(void (*update)(const void *, int))
+void *SPU2::MAINThread(psf_update_func update)
 {
  int s_1,s_2,fa;
  unsigned char * start;unsigned int nSample;
@@ -418,6 +386,8 @@ static void *MAINThread(void (*update)(const void *, int))
    //- main channel loop                              -//
    //--------------------------------------------------//
     {
+     memset(mix.sval,0,sizeof(mix.sval));              // channels which don't play add nothing
+
      for(ch=0;ch<MAXCHAN;ch++)                         // loop em all... we will collect 1 ms of sound of each playing channel
       {
        if(s_chan[ch].bNew) StartSound(ch);             // start new sound
@@ -695,18 +665,20 @@ GOON: ;
 
            if(s_chan[ch].iMute)
             s_chan[ch].sval=0;                         // debug mute
-           else
-            {
-             if(s_chan[ch].bVolumeL)
-              SSumL[0]+=(s_chan[ch].sval*s_chan[ch].iLeftVolume)/0x4000L;
-             if(s_chan[ch].bVolumeR)
-              SSumR[0]+=(s_chan[ch].sval*s_chan[ch].iRightVolume)/0x4000L;
-            }
+
+           mix.sval[ch]=s_chan[ch].sval;               // -> mixed by MixChannels, with all other channels
+           mix.volL[ch]=s_chan[ch].bVolumeL ? s_chan[ch].iLeftVolume : 0;
+           mix.volR[ch]=s_chan[ch].bVolumeR ? s_chan[ch].iRightVolume : 0;
 
            //////////////////////////////////////////////
            // now let us store sound data for reverb
 
-           if(s_chan[ch].bRVBActive) StoreREVERB(ch,0);
+           if(iUseReverb==1 && s_chan[ch].bRVBActive)  // Neil's reverb
+            {
+             mix.rvbL[ch]=s_chan[ch].iLeftVolume*s_chan[ch].bReverbL;
+             mix.rvbR[ch]=s_chan[ch].iRightVolume*s_chan[ch].bReverbR;
+            }
+           else mix.rvbL[ch]=mix.rvbR[ch]=0;
           }
 
          ////////////////////////////////////////////////
@@ -726,6 +698,8 @@ ENDX:   ;
   ///////////////////////////////////////////////////////
   // mix all channels (including reverb) into one buffer
 
+    MixChannels();
+
     SSumL[0]+=MixREVERBLeft(0,0);
     SSumL[0]+=MixREVERBLeft(0,1);
     SSumR[0]+=MixREVERBRight(0);
@@ -747,7 +721,7 @@ ENDX:   ;
        {
         if(sampcount>=decayend)
          {
-          update(nullptr, 0);
+          update(ctx, nullptr, 0);
           return(0);
          }
 
@@ -785,7 +759,7 @@ ENDX:   ;
      }
 
     if(iSilenceCount < 20)
-     update((u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
+     update(ctx, (u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
 
     pS=(short *)pSpuBuffer;
    }
@@ -807,7 +781,7 @@ ENDX:   ;
 //  1 time every 'cycle' cycles... harhar
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2async(void (*update)(const void *, int))
+EXPORT_GCC void CALLBACK SPU2::SPU2async(psf_update_func update)
 {
  if(iSpuAsyncWait)
   {
@@ -818,6 +792,44 @@ EXPORT_GCC void CALLBACK SPU2async(void (*update)(const void *, int))
  MAINThread(update);                                      // -> linux high-compat mode
 }
 
+////////////////////////////////////////////////////////////////////////
+// SPU2GETSTATE: lists the spu variables for saving/restoring the state
+////////////////////////////////////////////////////////////////////////
+
+void SPU2::SPU2getState(ao_state &state)
+{
+ AO_STATE_ADD(state, regArea);
+ AO_STATE_ADD(state, spuMem);
+ AO_STATE_ADD(state, pSpuIrq);
+ AO_STATE_ADD(state, s_chan);
+ AO_STATE_ADD(state, rvb);
+ AO_STATE_ADD(state, dwNoiseVal);
+ AO_STATE_ADD(state, spuCtrl2);
+ AO_STATE_ADD(state, spuStat2);
+ AO_STATE_ADD(state, spuIrq2);
+ AO_STATE_ADD(state, spuAddr2);
+ AO_STATE_ADD(state, spuRvbAddr2);
+ AO_STATE_ADD(state, spuRvbAEnd2);
+ AO_STATE_ADD(state, dwNewChannel2);
+ AO_STATE_ADD(state, dwEndChannel2);
+ AO_STATE_ADD(state, SSumR);
+ AO_STATE_ADD(state, SSumL);
+ AO_STATE_ADD(state, mix);
+ AO_STATE_ADD(state, iCycle);
+ AO_STATE_ADD(state, pS);
+ AO_STATE_ADD(state, lastch);
+ AO_STATE_ADD(state, iSecureStart);
+ AO_STATE_ADD(state, iSpuAsyncWait);
+ AO_STATE_ADD(state, sampcount);
+ AO_STATE_ADD(state, seektime);
+ AO_STATE_ADD(state, sRVBPlay);
+ state.append(ao_state_region{sRVBStart[0], NSSIZE*2*sizeof(int)});
+ state.append(ao_state_region{sRVBStart[1], NSSIZE*2*sizeof(int)});
+
+ // samples not yet passed to update()
+ state.append(ao_state_region{pSpuBuffer, 735*4});
+}
+
 ////////////////////////////////////////////////////////////////////////
 // INIT/EXIT STUFF
 ////////////////////////////////////////////////////////////////////////
@@ -827,7 +839,7 @@ EXPORT_GCC void CALLBACK SPU2async(void (*update)(const void *, int))
 ////////////////////////////////////////////////////////////////////////
 
 
-EXPORT_GCC long CALLBACK SPU2init(void)
+EXPORT_GCC long CALLBACK SPU2::SPU2init(void)
 {
  spuMemC=(unsigned char *)spuMem;                      // just small setup
  memset((void *)s_chan,0,MAXCHAN*sizeof(SPUCHAN));
@@ -845,7 +857,7 @@ EXPORT_GCC long CALLBACK SPU2init(void)
 // SETUPTIMER: init of certain buffers and threads/timers
 ////////////////////////////////////////////////////////////////////////
 
-static void SetupTimer(void)
+void SPU2::SetupTimer(void)
 {
  memset(SSumR,0,NSSIZE*sizeof(int));                   // init some mixing buffers
  memset(SSumL,0,NSSIZE*sizeof(int));
@@ -860,7 +872,7 @@ static void SetupTimer(void)
 // REMOVETIMER: kill threads/timers
 ////////////////////////////////////////////////////////////////////////
 
-static void RemoveTimer(void)
+void SPU2::RemoveTimer(void)
 {
  bEndThread=1;                                         // raise flag to end thread
  bThreadEnded=0;                                       // no more spu is running
@@ -871,7 +883,7 @@ static void RemoveTimer(void)
 // SETUPSTREAMS: init most of the spu buffers
 ////////////////////////////////////////////////////////////////////////
 
-static void SetupStreams(void)
+void SPU2::SetupStreams(void)
 {
  int i;
 
@@ -906,7 +918,7 @@ static void SetupStreams(void)
 // REMOVESTREAMS: free most buffer
 ////////////////////////////////////////////////////////////////////////
 
-static void RemoveStreams(void)
+void SPU2::RemoveStreams(void)
 {
  free(pSpuBuffer);                                     // free mixing buffer
  pSpuBuffer=nullptr;
@@ -932,7 +944,7 @@ static void RemoveStreams(void)
 // SPUOPEN: called by main emu after init
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC long CALLBACK SPU2open(void *pDsp)
+EXPORT_GCC long CALLBACK SPU2::SPU2open(void *pDsp)
 {
  if(bSPUIsOpen) return 0;                              // security for some stupid main emus
 
@@ -980,7 +992,7 @@ EXPORT_GCC long CALLBACK SPU2open(void *pDsp)
 // SPUCLOSE: called before shutdown
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2close(void)
+EXPORT_GCC void CALLBACK SPU2::SPU2close(void)
 {
  if(!bSPUIsOpen) return;                               // some security
 
@@ -997,7 +1009,7 @@ EXPORT_GCC void CALLBACK SPU2close(void)
 // SPUSHUTDOWN: called by main emu on final exit
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC void CALLBACK SPU2shutdown(void)
+EXPORT_GCC void CALLBACK SPU2::SPU2shutdown(void)
 {
  return;
 }
@@ -1006,7 +1018,7 @@ EXPORT_GCC void CALLBACK SPU2shutdown(void)
 // SPUTEST: we don't test, we are always fine ;)
 ////////////////////////////////////////////////////////////////////////
 
-EXPORT_GCC long CALLBACK SPU2test(void)
+EXPORT_GCC long CALLBACK SPU2::SPU2test(void)
 {
  return 0;
 }
@@ -1018,19 +1030,19 @@ EXPORT_GCC long CALLBACK SPU2test(void)
 ////////////////////////////////////////////////////////////////////////
 
 // not used yet
-EXPORT_GCC void CALLBACK SPU2irqCallback(void (CALLBACK *callback)(void))
+EXPORT_GCC void CALLBACK SPU2::SPU2irqCallback(void (CALLBACK *callback)(void))
 {
  irqCallback = callback;
 }
 
 // not used yet
-EXPORT_GCC void CALLBACK SPU2registerCallback(void (CALLBACK *callback)(void))
+EXPORT_GCC void CALLBACK SPU2::SPU2registerCallback(void (CALLBACK *callback)(void))
 {
  irqCallback = callback;
 }
 
 // not used yet
-EXPORT_GCC void CALLBACK SPU2registerCDDAVolume(void (CALLBACK *CDDAVcallback)(unsigned short,unsigned short))
+EXPORT_GCC void CALLBACK SPU2::SPU2registerCDDAVolume(void (CALLBACK *CDDAVcallback)(unsigned short,unsigned short))
 {
  cddavCallback = CDDAVcallback;
 }
@@ -1,39 +1,201 @@
-/***************************************************************************
-                            spu.h  -  description
-                             -------------------
-    begin                : Wed May 15 2002
-    copyright            : (C) 2002 by Pete Bernert
-    email                : BlackDove@addcom.de
- ***************************************************************************/
-
-/***************************************************************************
- *                                                                         *
- *   This program is free software; you can redistribute it and/or modify  *
- *   it under the terms of the GNU General Public License as published by  *
- *   the Free Software Foundation; either version 2 of the License, or     *
- *   (at your option) any later version. See also the license.txt file for *
- *   additional informations.                                              *
- *                                                                         *
- ***************************************************************************/
-
-//*************************************************************************//
-// History of changes:
-//
-// 2004/04/04 - Pete
-// - changed plugin to emulate PS2 spu
-//
-// 2002/05/15 - Pete
-// - generic cleanup for the Peops release
-//
-//*************************************************************************//
-
-
-void SetupTimer(void);
-void RemoveTimer(void);
-EXPORT_GCC void CALLBACK SPU2playADPCMchannel(xa_decode_t *xap);
-
-EXPORT_GCC long CALLBACK SPU2init(void);
-EXPORT_GCC long CALLBACK SPU2open(void *pDsp);
-EXPORT_GCC void CALLBACK SPU2async(void (*update)(const void *, int));
-EXPORT_GCC void CALLBACK SPU2close(void);
-EXPORT_GCC int  CALLBACK psf2_seek(u32 t);
+/***************************************************************************
+                            spu.h  -  description
+                             -------------------
+    begin                : Wed May 15 2002
+    copyright            : (C) 2002 by Pete Bernert
+    email                : BlackDove@addcom.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version. See also the license.txt file for *
+ *   additional informations.                                              *
+ *                                                                         *
+ ***************************************************************************/
+
+//*************************************************************************//
+// History of changes:
+//
+// 2004/04/04 - Pete
+// - changed plugin to emulate PS2 spu
+//
+// 2002/05/15 - Pete
+// - generic cleanup for the Peops release
+//
+//*************************************************************************//
+
+
+#ifndef PEOPS2_SPU_H
+#define PEOPS2_SPU_H
+
+#include "../eng_protos.h"
+#include "../peops2/externals.h"
+
+class SPU2
+{
+public:
+ SPU2(PSFContext *ctx) : ctx(ctx) {}
+
+ long SPU2init(void);
+ long SPU2open(void *pDsp);
+ void SPU2async(psf_update_func update);
+ void SPU2close(void);
+ void SPU2shutdown(void);
+ long SPU2test(void);
+ void SPU2irqCallback(void (CALLBACK *callback)(void));
+ void SPU2registerCallback(void (CALLBACK *callback)(void));
+ void SPU2registerCDDAVolume(void (CALLBACK *CDDAVcallback)(unsigned short,unsigned short));
+ void SPU2getState(ao_state &state);
+
+ int psf2_seek(u32 t);
+ u32 psf2_tell(void);
+ void setlength2(s32 stop, s32 fade);
+
+ // registers.cc
+ void SPU2write(unsigned long reg, unsigned short val);
+ unsigned short SPU2read(unsigned long reg);
+ void SPU2writePS1Port(unsigned long reg, unsigned short val);
+ unsigned short SPU2readPS1Port(unsigned long reg);
+
+ // dma.cc
+ void SPU2readDMA4Mem(u32 usPSXMem,int iSize);
+ void SPU2readDMA7Mem(u32 usPSXMem,int iSize);
+ void SPU2writeDMA4Mem(u32 usPSXMem,int iSize);
+ void SPU2writeDMA7Mem(u32 usPSXMem,int iSize);
+ void SPU2interruptDMA4(void);
+ void SPU2interruptDMA7(void);
+
+private:
+ PSFContext *ctx;
+
+ // psx buffer / addresses
+
+ unsigned short  regArea[32*1024] {};
+ unsigned short  spuMem[1*1024*1024] {};
+ unsigned char * spuMemC = nullptr;
+ unsigned char * pSpuIrq[2] {};
+ unsigned char * pSpuBuffer = nullptr;
+
+ // user settings
+
+ int             iUseXA=0;
+ int             iXAPitch=1;
+ int             iUseTimer=2;
+ int             iSPUIRQWait=1;
+ int             iDebugMode=0;
+ int             iRecordMode=0;
+ int             iUseReverb=1;
+ int             iUseInterpolation=2;
+
+ // MAIN infos struct for each channel
+
+ SPUCHAN         s_chan[MAXCHAN+1] {};                  // channel + 1 infos (1 is security for fmod handling)
+ REVERBInfo      rvb[2] {};
+
+ unsigned long   dwNoiseVal=1;                          // global noise generator
+
+ unsigned short  spuCtrl2[2] {};                        // some vars to store psx reg infos
+ unsigned short  spuStat2[2] {};
+ unsigned long   spuIrq2[2] {};
+ unsigned long   spuAddr2[2] {};                        // address into spu mem
+ unsigned long   spuRvbAddr2[2] {};
+ unsigned long   spuRvbAEnd2[2] {};
+ int             bEndThread=0;                          // thread handlers
+ int             bThreadEnded=0;
+ int             bSpuInit=0;
+ int             bSPUIsOpen=0;
+
+ unsigned long dwNewChannel2[2] {};                     // flags for faster testing, if new channel starts
+ unsigned long dwEndChannel2[2] {};
+
+ // UNUSED IN PS2 YET
+ void (CALLBACK *irqCallback)(void) = nullptr;          // func of main emu, called on spu irq
+ void (CALLBACK *cddavCallback)(unsigned short,unsigned short) = nullptr;
+
+ int SSumR[NSSIZE] {};
+ int SSumL[NSSIZE] {};
+
+ // what every channel adds to the current sample: the channel loop fills
+ // these in, MixChannels() sums them up for all channels at once
+ struct
+  {
+   int sval[MAXCHAN];                                   // 0 if the channel is silent
+   int volL[MAXCHAN], volR[MAXCHAN];                    // dry volume
+   int rvbL[MAXCHAN], rvbR[MAXCHAN];                    // reverb volume, 0 if no reverb
+  } mix {};
+ int iCycle=0;
+ short * pS = nullptr;
+
+ int lastch=-1;      // last channel processed on spu irq in timer mode
+ int iSecureStart=0; // secure start counter
+ int iSpuAsyncWait=0;
+
+ u32 sampcount = 0;
+ u32 decaybegin = 0;
+ u32 decayend = 0;
+ u32 seektime = 0;
+
+ // REVERB info and timing vars...
+
+ int *          sRVBPlay[2] {};
+ int *          sRVBEnd[2] {};
+ int *          sRVBStart[2] {};
+
+ unsigned long RateTable[160] {};
+
+ // spu.cc
+ void InterpolateUp(int ch);
+ void InterpolateDown(int ch);
+ void StartSound(int ch);
+ void MixChannels(void);
+ void *MAINThread(psf_update_func update);
+ void SetupTimer(void);
+ void RemoveTimer(void);
+ void SetupStreams(void);
+ void RemoveStreams(void);
+
+ // reverb.cc
+ void StartREVERB(int ch);
+ void InitREVERB(void);
+ int g_buffer(int iOff,int core);
+ void s_buffer(int iOff,int iVal,int core);
+ void s_buffer1(int iOff,int iVal,int core);
+ int MixREVERBLeft(int ns,int core);
+ int MixREVERBRight(int core);
+
+ // adsr.cc
+ void InitADSR(void);
+ void StartADSR(int ch);
+ int MixADSR(int ch);
+
+ // registers.cc
+ void SoundOn(int start,int end,unsigned short val);
+ void SoundOff(int start,int end,unsigned short val);
+ void VolumeOn(int start,int end,unsigned short val,int iRight);
+ void FModOn(int start,int end,unsigned short val);
+ void NoiseOn(int start,int end,unsigned short val);
+ void SetVolumeL(unsigned char ch,short vol);
+ void SetVolumeR(unsigned char ch,short vol);
+ void SetPitch(int ch,unsigned short val);
+ void ReverbOn(int start,int end,unsigned short val,int iRight);
+ void SetReverbAddr(int core);
+
+ // dma.cc
+ void InterruptDMA4(void);
+ void InterruptDMA7(void);
+};
+
+// entry points for the PSX hardware, which can't include this header
+void SPU2write(SPU2 *spu2, unsigned long reg, unsigned short val);
+unsigned short SPU2read(SPU2 *spu2, unsigned long reg);
+void SPU2readDMA4Mem(SPU2 *spu2, u32 usPSXMem, int iSize);
+void SPU2readDMA7Mem(SPU2 *spu2, u32 usPSXMem, int iSize);
+void SPU2writeDMA4Mem(SPU2 *spu2, u32 usPSXMem, int iSize);
+void SPU2writeDMA7Mem(SPU2 *spu2, u32 usPSXMem, int iSize);
+void SPU2interruptDMA4(SPU2 *spu2);
+void SPU2interruptDMA7(SPU2 *spu2);
+
+#endif
@@ -30,31 +30,43 @@
 
 #include <libaudcore/i18n.h>
 #include <libaudcore/plugin.h>
+#include <libaudcore/preferences.h>
 #include <libaudcore/audstrings.h>
 
 #include "ao.h"
 #include "corlett.h"
 #include "eng_protos.h"
+#include "lib_cache.h"
+#include "snapshot.h"
+#include "../pcm-cache/pcm-cache.h"
 
 class PSFPlugin : public InputPlugin
 {
 public:
     static const char *const exts[];
+    static const PreferencesWidget widgets[];
+    static const PluginPreferences prefs;
 
     static constexpr PluginInfo info = {
         N_("OpenPSF PSF1/PSF2 Decoder"),
-        PACKAGE
+        PACKAGE,
+        nullptr,
+        & prefs
     };
 
     constexpr PSFPlugin() : InputPlugin(info, InputInfo()
         .with_exts(exts)) {}
 
+    bool init();
+    void cleanup();
+
     bool is_our_file(const char *filename, VFSFile &file);
     bool read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *image);
     bool play(const char *filename, VFSFile &file);
 
 protected:
-    static void update(const void *data, int bytes);
+    static void update(PSFContext *ctx, const void *data, int bytes);
+    static void play_cached(PCMCacheReader &cache);
 };
 
 EXPORT PSFPlugin aud_plugin_instance;
@@ -68,28 +80,50 @@ typedef enum {
 } PSFEngine;
 
 typedef struct {
-    int32_t (*start)(uint8_t *buffer, uint32_t length);
-    int32_t (*stop)(void);
-    int32_t (*seek)(uint32_t);
-    int32_t (*execute)(void (*update)(const void *, int));
+    int32_t (*start)(PSFContext *ctx, uint8_t *buffer, uint32_t length);
+    int32_t (*stop)(PSFContext *ctx);
+    int32_t (*seek)(PSFContext *ctx, uint32_t);
+    int32_t (*execute)(PSFContext *ctx, psf_update_func update);
+    uint32_t (*tell)(PSFContext *ctx);
+    void (*get_state)(PSFContext *ctx, ao_state &);
 } PSFEngineFunctors;
 
 static PSFEngineFunctors psf_functor_map[ENG_COUNT] = {
-    {nullptr, nullptr, nullptr, nullptr},
-    {psf_start, psf_stop, psf_seek, psf_execute},
-    {psf2_start, psf2_stop, psf2_seek, psf2_execute},
-    {spx_start, spx_stop, psf_seek, spx_execute},
+    {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr},
+    {psf_start, psf_stop, psf_seek, psf_execute, psf_tell, psf_get_state},
+    {psf2_start, psf2_stop, psf2_seek, psf2_execute, psf2_tell, psf2_get_state},
+    {spx_start, spx_stop, psf_seek, spx_execute, psf_tell, spx_get_state},
 };
 
-static PSFEngineFunctors *f;
-static String dirpath;
-
-bool stop_flag = false;
+/* The emulation engine can only seek forward, not back.  To seek elsewhere,
+ * the state of the emulator is saved every few seconds while playing, and the
+ * nearest snapshot before the target time is restored. */
+static const int snapshot_interval = 5000; /* milliseconds */
 
-/* The emulation engine can only seek forward, not back.  This variable is set
- * a non-negative time (milliseconds) when the song is to be restarted in order
- * to seek backward. */
-static int reverse_seek;
+/* one per file being played, so that several can play at once */
+struct PSFPlayback : public PSFContext
+{
+    PSFEngineFunctors *f = nullptr;
+
+    SnapshotCache snapshots;
+    int next_snapshot = 0;
+    int pending_seek = -1;
+
+    /* This variable is set a non-negative time (milliseconds) when the song is
+     * to be restarted in order to seek backward, in case no snapshot is
+     * available. */
+    int reverse_seek = -1;
+
+    /* The rendered audio is cached when the song plays through unseeked.  The
+     * key includes the libraries, which are hashed while the engine loads
+     * them the first time. */
+    PCMCacheKey cache_key;
+    bool hash_libs = false;
+    PCMCacheWriter cache_writer;
+
+    void frame_hook();
+    void lib_loaded(const PSFLib &lib);
+};
 
 static PSFEngine psf_probe(const char *buf, int len)
 {
@@ -112,10 +146,33 @@ static PSFEngine psf_probe(const char *buf, int len)
 }
 
 /* ao_get_lib: called to load secondary files */
-Index<char> ao_get_lib(char *filename)
+bool ao_get_lib(PSFContext *ctx, const char *filename, PSFLib &lib)
 {
-    VFSFile file(filename_build({dirpath, filename}), "r");
-    return file ? file.read_all() : Index<char>();
+    if (!lib_cache_read(filename_build({ctx->dirpath, filename}), lib))
+        return false;
+
+    ctx->lib_loaded(lib);
+    return true;
+}
+
+void PSFPlayback::lib_loaded(const PSFLib &lib)
+{
+    if (hash_libs)
+    {
+        cache_key.add(lib.reserved.begin(), lib.reserved.len());
+        cache_key.add(lib.program.begin(), lib.program.len());
+    }
+}
+
+bool PSFPlugin::init()
+{
+    pcm_cache_init();
+    return true;
+}
+
+void PSFPlugin::cleanup()
+{
+    lib_cache_cleanup();
 }
 
 bool PSFPlugin::read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *image)
@@ -143,65 +200,94 @@ bool PSFPlugin::read_tag(const char *filename, VFSFile &file, Tuple &tuple, Inde
 
 bool PSFPlugin::play(const char *filename, VFSFile &file)
 {
-    bool error = false;
-
     const char * slash = strrchr (filename, '/');
     if (! slash)
         return false;
 
-    dirpath = String (str_copy (filename, slash + 1 - filename));
+    PSFPlayback p;
+    p.dirpath = String (str_copy (filename, slash + 1 - filename));
 
     Index<char> buf = file.read_all ();
 
     PSFEngine eng = psf_probe(buf.begin(), buf.len());
     if (eng == ENG_NONE || eng == ENG_COUNT)
+        return false;
+
+    p.f = &psf_functor_map[eng];
+
+    if (pcm_cache_enabled())
     {
-        error = true;
-        goto cleanup;
+        p.cache_key.add("psf");
+        p.cache_key.add(buf.begin(), buf.len());
+        p.hash_libs = true;
     }
 
-    f = &psf_functor_map[eng];
-
     set_stream_bitrate(44100*2*2*8);
     open_audio(FMT_S16_NE, 44100, 2);
 
-    reverse_seek = -1;
-
     /* This loop will restart playback from the beginning when necessary to seek
      * backwards in the file (reverse_seek >= 0). */
     do
     {
-        if (f->start((uint8_t *)buf.begin(), buf.len()) != AO_SUCCESS)
+        if (p.f->start(&p, (uint8_t *)buf.begin(), buf.len()) != AO_SUCCESS)
         {
-            error = true;
-            goto cleanup;
+            p.f->stop(&p);
+            return false;
         }
 
-        if (reverse_seek >= 0)
+        if (p.hash_libs)
         {
-            f->seek(reverse_seek); /* should never fail here */
-            reverse_seek = -1;
+            p.hash_libs = false;
+
+            PCMCacheReader cache;
+            if (cache.open(p.cache_key, 44100, 2))
+            {
+                p.f->stop(&p);
+                play_cached(cache);
+                return true;
+            }
+
+            /* PSF1 and PSF2 files with no length tag play forever; the
+             * rendering would only fill the disk */
+            if (eng == ENG_SPX || psfTimeToMS(p.c->inf_length) > 0)
+                p.cache_writer.open(p.cache_key, 44100, 2);
         }
 
-        stop_flag = false;
+        /* pointers in the state are only valid until the engine restarts */
+        ao_state regions;
+        p.f->get_state(&p, regions);
+        p.snapshots.reset(std::move(regions));
 
-        f->execute(update);
-        f->stop();
-    }
-    while (reverse_seek >= 0);
+        p.next_snapshot = 0;
+        p.pending_seek = -1;
+
+        if (p.reverse_seek >= 0)
+        {
+            p.f->seek(&p, p.reverse_seek); /* should never fail here */
+            p.reverse_seek = -1;
+        }
 
-cleanup:
-    f = nullptr;
-    dirpath = String ();
+        p.stop_flag = false;
 
-    return ! error;
+        p.f->execute(&p, update);
+        p.f->stop(&p);
+    }
+    while (p.reverse_seek >= 0);
+
+    return true;
 }
 
-void PSFPlugin::update(const void *data, int bytes)
+void PSFPlugin::update(PSFContext *ctx, const void *data, int bytes)
 {
+    PSFPlayback *p = static_cast<PSFPlayback *>(ctx);
+
     if (!data || check_stop())
     {
-        stop_flag = true;
+        /* the song has ended, unless playback was stopped */
+        if (!data)
+            p->cache_writer.commit();
+
+        p->stop_flag = true;
         return;
     }
 
@@ -209,16 +295,73 @@ void PSFPlugin::update(const void *data, int bytes)
 
     if (seek >= 0)
     {
-        if (!f->seek(seek))
+        /* handled at the start of the next frame */
+        p->pending_seek = seek;
+        p->cache_writer.abandon();
+        return;
+    }
+
+    /* audio rendered before the seek is handled is dropped */
+    if (p->pending_seek >= 0)
+        return;
+
+    write_audio(data, bytes);
+    p->cache_writer.write(data, bytes);
+}
+
+void PSFPlugin::play_cached(PCMCacheReader &cache)
+{
+    while (!check_stop())
+    {
+        int seek = check_seek();
+        if (seek >= 0)
+            cache.seek(seek);
+
+        int16_t buf[2 * 44100 / 60];
+        int bytes = cache.read(buf, sizeof buf);
+        if (!bytes)
+            break;
+
+        write_audio(buf, bytes);
+    }
+}
+
+void PSFPlayback::frame_hook()
+{
+    int now = f->tell(this);
+
+    if (pending_seek >= 0)
+    {
+        int index = snapshots.find(pending_seek);
+
+        /* restore a snapshot to go back, or to skip ahead faster than the
+         * engine can emulate */
+        if (index >= 0 && (pending_seek < now || snapshots.time(index) > now))
         {
-            reverse_seek = seek;
+            snapshots.restore(index);
+            now = snapshots.time(index);
+        }
+
+        if (!f->seek(this, pending_seek))
+        {
+            reverse_seek = pending_seek;
             stop_flag = true;
         }
 
-        return;
+        pending_seek = -1;
+        next_snapshot = (now / snapshot_interval + 1) * snapshot_interval;
     }
 
-    write_audio(data, bytes);
+    if (now >= next_snapshot)
+    {
+        int index = snapshots.find(now);
+
+        /* after a seek, we may be passing an existing snapshot */
+        if (index < 0 || snapshots.time(index) <= now - snapshot_interval / 2)
+            snapshots.save(now);
+
+        next_snapshot = now + snapshot_interval;
+    }
 }
 
 bool PSFPlugin::is_our_file(const char *filename, VFSFile &file)
@@ -231,3 +374,13 @@ bool PSFPlugin::is_our_file(const char *filename, VFSFile &file)
 }
 
 const char *const PSFPlugin::exts[] = { "psf", "minipsf", "psf2", "minipsf2", "spu", "spx", nullptr };
+
+const PreferencesWidget PSFPlugin::widgets[] = {
+#ifdef PCM_CACHE
+    WidgetCheck(N_("Keep rendered audio on disk"), WidgetBool("pcm-cache", "enabled")),
+#else
+    WidgetLabel(N_("Built without FLAC, rendered audio cannot be kept on disk.")),
+#endif
+};
+
+const PluginPreferences PSFPlugin::prefs = {{widgets}};
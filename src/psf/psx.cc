@@ -19,6 +19,8 @@
 #include "cpuintrf.h"
 #include "psx.h"
 
+#define LE32(x) FROM_LE32(x)
+
 #define EXC_INT ( 0 )
 #define EXC_ADEL ( 4 )
 #define EXC_ADES ( 5 )
@@ -61,15 +63,6 @@
 #define CAUSE_CE2 ( 2L << 28 )
 #define CAUSE_BD ( 1L << 31 )
 
-extern void psx_bios_hle(uint32_t pc);
-extern void psx_iop_call(uint32_t pc, uint32_t callnum);
-extern uint8_t program_read_byte_32le(offs_t address);
-extern uint16_t program_read_word_32le(offs_t address);
-extern uint32_t program_read_dword_32le(offs_t address);
-extern void program_write_byte_32le(offs_t address, uint8_t data);
-extern void program_write_word_32le(offs_t address, uint16_t data);
-extern void program_write_dword_32le(offs_t address, uint32_t data);
-
 static uint8_t mips_reg_layout[] =
 {
 	MIPS_PC, 0xFF,
@@ -156,26 +149,6 @@ static uint8_t mips_win_layout[] = {
 
 #define REGPC ( 32 )
 
-typedef struct
-{
-	uint32_t op;
-	uint32_t pc;
-	uint32_t prevpc;
-	uint32_t delayv;
-	uint32_t delayr;
-	uint32_t hi;
-	uint32_t lo;
-	uint32_t r[ 32 ];
-	uint32_t cp0r[ 32 ];
-	PAIR cp2cr[ 32 ];
-	PAIR cp2dr[ 32 ];
-	int (*irq_callback)(int irqline);
-} mips_cpu_context;
-
-static mips_cpu_context mipscpu;
-
-static int mips_ICount = 0;
-
 static uint32_t mips_mtc0_writemask[]=
 {
 	0xffffffff, /* INDEX */
@@ -213,7 +186,7 @@ static uint32_t mips_mtc0_writemask[]=
 };
 
 #if 1
-void GTELOG(const char *a,...)
+void PSX::GTELOG(const char *a,...)
 {
 	va_list va;
 	char s_text[ 1024 ];
@@ -223,16 +196,9 @@ void GTELOG(const char *a,...)
 	logerror( "%08x: GTE: %08x %s\n", mipscpu.pc, INS_COFUN( mipscpu.op ), s_text );
 }
 #else
-static inline void GTELOG(const char *a, ...) {}
+inline void PSX::GTELOG(const char *a, ...) {}
 #endif
 
-static uint32_t getcp2dr( int n_reg );
-static void setcp2dr( int n_reg, uint32_t n_value );
-static uint32_t getcp2cr( int n_reg );
-static void setcp2cr( int n_reg, uint32_t n_value );
-static void docop2( int gteop );
-static void mips_exception( int exception );
-
 void mips_stop( void )
 {
 #ifdef MAME_DEBUG
@@ -242,7 +208,7 @@ void mips_stop( void )
 #endif
 }
 
-static inline void mips_set_cp0r( int reg, uint32_t value )
+inline void PSX::mips_set_cp0r( int reg, uint32_t value )
 {
 	mipscpu.cp0r[ reg ] = value;
 	if( reg == CP0_SR || reg == CP0_CAUSE )
@@ -259,7 +225,7 @@ static inline void mips_set_cp0r( int reg, uint32_t value )
 	}
 }
 
-static inline void mips_commit_delayed_load( void )
+inline void PSX::mips_commit_delayed_load( void )
 {
 	if( mipscpu.delayr != 0 )
 	{
@@ -269,7 +235,7 @@ static inline void mips_commit_delayed_load( void )
 	}
 }
 
-static inline void mips_delayed_branch( uint32_t n_adr )
+inline void PSX::mips_delayed_branch( uint32_t n_adr )
 {
 	if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 	{
@@ -285,7 +251,7 @@ static inline void mips_delayed_branch( uint32_t n_adr )
 	}
 }
 
-static inline void mips_set_pc( unsigned val )
+inline void PSX::mips_set_pc( unsigned val )
 {
 	mipscpu.pc = val;
 	change_pc( val );
@@ -293,7 +259,7 @@ static inline void mips_set_pc( unsigned val )
 	mipscpu.delayv = 0;
 }
 
-static inline void mips_advance_pc( void )
+inline void PSX::mips_advance_pc( void )
 {
 	if( mipscpu.delayr == REGPC )
 	{
@@ -306,7 +272,7 @@ static inline void mips_advance_pc( void )
 	}
 }
 
-static inline void mips_load( uint32_t n_r, uint32_t n_v )
+inline void PSX::mips_load( uint32_t n_r, uint32_t n_v )
 {
 	mips_advance_pc();
 	if( n_r != 0 )
@@ -315,7 +281,7 @@ static inline void mips_load( uint32_t n_r, uint32_t n_v )
 	}
 }
 
-static inline void mips_delayed_load( uint32_t n_r, uint32_t n_v )
+inline void PSX::mips_delayed_load( uint32_t n_r, uint32_t n_v )
 {
 	if( mipscpu.delayr == REGPC )
 	{
@@ -334,7 +300,7 @@ static inline void mips_delayed_load( uint32_t n_r, uint32_t n_v )
 	}
 }
 
-static void mips_exception( int exception )
+void PSX::mips_exception( int exception )
 {
 	mips_set_cp0r( CP0_SR, ( mipscpu.cp0r[ CP0_SR ] & ~0x3f ) | ( ( mipscpu.cp0r[ CP0_SR ] << 2 ) & 0x3f ) );
 	if( mipscpu.delayr == REGPC )
@@ -358,7 +324,7 @@ static void mips_exception( int exception )
 	}
 }
 
-void mips_init( void )
+void PSX::mips_init( void )
 {
 #if 0
 	int cpu = cpu_getactivecpu();
@@ -376,7 +342,7 @@ void mips_init( void )
 #endif
 }
 
-void mips_reset( void *param )
+void PSX::mips_reset( void *param )
 {
 	mips_set_cp0r( CP0_SR, ( mipscpu.cp0r[ CP0_SR ] & ~( SR_TS | SR_SWC | SR_KUC | SR_IEC ) ) | SR_BEV );
 	mips_set_cp0r( CP0_RANDOM, 63 ); /* todo: */
@@ -385,55 +351,400 @@ void mips_reset( void *param )
 	mipscpu.prevpc = 0xffffffff;
 }
 
-static void mips_exit( void )
+void PSX::mips_get_state( ao_state &state )
 {
+	AO_STATE_ADD( state, mipscpu );
 }
 
-void mips_shorten_frame(void)
+void PSX::mips_shorten_frame(void)
 {
 	mips_ICount = 0;
 }
 
-void psx_hw_runcounters(void);
+/*
+ * Instructions in RAM are decoded only once, into the number of a handler
+ * in mips_execute() and their operands, and kept per 4 KB page.  RAM is
+ * written from many places besides the CPU (DMA, the HLE BIOS, the loaders,
+ * restored states), so rather than trying to catch every store into code,
+ * an entry is used only while the RAM word it was decoded from is unchanged
+ * and is decoded again otherwise.  Instructions without a handler of their
+ * own, and code outside of RAM, go through the full decoder (MIPS_SLOW).
+ */
 
-int psxcpu_verbose = 0;
+enum
+{
+	MIPS_SLOW,
+	MIPS_SLL, MIPS_SRL, MIPS_SRA, MIPS_SLLV, MIPS_SRLV, MIPS_SRAV,
+	MIPS_JR, MIPS_JALR, MIPS_MFHI, MIPS_MFLO, MIPS_MULT, MIPS_MULTU,
+	MIPS_ADDU, MIPS_SUBU, MIPS_AND, MIPS_OR, MIPS_XOR, MIPS_NOR, MIPS_SLT, MIPS_SLTU,
+	MIPS_BLTZ, MIPS_BGEZ, MIPS_J, MIPS_JAL, MIPS_BEQ, MIPS_BNE, MIPS_BLEZ, MIPS_BGTZ,
+	MIPS_ADDIU, MIPS_SLTI, MIPS_SLTIU, MIPS_ANDI, MIPS_ORI, MIPS_XORI, MIPS_LUI,
+	MIPS_LB, MIPS_LBU, MIPS_LH, MIPS_LHU, MIPS_LW, MIPS_SB, MIPS_SH, MIPS_SW,
+	MIPS_HANDLERS
+};
 
-int mips_execute( int cycles )
+void PSX::mips_decode( uint32_t word, MipsDecoded &d )
 {
-	uint32_t n_res;
+	uint32_t op = LE32( word );
 
-	mips_ICount = cycles;
-	do
+	d.word = word;
+	d.handler = MIPS_SLOW;
+	d.rs = INS_RS( op );
+	d.rt = INS_RT( op );
+	d.rd = INS_RD( op );
+	d.imm = MIPS_WORD_EXTEND( INS_IMMEDIATE( op ) );
+
+	switch( INS_OP( op ) )
 	{
-//		CALL_MAME_DEBUG;
+	case OP_SPECIAL:
+		switch( INS_FUNCT( op ) )
+		{
+		case FUNCT_SLL: d.handler = MIPS_SLL; d.imm = INS_SHAMT( op ); break;
+		case FUNCT_SRL: d.handler = MIPS_SRL; d.imm = INS_SHAMT( op ); break;
+		case FUNCT_SRA: d.handler = MIPS_SRA; d.imm = INS_SHAMT( op ); break;
+		case FUNCT_SLLV: d.handler = MIPS_SLLV; break;
+		case FUNCT_SRLV: d.handler = MIPS_SRLV; break;
+		case FUNCT_SRAV: d.handler = MIPS_SRAV; break;
+		case FUNCT_JR: if( d.rd == 0 ) d.handler = MIPS_JR; break;
+		case FUNCT_JALR: d.handler = MIPS_JALR; break;
+		case FUNCT_MFHI: d.handler = MIPS_MFHI; break;
+		case FUNCT_MFLO: d.handler = MIPS_MFLO; break;
+		case FUNCT_MULT: if( d.rd == 0 ) d.handler = MIPS_MULT; break;
+		case FUNCT_MULTU: if( d.rd == 0 ) d.handler = MIPS_MULTU; break;
+		case FUNCT_ADDU: d.handler = MIPS_ADDU; break;
+		case FUNCT_SUBU: d.handler = MIPS_SUBU; break;
+		case FUNCT_AND: d.handler = MIPS_AND; break;
+		case FUNCT_OR: d.handler = MIPS_OR; break;
+		case FUNCT_XOR: d.handler = MIPS_XOR; break;
+		case FUNCT_NOR: d.handler = MIPS_NOR; break;
+		case FUNCT_SLT: d.handler = MIPS_SLT; break;
+		case FUNCT_SLTU: d.handler = MIPS_SLTU; break;
+		}
+		break;
+	case OP_REGIMM:
+		d.imm <<= 2;
+		if( d.rt == RT_BLTZ ) d.handler = MIPS_BLTZ;
+		if( d.rt == RT_BGEZ ) d.handler = MIPS_BGEZ;
+		break;
+	case OP_J: d.handler = MIPS_J; d.imm = INS_TARGET( op ) << 2; break;
+	case OP_JAL: d.handler = MIPS_JAL; d.imm = INS_TARGET( op ) << 2; break;
+	case OP_BEQ: d.handler = MIPS_BEQ; d.imm <<= 2; break;
+	case OP_BNE: d.handler = MIPS_BNE; d.imm <<= 2; break;
+	case OP_BLEZ: if( d.rt == 0 ) d.handler = MIPS_BLEZ; d.imm <<= 2; break;
+	case OP_BGTZ: if( d.rt == 0 ) d.handler = MIPS_BGTZ; d.imm <<= 2; break;
+	case OP_ADDIU: if( d.rt != 0 ) d.handler = MIPS_ADDIU; break;	// rt == 0 is an IOP call
+	case OP_SLTI: d.handler = MIPS_SLTI; break;
+	case OP_SLTIU: d.handler = MIPS_SLTIU; break;
+	case OP_ANDI: d.handler = MIPS_ANDI; d.imm = INS_IMMEDIATE( op ); break;
+	case OP_ORI: d.handler = MIPS_ORI; d.imm = INS_IMMEDIATE( op ); break;
+	case OP_XORI: d.handler = MIPS_XORI; d.imm = INS_IMMEDIATE( op ); break;
+	case OP_LUI: d.handler = MIPS_LUI; d.imm = INS_IMMEDIATE( op ) << 16; break;
+	case OP_LB: d.handler = MIPS_LB; break;
+	case OP_LBU: d.handler = MIPS_LBU; break;
+	case OP_LH: d.handler = MIPS_LH; break;
+	case OP_LHU: d.handler = MIPS_LHU; break;
+	case OP_LW: d.handler = MIPS_LW; break;
+	case OP_SB: d.handler = MIPS_SB; break;
+	case OP_SH: d.handler = MIPS_SH; break;
+	case OP_SW: d.handler = MIPS_SW; break;
+	}
+}
 
-//		psx_hw_runcounters();
+inline const MipsDecoded *PSX::mips_fetch( void )
+{
+	static const MipsDecoded slow = { 0, MIPS_SLOW };
+	const MipsDecoded *d;
 
-		mipscpu.op = cpu_readop32( mipscpu.pc );
+	// RAM and its mirrors, as in psx_hw_read(); PSX_NO_DECODE_CACHE leaves
+	// everything to the full decoder, for benchmarking against it
+#ifndef PSX_NO_DECODE_CACHE
+	if( ( mipscpu.pc & 0x7f800000 ) == 0 )
+	{
+		uint32_t offset = mipscpu.pc & 0x1fffff;
+		uint32_t word = psx_ram[ offset >> 2 ];
+		MipsDecoded *&page = decoded[ offset >> 12 ];
 
-#if 0
-		while (mipscpu.prevpc == mipscpu.pc)
+		if( !page )
 		{
-			psx_hw_runcounters();
-			mips_ICount--;
-
-			if (mips_ICount == 0) return cycles;
+			page = new MipsDecoded[ 1024 ];
+			for( int i = 0; i < 1024; i ++ )
+				mips_decode( psx_ram[ ( offset >> 2 & ~1023 ) + i ], page[ i ] );
 		}
+
+		MipsDecoded &entry = page[ ( offset >> 2 ) & 1023 ];
+		if( entry.word != word )
+			mips_decode( word, entry );
+
+		mipscpu.op = LE32( word );
+		d = &entry;
+	}
+	else
+#endif
+	{
+		mipscpu.op = cpu_readop32( mipscpu.pc );
+		d = &slow;
+	}
+
+	// if we're not in a delay slot, update
+	// if we're in a delay slot and the delay instruction is not NOP, update
+	if (( mipscpu.delayr == 0 ) || ((mipscpu.delayr != 0) && (mipscpu.op != 0)))
+	{
+		mipscpu.prevpc = mipscpu.pc;
+	}
+
+	return d;
+}
+
+PSX::~PSX()
+{
+	for( MipsDecoded *page : decoded )
+		delete[] page;
+}
+
+/* With GCC, each handler jumps straight to the next one (direct threading);
+ * otherwise they are cases of a switch. */
+#ifdef __GNUC__
+#define MIPS_HANDLER( name ) do_##name
+#define MIPS_DISPATCH goto *handlers[ d->handler ]
+#else
+#define MIPS_HANDLER( name ) case name
+#define MIPS_DISPATCH goto dispatch
 #endif
 
-		// if we're not in a delay slot, update
-		// if we're in a delay slot and the delay instruction is not NOP, update
-		if (( mipscpu.delayr == 0 ) || ((mipscpu.delayr != 0) && (mipscpu.op != 0)))
+#define MIPS_NEXT do { \
+	if( --mips_ICount <= 0 ) \
+		goto done; \
+	d = mips_fetch(); \
+	MIPS_DISPATCH; \
+} while( 0 )
+
+int PSX::mips_execute( int cycles )
+{
+#ifdef __GNUC__
+	static const void * const handlers[ MIPS_HANDLERS ] = {
+		&&do_MIPS_SLOW,
+		&&do_MIPS_SLL, &&do_MIPS_SRL, &&do_MIPS_SRA, &&do_MIPS_SLLV, &&do_MIPS_SRLV, &&do_MIPS_SRAV,
+		&&do_MIPS_JR, &&do_MIPS_JALR, &&do_MIPS_MFHI, &&do_MIPS_MFLO, &&do_MIPS_MULT, &&do_MIPS_MULTU,
+		&&do_MIPS_ADDU, &&do_MIPS_SUBU, &&do_MIPS_AND, &&do_MIPS_OR, &&do_MIPS_XOR, &&do_MIPS_NOR, &&do_MIPS_SLT, &&do_MIPS_SLTU,
+		&&do_MIPS_BLTZ, &&do_MIPS_BGEZ, &&do_MIPS_J, &&do_MIPS_JAL, &&do_MIPS_BEQ, &&do_MIPS_BNE, &&do_MIPS_BLEZ, &&do_MIPS_BGTZ,
+		&&do_MIPS_ADDIU, &&do_MIPS_SLTI, &&do_MIPS_SLTIU, &&do_MIPS_ANDI, &&do_MIPS_ORI, &&do_MIPS_XORI, &&do_MIPS_LUI,
+		&&do_MIPS_LB, &&do_MIPS_LBU, &&do_MIPS_LH, &&do_MIPS_LHU, &&do_MIPS_LW, &&do_MIPS_SB, &&do_MIPS_SH, &&do_MIPS_SW
+	};
+#endif
+
+	uint32_t n_res;
+	const MipsDecoded *d;
+
+	mips_ICount = cycles;
+
+	d = mips_fetch();
+	MIPS_DISPATCH;
+
+#ifndef __GNUC__
+dispatch:
+	switch( d->handler )
+#endif
+	{
+	MIPS_HANDLER( MIPS_SLL ):
+		mips_load( d->rd, mipscpu.r[ d->rt ] << d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SRL ):
+		mips_load( d->rd, mipscpu.r[ d->rt ] >> d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SRA ):
+		mips_load( d->rd, (int32_t)mipscpu.r[ d->rt ] >> d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SLLV ):
+		mips_load( d->rd, mipscpu.r[ d->rt ] << ( mipscpu.r[ d->rs ] & 31 ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SRLV ):
+		mips_load( d->rd, mipscpu.r[ d->rt ] >> ( mipscpu.r[ d->rs ] & 31 ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SRAV ):
+		mips_load( d->rd, (int32_t)mipscpu.r[ d->rt ] >> ( mipscpu.r[ d->rs ] & 31 ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_JR ):
+		mips_delayed_branch( mipscpu.r[ d->rs ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_JALR ):
+		n_res = mipscpu.pc + 8;
+		mips_delayed_branch( mipscpu.r[ d->rs ] );
+		if( d->rd != 0 )
 		{
-			mipscpu.prevpc = mipscpu.pc;
+			mipscpu.r[ d->rd ] = n_res;
 		}
-#if 0
-		if (1) //psxcpu_verbose)
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_MFHI ):
+		mips_load( d->rd, mipscpu.hi );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_MFLO ):
+		mips_load( d->rd, mipscpu.lo );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_MULT ):
 		{
-			printf("[%08x: %08x] [SP %08x RA %08x V0 %08x V1 %08x A0 %08x S0 %08x S1 %08x]\n", mipscpu.pc, mipscpu.op, mipscpu.r[29], mipscpu.r[31], mipscpu.r[2], mipscpu.r[3], mipscpu.r[4], mipscpu.r[ 16 ], mipscpu.r[ 17 ]);
-//			psxcpu_verbose--;
+			int64_t n_res64;
+			n_res64 = MUL_64_32_32( (int32_t)mipscpu.r[ d->rs ], (int32_t)mipscpu.r[ d->rt ] );
+			mips_advance_pc();
+			mipscpu.lo = LO32_32_64( n_res64 );
+			mipscpu.hi = HI32_32_64( n_res64 );
 		}
-#endif
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_MULTU ):
+		{
+			uint64_t n_res64;
+			n_res64 = MUL_U64_U32_U32( mipscpu.r[ d->rs ], mipscpu.r[ d->rt ] );
+			mips_advance_pc();
+			mipscpu.lo = LO32_U32_U64( n_res64 );
+			mipscpu.hi = HI32_U32_U64( n_res64 );
+		}
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_ADDU ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] + mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SUBU ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] - mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_AND ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] & mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_OR ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] | mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_XOR ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] ^ mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_NOR ):
+		mips_load( d->rd, ~( mipscpu.r[ d->rs ] | mipscpu.r[ d->rt ] ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SLT ):
+		mips_load( d->rd, (int32_t)mipscpu.r[ d->rs ] < (int32_t)mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SLTU ):
+		mips_load( d->rd, mipscpu.r[ d->rs ] < mipscpu.r[ d->rt ] );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BLTZ ):
+		if( (int32_t)mipscpu.r[ d->rs ] < 0 )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BGEZ ):
+		if( (int32_t)mipscpu.r[ d->rs ] >= 0 )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_J ):
+		mips_delayed_branch( ( ( mipscpu.pc + 4 ) & 0xf0000000 ) + d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_JAL ):
+		n_res = mipscpu.pc + 8;
+		mips_delayed_branch( ( ( mipscpu.pc + 4 ) & 0xf0000000 ) + d->imm );
+		mipscpu.r[ 31 ] = n_res;
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BEQ ):
+		if( mipscpu.r[ d->rs ] == mipscpu.r[ d->rt ] )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BNE ):
+		if( mipscpu.r[ d->rs ] != mipscpu.r[ d->rt ] )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BLEZ ):
+		if( (int32_t)mipscpu.r[ d->rs ] <= 0 )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_BGTZ ):
+		if( (int32_t)mipscpu.r[ d->rs ] > 0 )
+			mips_delayed_branch( mipscpu.pc + 4 + d->imm );
+		else
+			mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_ADDIU ):
+		mips_load( d->rt, mipscpu.r[ d->rs ] + d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SLTI ):
+		mips_load( d->rt, (int32_t)mipscpu.r[ d->rs ] < (int32_t)d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SLTIU ):
+		mips_load( d->rt, mipscpu.r[ d->rs ] < d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_ANDI ):
+		mips_load( d->rt, mipscpu.r[ d->rs ] & d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_ORI ):
+		mips_load( d->rt, mipscpu.r[ d->rs ] | d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_XORI ):
+		mips_load( d->rt, mipscpu.r[ d->rs ] ^ d->imm );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_LUI ):
+		mips_load( d->rt, d->imm );
+		MIPS_NEXT;
+
+	// memory access in user mode, with an isolated cache or to an unaligned
+	// address is left to the full decoder
+	MIPS_HANDLER( MIPS_LB ):
+		if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 )
+			goto slow;
+		mips_delayed_load( d->rt, MIPS_BYTE_EXTEND( program_read_byte_32le( mipscpu.r[ d->rs ] + d->imm ) ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_LBU ):
+		if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 )
+			goto slow;
+		mips_delayed_load( d->rt, program_read_byte_32le( mipscpu.r[ d->rs ] + d->imm ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_LH ):
+		{
+			uint32_t n_adr = mipscpu.r[ d->rs ] + d->imm;
+			if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 || ( n_adr & 1 ) != 0 )
+				goto slow;
+			mips_delayed_load( d->rt, MIPS_WORD_EXTEND( program_read_word_32le( n_adr ) ) );
+		}
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_LHU ):
+		{
+			uint32_t n_adr = mipscpu.r[ d->rs ] + d->imm;
+			if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 || ( n_adr & 1 ) != 0 )
+				goto slow;
+			mips_delayed_load( d->rt, program_read_word_32le( n_adr ) );
+		}
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_LW ):
+		if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+			goto slow;
+		mips_delayed_load( d->rt, program_read_dword_32le( mipscpu.r[ d->rs ] + d->imm ) );
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SB ):
+		if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 )
+			goto slow;
+		program_write_byte_32le( mipscpu.r[ d->rs ] + d->imm, mipscpu.r[ d->rt ] );
+		mips_advance_pc();
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SH ):
+		{
+			uint32_t n_adr = mipscpu.r[ d->rs ] + d->imm;
+			if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_ISC | SR_KUC ) ) != 0 || ( n_adr & 1 ) != 0 )
+				goto slow;
+			program_write_word_32le( n_adr, mipscpu.r[ d->rt ] );
+			mips_advance_pc();
+		}
+		MIPS_NEXT;
+	MIPS_HANDLER( MIPS_SW ):
+		if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+			goto slow;
+		program_write_dword_32le( mipscpu.r[ d->rs ] + d->imm, mipscpu.r[ d->rt ] );
+		mips_advance_pc();
+		MIPS_NEXT;
+
+	MIPS_HANDLER( MIPS_SLOW ):
+	slow:
 		switch( INS_OP( mipscpu.op ) )
 		{
 		case OP_SPECIAL:
@@ -1647,30 +1958,14 @@ int mips_execute( int cycles )
 			mips_exception( EXC_RI );
   			break;
 		}
-		mips_ICount--;
-	} while( mips_ICount > 0 );
-
-	return cycles - mips_ICount;
-}
-
-static void mips_get_context( void *dst )
-{
-	if( dst )
-	{
-		*(mips_cpu_context *)dst = mipscpu;
+		MIPS_NEXT;
 	}
-}
 
-static void mips_set_context( void *src )
-{
-	if( src )
-	{
-		mipscpu = *(mips_cpu_context *)src;
-		change_pc( mipscpu.pc );
-	}
+done:
+	return cycles - mips_ICount;
 }
 
-static void set_irq_line( int irqline, int state )
+void PSX::set_irq_line( int irqline, int state )
 {
 	uint32_t ip;
 
@@ -1723,7 +2018,7 @@ static void set_irq_line( int irqline, int state )
  * Return a formatted string for a register
  ****************************************************************************/
 
-offs_t mips_dasm( char *buffer, offs_t pc )
+offs_t PSX::mips_dasm( char *buffer, offs_t pc )
 {
 	offs_t ret;
 	change_pc( pc );
@@ -1850,7 +2145,7 @@ offs_t mips_dasm( char *buffer, offs_t pc )
 #define ZSF4 ( mipscpu.cp2cr[ 30 ].w.l )
 #define FLAG ( mipscpu.cp2cr[ 31 ].d )
 
-static uint32_t getcp2dr( int n_reg )
+uint32_t PSX::getcp2dr( int n_reg )
 {
 	if( n_reg == 1 || n_reg == 3 || n_reg == 5 || n_reg == 8 || n_reg == 9 || n_reg == 10 || n_reg == 11 )
 	{
@@ -1868,7 +2163,7 @@ static uint32_t getcp2dr( int n_reg )
 	return mipscpu.cp2dr[ n_reg ].d;
 }
 
-static void setcp2dr( int n_reg, uint32_t n_value )
+void PSX::setcp2dr( int n_reg, uint32_t n_value )
 {
 	GTELOG( "set CP2DR%u=%08x", n_reg, n_value );
 	mipscpu.cp2dr[ n_reg ].d = n_value;
@@ -1903,19 +2198,19 @@ static void setcp2dr( int n_reg, uint32_t n_value )
 	}
 }
 
-static uint32_t getcp2cr( int n_reg )
+uint32_t PSX::getcp2cr( int n_reg )
 {
 	GTELOG( "get CP2CR%u=%08x", n_reg, mipscpu.cp2cr[ n_reg ].d );
 	return mipscpu.cp2cr[ n_reg ].d;
 }
 
-static void setcp2cr( int n_reg, uint32_t n_value )
+void PSX::setcp2cr( int n_reg, uint32_t n_value )
 {
 	GTELOG( "set CP2CR%u=%08x", n_reg, n_value );
 	mipscpu.cp2cr[ n_reg ].d = n_value;
 }
 
-static inline int32_t LIM( int32_t n_value, int32_t n_max, int32_t n_min, uint32_t n_flag )
+inline int32_t PSX::LIM( int32_t n_value, int32_t n_max, int32_t n_min, uint32_t n_flag )
 {
 	if( n_value > n_max )
 	{
@@ -1930,7 +2225,7 @@ static inline int32_t LIM( int32_t n_value, int32_t n_max, int32_t n_min, uint32
 	return n_value;
 }
 
-static inline int64_t BOUNDS( int64_t n_value, int64_t n_max, int n_maxflag, int64_t n_min, int n_minflag )
+inline int64_t PSX::BOUNDS( int64_t n_value, int64_t n_max, int n_maxflag, int64_t n_min, int n_minflag )
 {
 	if( n_value > n_max )
 	{
@@ -1954,7 +2249,7 @@ static inline int64_t BOUNDS( int64_t n_value, int64_t n_max, int n_maxflag, int
 #define Lm_C3( a ) LIM( ( a ), 0x00ff, 0x0000, ( 1 << 19 ) )
 #define Lm_D( a ) LIM( ( a ), 0xffff, 0x0000, ( 1 << 31 ) | ( 1 << 18 ) )
 
-static inline uint32_t Lm_E( uint32_t n_z )
+inline uint32_t PSX::Lm_E( uint32_t n_z )
 {
 	if( n_z <= H / 2 )
 	{
@@ -1973,7 +2268,7 @@ static inline uint32_t Lm_E( uint32_t n_z )
 #define Lm_G2( a ) LIM( ( a ), 0x3ff, -0x400, ( 1 << 31 ) | ( 1 << 13 ) )
 #define Lm_H( a ) LIM( ( a ), 0xfff, 0x000, ( 1 << 12 ) )
 
-static void docop2( int gteop )
+void PSX::docop2( int gteop )
 {
 	int n_sf;
 	int n_v;
@@ -1986,19 +2281,19 @@ static void docop2( int gteop )
 	const uint32_t **p_n_cv;
 	static const uint16_t n_zm = 0;
 	static const uint32_t n_zc = 0;
-	static const uint16_t *p_n_vx[] = { &VX0, &VX1, &VX2 };
-	static const uint16_t *p_n_vy[] = { &VY0, &VY1, &VY2 };
-	static const uint16_t *p_n_vz[] = { &VZ0, &VZ1, &VZ2 };
-	static const uint16_t *p_n_rm[] = { &R11, &R12, &R13, &R21, &R22, &R23, &R31, &R32, &R33 };
-	static const uint16_t *p_n_lm[] = { &L11, &L12, &L13, &L21, &L22, &L23, &L31, &L32, &L33 };
-	static const uint16_t *p_n_cm[] = { &LR1, &LR2, &LR3, &LG1, &LG2, &LG3, &LB1, &LB2, &LB3 };
-	static const uint16_t *p_n_zm[] = { &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm };
-	static const uint16_t **p_p_n_mx[] = { p_n_rm, p_n_lm, p_n_cm, p_n_zm };
-	static const uint32_t *p_n_tr[] = { &TRX, &TRY, &TRZ };
-	static const uint32_t *p_n_bk[] = { &RBK, &GBK, &BBK };
-	static const uint32_t *p_n_fc[] = { &RFC, &GFC, &BFC };
-	static const uint32_t *p_n_zc[] = { &n_zc, &n_zc, &n_zc };
-	static const uint32_t **p_p_n_cv[] = { p_n_tr, p_n_bk, p_n_fc, p_n_zc };
+	const uint16_t *p_n_vx[] = { &VX0, &VX1, &VX2 };
+	const uint16_t *p_n_vy[] = { &VY0, &VY1, &VY2 };
+	const uint16_t *p_n_vz[] = { &VZ0, &VZ1, &VZ2 };
+	const uint16_t *p_n_rm[] = { &R11, &R12, &R13, &R21, &R22, &R23, &R31, &R32, &R33 };
+	const uint16_t *p_n_lm[] = { &L11, &L12, &L13, &L21, &L22, &L23, &L31, &L32, &L33 };
+	const uint16_t *p_n_cm[] = { &LR1, &LR2, &LR3, &LG1, &LG2, &LG3, &LB1, &LB2, &LB3 };
+	const uint16_t *p_n_zm[] = { &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm };
+	const uint16_t **p_p_n_mx[] = { p_n_rm, p_n_lm, p_n_cm, p_n_zm };
+	const uint32_t *p_n_tr[] = { &TRX, &TRY, &TRZ };
+	const uint32_t *p_n_bk[] = { &RBK, &GBK, &BBK };
+	const uint32_t *p_n_fc[] = { &RFC, &GFC, &BFC };
+	const uint32_t *p_n_zc[] = { &n_zc, &n_zc, &n_zc };
+	const uint32_t **p_p_n_cv[] = { p_n_tr, p_n_bk, p_n_fc, p_n_zc };
 
 	switch( GTE_FUNCT( gteop ) )
 	{
@@ -2604,7 +2899,7 @@ static void docop2( int gteop )
  * Generic set_info
  **************************************************************************/
 
-void mips_set_info(uint32_t state, union cpuinfo *info)
+void PSX::mips_set_info(uint32_t state, union cpuinfo *info)
 {
 	switch (state)
 	{
@@ -2763,7 +3058,7 @@ void mips_set_info(uint32_t state, union cpuinfo *info)
  * Generic get_info
  **************************************************************************/
 
-void mips_get_info(uint32_t state, union cpuinfo *info)
+void PSX::mips_get_info(uint32_t state, union cpuinfo *info)
 {
 	switch (state)
 	{
@@ -2938,15 +3233,6 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 		case CPUINFO_INT_REGISTER + MIPS_CP2CR31:		info->i = mipscpu.cp2cr[ 31 ].d;		break;
 
 		/* --- the following bits of info are returned as pointers to data or functions --- */
-		case CPUINFO_PTR_SET_INFO:						info->setinfo = mips_set_info;			break;
-		case CPUINFO_PTR_GET_CONTEXT:					info->getcontext = mips_get_context;	break;
-		case CPUINFO_PTR_SET_CONTEXT:					info->setcontext = mips_set_context;	break;
-		case CPUINFO_PTR_INIT:							info->init = mips_init;					break;
-		case CPUINFO_PTR_RESET:							info->reset = mips_reset;				break;
-		case CPUINFO_PTR_EXIT:							info->exit = mips_exit;					break;
-		case CPUINFO_PTR_EXECUTE:						info->execute = mips_execute;			break;
-		case CPUINFO_PTR_BURN:							info->burn = nullptr;						break;
-		case CPUINFO_PTR_DISASSEMBLE:					info->disassemble = mips_dasm;			break;
 		case CPUINFO_PTR_IRQ_CALLBACK:					info->irqcallback = mipscpu.irq_callback; break;
 		case CPUINFO_PTR_INSTRUCTION_COUNTER:			info->icount = &mips_ICount;			break;
 		case CPUINFO_PTR_REGISTER_LAYOUT:				info->p = mips_reg_layout;				break;
@@ -2954,32 +3240,32 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 	}
 }
 
-uint32_t mips_get_cause(void)
+uint32_t PSX::mips_get_cause(void)
 {
 	return mipscpu.cp0r[ CP0_CAUSE ];
 }
 
-uint32_t mips_get_status(void)
+uint32_t PSX::mips_get_status(void)
 {
 	return mipscpu.cp0r[ CP0_SR ];
 }
 
-void mips_set_status(uint32_t status)
+void PSX::mips_set_status(uint32_t status)
 {
 	mipscpu.cp0r[ CP0_SR ] = status;
 }
 
-uint32_t mips_get_ePC(void)
+uint32_t PSX::mips_get_ePC(void)
 {
 	return mipscpu.cp0r[ CP0_EPC ];
 }
 
-int mips_get_icount(void)
+int PSX::mips_get_icount(void)
 {
 	return mips_ICount;
 }
 
-void mips_set_icount(int count)
+void PSX::mips_set_icount(int count)
 {
 	mips_ICount = count;
 }
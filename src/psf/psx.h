@@ -2,6 +2,7 @@
 #define _MIPS_H
 
 #include "ao.h"
+#include "osd_cpu.h"
 //#include "driver.h"
 
 typedef void genf(void);
@@ -277,6 +278,251 @@ enum
 /* OP_COP0 */
 #define CF_RFE ( 16 )
 
+typedef struct
+{
+	uint32_t op;
+	uint32_t pc;
+	uint32_t prevpc;
+	uint32_t delayv;
+	uint32_t delayr;
+	uint32_t hi;
+	uint32_t lo;
+	uint32_t r[ 32 ];
+	uint32_t cp0r[ 32 ];
+	PAIR cp2cr[ 32 ];
+	PAIR cp2dr[ 32 ];
+	int (*irq_callback)(int irqline);
+} mips_cpu_context;
+
+#define MAX_FILE_SLOTS	(32)
+#define SEMA_MAX	(64)
+
+typedef struct
+{
+	char name[10];
+	uint32_t dispatch;
+} ExternLibEntries;
+
+typedef struct
+{
+	uint32_t type;
+	uint32_t value;
+	uint32_t param;
+	int    inUse;
+} EventFlag;
+
+typedef struct
+{
+	uint32_t attr;
+	uint32_t option;
+	int32_t init;
+	int32_t current;
+	int32_t max;
+	int32_t threadsWaiting;
+	int32_t inuse;
+} Semaphore;
+
+typedef struct
+{
+	int32_t  iState;		// state of thread
+
+	uint32_t flags;		// flags
+	uint32_t routine;		// start of code for the thread
+	uint32_t stackloc;	// stack location in IOP RAM
+	uint32_t stacksize;	// stack size
+	uint32_t refCon;		// user value passed in at CreateThread time
+
+	uint32_t waitparm;	// what we're waiting on if in one the TS_WAIT* states
+
+	uint32_t save_regs[37];	// CPU registers belonging to this thread
+} Thread;
+
+typedef struct
+{
+	int32_t  iActive;
+	uint32_t count;
+	uint32_t target;
+	uint32_t source;
+	uint32_t prescale;
+	uint32_t handler;
+	uint32_t hparam;
+	uint32_t mode;
+} IOPTimer;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t mode;
+	uint32_t target;
+	uint32_t sysclock;
+	uint32_t interrupt;
+} Counter;
+
+typedef struct EvtCtrl
+{
+	uint32_t desc;
+	int32_t status;
+	int32_t mode;
+	uint32_t fhandler;
+} EvtCtrlBlk[32];
+
+// an instruction in RAM as decoded by PSX::mips_decode()
+typedef struct
+{
+	uint32_t word;		// RAM contents it was decoded from
+	uint8_t handler;
+	uint8_t rs, rt, rd;
+	uint32_t imm;		// immediate, shift amount or branch offset
+} MipsDecoded;
+
+struct PSFContext;
+
+// The R3000 (psx.cc) together with the HLE BIOS/IOP and the rest of the
+// hardware (psx_hw.cc).  Everything is kept in here rather than in globals,
+// so that any number of machines can run at once.
+class PSX
+{
+public:
+	PSX(PSFContext *ctx) : ctx(ctx) {}
+	~PSX();
+
+	PSX(const PSX &) = delete;
+	void operator=(const PSX &) = delete;
+
+	// psx.cc
+	void mips_init( void );
+	void mips_reset( void *param );
+	void mips_get_state( ao_state &state );
+	void mips_shorten_frame( void );
+	int mips_execute( int cycles );
+	offs_t mips_dasm( char *buffer, offs_t pc );
+	void mips_set_info(uint32_t state, union cpuinfo *info);
+	void mips_get_info(uint32_t state, union cpuinfo *info);
+	uint32_t mips_get_cause(void);
+	uint32_t mips_get_status(void);
+	void mips_set_status(uint32_t status);
+	uint32_t mips_get_ePC(void);
+	int mips_get_icount(void);
+	void mips_set_icount(int count);
+
+	// psx_hw.cc
+	void psx_irq_set(uint32_t irq);
+	uint32_t psx_hw_read(offs_t offset, uint32_t mem_mask);
+	void psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask);
+	void psx_hw_slice(void);
+	void ps2_hw_slice(void);
+	void psx_hw_frame(void);
+	void ps2_hw_frame(void);
+	void psx_bios_exception(uint32_t pc);
+	void psx_hw_init(void);
+	void psx_hw_get_state(ao_state &state);
+	void psx_bios_hle(uint32_t pc);
+	void psx_hw_runcounters(void);
+	void SPUirq(void);
+	uint8_t program_read_byte_32le(offs_t address);
+	uint16_t program_read_word_32le(offs_t address);
+	uint32_t program_read_dword_32le(offs_t address);
+	void program_write_byte_32le(offs_t address, uint8_t data);
+	void program_write_word_32le(offs_t address, uint16_t data);
+	void program_write_dword_32le(offs_t address, uint32_t data);
+	void psx_iop_call(uint32_t pc, uint32_t callnum);
+
+	int psf_refresh = -1;
+
+	// PSX main RAM
+	uint32_t psx_ram[(2*1024*1024)/4] {};
+	uint32_t psx_scratch[0x400] {};
+	// backup image to restart songs
+	uint32_t initial_ram[(2*1024*1024)/4] {};
+	uint32_t initial_scratch[0x400] {};
+
+private:
+	PSFContext *ctx;
+
+	// psx.cc
+	mips_cpu_context mipscpu {};
+	int mips_ICount = 0;
+	int psxcpu_verbose = 0;
+
+	// decoded instructions, one block per 4 KB page of RAM that has run code
+	MipsDecoded *decoded[(2*1024*1024)/4096] {};
+
+	void GTELOG(const char *a,...);
+	inline void mips_set_cp0r( int reg, uint32_t value );
+	inline void mips_commit_delayed_load( void );
+	inline void mips_delayed_branch( uint32_t n_adr );
+	inline void mips_set_pc( unsigned val );
+	inline void mips_advance_pc( void );
+	inline void mips_load( uint32_t n_r, uint32_t n_v );
+	inline void mips_delayed_load( uint32_t n_r, uint32_t n_v );
+	void mips_exception( int exception );
+	void mips_decode( uint32_t word, MipsDecoded &d );
+	inline const MipsDecoded *mips_fetch( void );
+	void set_irq_line( int irqline, int state );
+	uint32_t getcp2dr( int n_reg );
+	void setcp2dr( int n_reg, uint32_t n_value );
+	uint32_t getcp2cr( int n_reg );
+	void setcp2cr( int n_reg, uint32_t n_value );
+	inline int32_t LIM( int32_t n_value, int32_t n_max, int32_t n_min, uint32_t n_flag );
+	inline int64_t BOUNDS( int64_t n_value, int64_t n_max, int n_maxflag, int64_t n_min, int n_minflag );
+	inline uint32_t Lm_E( uint32_t n_z );
+	void docop2( int gteop );
+
+	// psx_hw.cc
+	volatile int softcall_target = 0;
+	int filestat[MAX_FILE_SLOTS] {};
+	uint8_t *filedata[MAX_FILE_SLOTS] {};
+	uint32_t filesize[MAX_FILE_SLOTS] {}, filepos[MAX_FILE_SLOTS] {};
+	int intr_susp = 0;
+
+	uint64_t sys_time = 0;
+	int timerexp = 0;
+
+	int32_t iNumLibs = 0;
+	ExternLibEntries reglibs[32] {};
+
+	int32_t iNumFlags = 0;
+	EventFlag evflags[32] {};
+
+	int32_t iNumSema = 0;
+	Semaphore semaphores[SEMA_MAX] {};
+
+	int32_t iNumThreads = 0, iCurThread = 0;
+	Thread threads[32] {};
+
+	IOPTimer iop_timers[8] {};
+	int32_t iNumTimers = 0;
+
+	Counter root_cnts[4] {};	// 4 of the bastards
+
+	EvtCtrlBlk *Event = nullptr;
+	EvtCtrlBlk *CounterEvent = nullptr;
+
+	uint32_t spu_delay = 0, dma_icr = 0, irq_data = 0, irq_mask = 0, dma_timer = 0, WAI = 0;
+	uint32_t dma4_madr = 0, dma4_bcr = 0, dma4_chcr = 0, dma4_delay = 0;
+	uint32_t dma7_madr = 0, dma7_bcr = 0, dma7_chcr = 0, dma7_delay = 0;
+	uint32_t dma4_cb = 0, dma7_cb = 0, dma4_fval = 0, dma4_flag = 0, dma7_fval = 0, dma7_flag = 0;
+	uint32_t irq9_cb = 0, irq9_fval = 0, irq9_flag = 0;
+
+	uint32_t gpu_stat = 0;
+	int fcnt = 0;
+	uint32_t heap_addr = 0, entry_int = 0;
+	uint32_t irq_regs[37] {};
+	int irq_mutex = 0;
+
+	void FreezeThread(int32_t iThread, int flag);
+	void ThawThread(int32_t iThread);
+	void ps2_reschedule(void);
+	void psx_irq_update(void);
+	void psx_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr);
+	void ps2_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr);
+	void ps2_dma7(uint32_t madr, uint32_t bcr, uint32_t chcr);
+	void call_irq_routine(uint32_t routine, uint32_t parameter);
+	uint32_t calc_ev(uint32_t a0);
+	uint32_t calc_spec(uint32_t a1);
+	void iop_sprintf(char *out, char *fmt, uint32_t pstart);
+};
+
 #ifdef MAME_DEBUG
 extern unsigned DasmMIPS(char *buff, unsigned _pc);
 #endif
@@ -51,6 +51,7 @@
 #include "ao.h"
 #include "cpuintrf.h"
 #include "psx.h"
+#include "eng_protos.h"
 
 #define DEBUG_HLE_BIOS	(0)		// debug PS1 HLE BIOS
 #define DEBUG_SPU	(0)		// debug PS1 SPU read/write
@@ -61,82 +62,21 @@
 
 #define LE32(x) FROM_LE32(x)
 
-extern void mips_get_info(uint32_t state, union cpuinfo *info);
-extern void mips_set_info(uint32_t state, union cpuinfo *info);
-extern int psxcpu_verbose;
-extern uint16_t SPUreadRegister(uint32_t reg);
-extern void SPUwriteRegister(uint32_t reg, uint16_t val);
-extern void SPUwriteDMAMem(uint32_t usPSXMem,int iSize);
-extern void SPUreadDMAMem(uint32_t usPSXMem,int iSize);
-extern void mips_shorten_frame(void);
-extern int mips_execute( int cycles );
-extern uint32_t psf2_load_file(const char *file, uint8_t *buf, uint32_t buflen);
-extern uint32_t psf2_load_elf(uint8_t *start, uint32_t len);
-void psx_hw_runcounters(void);
-int mips_get_icount(void);
-void mips_set_icount(int count);
-
-extern int psf_refresh;
+// sound chips, see peops/spu.cc and peops2/spu.cc
+extern uint16_t SPUreadRegister(SPU *spu, uint32_t reg);
+extern void SPUwriteRegister(SPU *spu, uint32_t reg, uint16_t val);
+extern void SPUwriteDMAMem(SPU *spu, uint32_t usPSXMem,int iSize);
+extern void SPUreadDMAMem(SPU *spu, uint32_t usPSXMem,int iSize);
 
 // SPU2
-extern void SPU2write(unsigned long reg, unsigned short val);
-extern unsigned short SPU2read(unsigned long reg);
-extern void SPU2readDMA4Mem(uint32_t usPSXMem,int iSize);
-extern void SPU2writeDMA4Mem(uint32_t usPSXMem,int iSize);
-extern void SPU2readDMA7Mem(uint32_t usPSXMem,int iSize);
-extern void SPU2writeDMA7Mem(uint32_t usPSXMem,int iSize);
-extern void SPU2interruptDMA4(void);
-extern void SPU2interruptDMA7(void);
-
-#define MAX_FILE_SLOTS	(32)
-
-static volatile int softcall_target = 0;
-static int filestat[MAX_FILE_SLOTS];
-static uint8_t *filedata[MAX_FILE_SLOTS];
-static uint32_t filesize[MAX_FILE_SLOTS], filepos[MAX_FILE_SLOTS];
-uint32_t psf2_get_loadaddr(void);
-void psf2_set_loadaddr(uint32_t addr);
-static void call_irq_routine(uint32_t routine, uint32_t parameter);
-static int intr_susp = 0;
-
-static uint64_t sys_time;
-static int timerexp = 0;
-
-typedef struct
-{
-	char name[10];
-	uint32_t dispatch;
-} ExternLibEntries;
-
-static int32_t iNumLibs;
-static ExternLibEntries	reglibs[32];
-
-typedef struct
-{
-	uint32_t type;
-	uint32_t value;
-	uint32_t param;
-	int    inUse;
-} EventFlag;
-
-static int32_t iNumFlags;
-static EventFlag evflags[32];
-
-typedef struct
-{
-	uint32_t attr;
-	uint32_t option;
-	int32_t init;
-	int32_t current;
-	int32_t max;
-	int32_t threadsWaiting;
-	int32_t inuse;
-} Semaphore;
-
-#define SEMA_MAX	(64)
-
-static int32_t iNumSema;
-static Semaphore semaphores[SEMA_MAX];
+extern void SPU2write(SPU2 *spu2, unsigned long reg, unsigned short val);
+extern unsigned short SPU2read(SPU2 *spu2, unsigned long reg);
+extern void SPU2readDMA4Mem(SPU2 *spu2, uint32_t usPSXMem,int iSize);
+extern void SPU2writeDMA4Mem(SPU2 *spu2, uint32_t usPSXMem,int iSize);
+extern void SPU2readDMA7Mem(SPU2 *spu2, uint32_t usPSXMem,int iSize);
+extern void SPU2writeDMA7Mem(SPU2 *spu2, uint32_t usPSXMem,int iSize);
+extern void SPU2interruptDMA4(SPU2 *spu2);
+extern void SPU2interruptDMA7(SPU2 *spu2);
 
 // thread states
 enum
@@ -152,24 +92,6 @@ enum
 	TS_MAXSTATE
 };
 
-typedef struct
-{
-	int32_t  iState;		// state of thread
-
-	uint32_t flags;		// flags
-	uint32_t routine;		// start of code for the thread
-	uint32_t stackloc;	// stack location in IOP RAM
-	uint32_t stacksize;	// stack size
-	uint32_t refCon;		// user value passed in at CreateThread time
-
-	uint32_t waitparm;	// what we're waiting on if in one the TS_WAIT* states
-
-	uint32_t save_regs[37];	// CPU registers belonging to this thread
-} Thread;
-
-static int32_t iNumThreads, iCurThread;
-static Thread threads[32];
-
 #if DEBUG_THREADING
 static char *_ThreadStateNames[TS_MAXSTATE] = { "RUNNING", "READY", "WAITEVFLAG", "WAITSEMA", "WAITDELAY", "SLEEPING", "CREATED" };
 #endif
@@ -178,32 +100,6 @@ static char *_ThreadStateNames[TS_MAXSTATE] = { "RUNNING", "READY", "WAITEVFLAG"
 static char *seek_types[3] = { "SEEK_SET", "SEEK_CUR", "SEEK_END" };
 #endif
 
-typedef struct
-{
-	int32_t  iActive;
-	uint32_t count;
-	uint32_t target;
-	uint32_t source;
-	uint32_t prescale;
-	uint32_t handler;
-	uint32_t hparam;
-	uint32_t mode;
-} IOPTimer;
-
-static IOPTimer iop_timers[8];
-static int32_t iNumTimers;
-
-typedef struct
-{
-	uint32_t count;
-	uint32_t mode;
-	uint32_t target;
-	uint32_t sysclock;
-	uint32_t interrupt;
-} Counter;
-
-static Counter root_cnts[4];	// 4 of the bastards
-
 #define CLOCK_DIV	(8)	// 33 MHz / this = what we run the R3000 at to keep the CPU usage not insane
 
 // counter modes
@@ -214,17 +110,6 @@ static Counter root_cnts[4];	// 4 of the bastards
 #define RC_CLC		(0x0100)	// counter uses direct system clock
 #define RC_DIV8		(0x0200)	// (counter 2 only) system clock/8
 
-typedef struct
-{
-	uint32_t desc;
-	int32_t status;
-	int32_t mode;
-	uint32_t fhandler;
-} EvtCtrlBlk[32];
-
-static EvtCtrlBlk *Event;
-static EvtCtrlBlk *CounterEvent;
-
 // Sony event states
 #define EvStUNUSED	0x0000
 #define EvStWAIT	0x1000
@@ -235,21 +120,8 @@ static EvtCtrlBlk *CounterEvent;
 #define EvMdINTR	0x1000
 #define EvMdNOINTR	0x2000
 
-// PSX main RAM
-uint32_t psx_ram[(2*1024*1024)/4];
-uint32_t psx_scratch[0x400];
-// backup image to restart songs
-uint32_t initial_ram[(2*1024*1024)/4];
-uint32_t initial_scratch[0x400];
-
-static uint32_t spu_delay, dma_icr, irq_data, irq_mask, dma_timer, WAI;
-static uint32_t dma4_madr, dma4_bcr, dma4_chcr, dma4_delay;
-static uint32_t dma7_madr, dma7_bcr, dma7_chcr, dma7_delay;
-static uint32_t dma4_cb, dma7_cb, dma4_fval, dma4_flag, dma7_fval, dma7_flag;
-static uint32_t irq9_cb, irq9_fval, irq9_flag;
-
 // take a snapshot of the CPU state for a thread
-static void FreezeThread(int32_t iThread, int flag)
+void PSX::FreezeThread(int32_t iThread, int flag)
 {
 	int i;
 	union cpuinfo mipsinfo;
@@ -303,7 +175,7 @@ static void FreezeThread(int32_t iThread, int flag)
 }
 
 // restore the CPU state from a thread's snapshot
-static void ThawThread(int32_t iThread)
+void PSX::ThawThread(int32_t iThread)
 {
 	int i;
 	union cpuinfo mipsinfo;
@@ -357,7 +229,7 @@ static void ThawThread(int32_t iThread)
 }
 
 // find a new thread to run
-static void ps2_reschedule(void)
+void PSX::ps2_reschedule(void)
 {
 	int i, starti, iNextThread;
 
@@ -450,7 +322,7 @@ static void ps2_reschedule(void)
 	}
 }
 
-static void psx_irq_update(void)
+void PSX::psx_irq_update(void)
 {
 	union cpuinfo mipsinfo;
 
@@ -468,16 +340,15 @@ static void psx_irq_update(void)
 	}
 }
 
-void psx_irq_set(uint32_t irq)
+void PSX::psx_irq_set(uint32_t irq)
 {
 	irq_data |= irq;
 
 	psx_irq_update();
 }
 
-static uint32_t gpu_stat = 0;
 
-uint32_t psx_hw_read(offs_t offset, uint32_t mem_mask)
+uint32_t PSX::psx_hw_read(offs_t offset, uint32_t mem_mask)
 {
 	if (offset >= 0x00000000 && offset <= 0x007fffff)
 	{
@@ -519,14 +390,14 @@ uint32_t psx_hw_read(offs_t offset, uint32_t mem_mask)
 			#if DEBUG_SPU
 			printf("SPU: readRegister(%x)\n", offset);
 			#endif
-			return SPUreadRegister(offset) & ~mem_mask;
+			return SPUreadRegister(ctx->spu, offset) & ~mem_mask;
 		}
 		else if (mem_mask == 0x0000ffff)
 		{
 			#if DEBUG_SPU
 			printf("SPU: readRegister(%x)\n", offset);
 			#endif
-			return SPUreadRegister(offset)<<16;
+			return SPUreadRegister(ctx->spu, offset)<<16;
 		}
 		else printf("SPU: read unknown mask %08x\n", mem_mask);
 	}
@@ -535,15 +406,15 @@ uint32_t psx_hw_read(offs_t offset, uint32_t mem_mask)
 	{
 		if ((mem_mask == 0xffff0000) || (mem_mask == 0xffffff00))
 		{
-			return SPU2read(offset) & ~mem_mask;
+			return SPU2read(ctx->spu2, offset) & ~mem_mask;
 		}
 		else if (mem_mask == 0x0000ffff)
 		{
-			return SPU2read(offset)<<16;
+			return SPU2read(ctx->spu2, offset)<<16;
 		}
 		else if (mem_mask == 0)
 		{
-			return SPU2read(offset) | SPU2read(offset+2)<<16;
+			return SPU2read(ctx->spu2, offset) | SPU2read(ctx->spu2, offset+2)<<16;
 		}
 		else printf("SPU2: read unknown mask %08x\n", mem_mask);
 	}
@@ -606,7 +477,7 @@ uint32_t psx_hw_read(offs_t offset, uint32_t mem_mask)
 	return 0;
 }
 
-static void psx_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
+void PSX::psx_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 {
 	if (chcr == 0x01000201)	// cpu to SPU
 	{
@@ -614,7 +485,7 @@ static void psx_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 		printf("DMA4: RAM %08x to SPU\n", madr);
 		#endif
 		bcr = (bcr>>16) * (bcr & 0xffff) * 2;
-		SPUwriteDMAMem(madr&0x1fffff, bcr);
+		SPUwriteDMAMem(ctx->spu, madr&0x1fffff, bcr);
 	}
 	else
 	{
@@ -622,11 +493,11 @@ static void psx_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 		printf("DMA4: SPU to RAM %08x\n", madr);
 		#endif
 		bcr = (bcr>>16) * (bcr & 0xffff) * 2;
-		SPUreadDMAMem(madr&0x1fffff, bcr);
+		SPUreadDMAMem(ctx->spu, madr&0x1fffff, bcr);
 	}
 }
 
-static void ps2_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
+void PSX::ps2_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 {
 	if (chcr == 0x01000201)	// cpu to SPU2
 	{
@@ -634,7 +505,7 @@ static void ps2_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 		printf("DMA4: RAM %08x to SPU2\n", madr);
 		#endif
 		bcr = (bcr>>16) * (bcr & 0xffff) * 4;
-		SPU2writeDMA4Mem(madr&0x1fffff, bcr);
+		SPU2writeDMA4Mem(ctx->spu2, madr&0x1fffff, bcr);
 	}
 	else
 	{
@@ -642,13 +513,13 @@ static void ps2_dma4(uint32_t madr, uint32_t bcr, uint32_t chcr)
 		printf("DMA4: SPU2 to RAM %08x\n", madr);
 		#endif
 		bcr = (bcr>>16) * (bcr & 0xffff) * 4;
-		SPU2readDMA4Mem(madr&0x1fffff, bcr);
+		SPU2readDMA4Mem(ctx->spu2, madr&0x1fffff, bcr);
 	}
 
 	dma4_delay = 80;
 }
 
-static void ps2_dma7(uint32_t madr, uint32_t bcr, uint32_t chcr)
+void PSX::ps2_dma7(uint32_t madr, uint32_t bcr, uint32_t chcr)
 {
 	if ((chcr == 0x01000201) || (chcr == 0x00100010) || (chcr == 0x000f0010) || (chcr == 0x00010010))	// cpu to SPU2
 	{
@@ -656,7 +527,7 @@ static void ps2_dma7(uint32_t madr, uint32_t bcr, uint32_t chcr)
 		printf("DMA7: RAM %08x to SPU2\n", madr);
 		#endif
 		bcr = (bcr>>16) * (bcr & 0xffff) * 4;
-		SPU2writeDMA7Mem(madr&0x1fffff, bcr);
+		SPU2writeDMA7Mem(ctx->spu2, madr&0x1fffff, bcr);
 	}
 	else
 	{
@@ -670,7 +541,7 @@ static void ps2_dma7(uint32_t madr, uint32_t bcr, uint32_t chcr)
 	dma7_delay = 80;
 }
 
-void psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask)
+void PSX::psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask)
 {
 	union cpuinfo mipsinfo;
 
@@ -707,12 +578,12 @@ void psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask)
 	{
 		if (mem_mask == 0xffff0000)
 		{
-			SPUwriteRegister(offset, data);
+			SPUwriteRegister(ctx->spu, offset, data);
 			return;
 		}
 		else if (mem_mask == 0x0000ffff)
 		{
-			SPUwriteRegister(offset, data>>16);
+			SPUwriteRegister(ctx->spu, offset, data>>16);
 			return;
 		}
 		else printf("SPU: write unknown mask %08x\n", mem_mask);
@@ -722,18 +593,18 @@ void psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask)
 	{
 		if (mem_mask == 0xffff0000)
 		{
-			SPU2write(offset, data);
+			SPU2write(ctx->spu2, offset, data);
 			return;
 		}
 		else if (mem_mask == 0x0000ffff)
 		{
-			SPU2write(offset, data>>16);
+			SPU2write(ctx->spu2, offset, data>>16);
 			return;
 		}
 		else if (mem_mask == 0)
 		{
-			SPU2write(offset, data & 0xffff);
-			SPU2write(offset+2, data>>16);
+			SPU2write(ctx->spu2, offset, data & 0xffff);
+			SPU2write(ctx->spu2, offset+2, data>>16);
 			return;
 		}
 		else printf("SPU2: write unknown mask %08x\n", mem_mask);
@@ -868,7 +739,7 @@ void psx_hw_write(offs_t offset, uint32_t data, uint32_t mem_mask)
 }
 
 // called per sample, 1/44100th of a second (768 clock cycles)
-void psx_hw_slice(void)
+void PSX::psx_hw_slice(void)
 {
 	psx_hw_runcounters();
 
@@ -886,7 +757,7 @@ void psx_hw_slice(void)
 	}
 }
 
-void ps2_hw_slice(void)
+void PSX::ps2_hw_slice(void)
 {
 	int i = 0;
 
@@ -912,9 +783,8 @@ void ps2_hw_slice(void)
 	}
 }
 
-static int fcnt = 0;
 
-void psx_hw_frame(void)
+void PSX::psx_hw_frame(void)
 {
 	if (psf_refresh == 50)
 	{
@@ -935,7 +805,7 @@ void psx_hw_frame(void)
 	}
 }
 
-void ps2_hw_frame(void)
+void PSX::ps2_hw_frame(void)
 {
 	ps2_reschedule();
 }
@@ -951,18 +821,11 @@ enum
 	BLK_BK = 12
 };
 
-static uint32_t heap_addr, entry_int = 0;
 
-extern uint32_t mips_get_cause(void);
-extern uint32_t mips_get_status(void);
-extern void mips_set_status(uint32_t status);
-extern uint32_t mips_get_ePC(void);
 
-static uint32_t irq_regs[37];
 
-static int irq_mutex = 0;
 
-static void call_irq_routine(uint32_t routine, uint32_t parameter)
+void PSX::call_irq_routine(uint32_t routine, uint32_t parameter)
 {
 	int j, oldICount;
 	union cpuinfo mipsinfo;
@@ -1038,7 +901,7 @@ static void call_irq_routine(uint32_t routine, uint32_t parameter)
 	irq_mutex = 0;
 }
 
-void psx_bios_exception(uint32_t pc)
+void PSX::psx_bios_exception(uint32_t pc)
 {
 	uint32_t a0, status;
 	union cpuinfo mipsinfo;
@@ -1234,7 +1097,7 @@ void psx_bios_exception(uint32_t pc)
 	}
 }
 
-static uint32_t calc_ev(uint32_t a0)
+uint32_t PSX::calc_ev(uint32_t a0)
 {
 	uint32_t ev;
 
@@ -1249,7 +1112,7 @@ static uint32_t calc_ev(uint32_t a0)
 	return ev;
 }
 
-static uint32_t calc_spec(uint32_t a1)
+uint32_t PSX::calc_spec(uint32_t a1)
 {
 	uint32_t spec = 0;
 	int i;
@@ -1277,7 +1140,7 @@ static uint32_t calc_spec(uint32_t a1)
 	return spec;
 }
 
-void psx_hw_init(void)
+void PSX::psx_hw_init(void)
 {
 	timerexp = 0;
 
@@ -1341,7 +1204,68 @@ void psx_hw_init(void)
 	root_cnts[3].interrupt = 1;
 }
 
-void psx_bios_hle(uint32_t pc)
+// list everything psx_hw_slice() and friends change while playing
+void PSX::psx_hw_get_state(ao_state &state)
+{
+	AO_STATE_ADD(state, psx_ram);
+	AO_STATE_ADD(state, psx_scratch);
+
+	AO_STATE_ADD(state, softcall_target);
+	AO_STATE_ADD(state, filestat);
+	AO_STATE_ADD(state, filedata);
+	AO_STATE_ADD(state, filesize);
+	AO_STATE_ADD(state, filepos);
+	AO_STATE_ADD(state, intr_susp);
+	AO_STATE_ADD(state, sys_time);
+	AO_STATE_ADD(state, timerexp);
+	AO_STATE_ADD(state, iNumLibs);
+	AO_STATE_ADD(state, reglibs);
+	AO_STATE_ADD(state, iNumFlags);
+	AO_STATE_ADD(state, evflags);
+	AO_STATE_ADD(state, iNumSema);
+	AO_STATE_ADD(state, semaphores);
+	AO_STATE_ADD(state, iNumThreads);
+	AO_STATE_ADD(state, iCurThread);
+	AO_STATE_ADD(state, threads);
+	AO_STATE_ADD(state, iop_timers);
+	AO_STATE_ADD(state, iNumTimers);
+	AO_STATE_ADD(state, root_cnts);
+	AO_STATE_ADD(state, Event);
+	AO_STATE_ADD(state, CounterEvent);
+
+	AO_STATE_ADD(state, spu_delay);
+	AO_STATE_ADD(state, dma_icr);
+	AO_STATE_ADD(state, irq_data);
+	AO_STATE_ADD(state, irq_mask);
+	AO_STATE_ADD(state, dma_timer);
+	AO_STATE_ADD(state, WAI);
+	AO_STATE_ADD(state, dma4_madr);
+	AO_STATE_ADD(state, dma4_bcr);
+	AO_STATE_ADD(state, dma4_chcr);
+	AO_STATE_ADD(state, dma4_delay);
+	AO_STATE_ADD(state, dma7_madr);
+	AO_STATE_ADD(state, dma7_bcr);
+	AO_STATE_ADD(state, dma7_chcr);
+	AO_STATE_ADD(state, dma7_delay);
+	AO_STATE_ADD(state, dma4_cb);
+	AO_STATE_ADD(state, dma7_cb);
+	AO_STATE_ADD(state, dma4_fval);
+	AO_STATE_ADD(state, dma4_flag);
+	AO_STATE_ADD(state, dma7_fval);
+	AO_STATE_ADD(state, dma7_flag);
+	AO_STATE_ADD(state, irq9_cb);
+	AO_STATE_ADD(state, irq9_fval);
+	AO_STATE_ADD(state, irq9_flag);
+
+	AO_STATE_ADD(state, gpu_stat);
+	AO_STATE_ADD(state, fcnt);
+	AO_STATE_ADD(state, heap_addr);
+	AO_STATE_ADD(state, entry_int);
+	AO_STATE_ADD(state, irq_regs);
+	AO_STATE_ADD(state, irq_mutex);
+}
+
+void PSX::psx_bios_hle(uint32_t pc)
 {
 	uint32_t subcall, status;
 	union cpuinfo mipsinfo;
@@ -1863,7 +1787,7 @@ void psx_bios_hle(uint32_t pc)
 
 // root counters
 
-void psx_hw_runcounters(void)
+void PSX::psx_hw_runcounters(void)
 {
 	int i;
 
@@ -1876,7 +1800,7 @@ void psx_hw_runcounters(void)
 
 			if (dma4_delay == 0)
 			{
-				SPU2interruptDMA4();
+				SPU2interruptDMA4(ctx->spu2);
 
 				if (dma4_cb)
 				{
@@ -1891,7 +1815,7 @@ void psx_hw_runcounters(void)
 
 			if (dma7_delay == 0)
 			{
-				SPU2interruptDMA7();
+				SPU2interruptDMA7(ctx->spu2);
 
 				if (dma7_cb)
 				{
@@ -1976,14 +1900,14 @@ void psx_hw_runcounters(void)
 
 // PEOpS callbacks
 
-void SPUirq(void)
+void PSX::SPUirq(void)
 {
 //	psx_irq_set(0x200);
 }
 
 // PSXCPU callbacks
 
-uint8_t program_read_byte_32le(offs_t address)
+uint8_t PSX::program_read_byte_32le(offs_t address)
 {
 	switch (address & 0x3)
 	{
@@ -2004,7 +1928,7 @@ uint8_t program_read_byte_32le(offs_t address)
 	return psx_hw_read(address, 0xffffff00);
 }
 
-uint16_t program_read_word_32le(offs_t address)
+uint16_t PSX::program_read_word_32le(offs_t address)
 {
 	if (address & 2)
 		return psx_hw_read(address, 0x0000ffff)>>16;
@@ -2012,12 +1936,12 @@ uint16_t program_read_word_32le(offs_t address)
 	return psx_hw_read(address, 0xffff0000);
 }
 
-uint32_t program_read_dword_32le(offs_t address)
+uint32_t PSX::program_read_dword_32le(offs_t address)
 {
 	return psx_hw_read(address, 0);
 }
 
-void program_write_byte_32le(offs_t address, uint8_t data)
+void PSX::program_write_byte_32le(offs_t address, uint8_t data)
 {
 	switch (address & 0x3)
 	{
@@ -2036,7 +1960,7 @@ void program_write_byte_32le(offs_t address, uint8_t data)
 	}
 }
 
-void program_write_word_32le(offs_t address, uint16_t data)
+void PSX::program_write_word_32le(offs_t address, uint16_t data)
 {
 	if (address & 2)
 	{
@@ -2047,13 +1971,13 @@ void program_write_word_32le(offs_t address, uint16_t data)
 	psx_hw_write(address, data, 0xffff0000);
 }
 
-void program_write_dword_32le(offs_t address, uint32_t data)
+void PSX::program_write_dword_32le(offs_t address, uint32_t data)
 {
 	psx_hw_write(address, data, 0);
 }
 
 // sprintf replacement
-static void iop_sprintf(char *out, char *fmt, uint32_t pstart)
+void PSX::iop_sprintf(char *out, char *fmt, uint32_t pstart)
 {
 	char temp[64], tfmt[64];
 	char *cf, *pstr;
@@ -2149,7 +2073,7 @@ static void iop_sprintf(char *out, char *fmt, uint32_t pstart)
 }
 
 // PS2 IOP callbacks
-void psx_iop_call(uint32_t pc, uint32_t callnum)
+void PSX::psx_iop_call(uint32_t pc, uint32_t callnum)
 {
 	uint32_t scan;
 	char *mname, *str1, name[9], out[512];
@@ -2275,14 +2199,14 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 					psx_ram[a0], psx_ram[a0+1], psx_ram[a0+2], psx_ram[a0+3], psx_ram[a0+4]);
 				#endif
 
-				newAlloc = psf2_get_loadaddr();
+				newAlloc = psf2_get_loadaddr(ctx);
 				// force 16-byte alignment
 				if (newAlloc & 0xf)
 				{
 					newAlloc &= ~0xf;
 					newAlloc += 16;
 				}
-				psf2_set_loadaddr(newAlloc + LE32(psx_ram[a0+3]));
+				psf2_set_loadaddr(ctx, newAlloc + LE32(psx_ram[a0+3]));
 
 				threads[iNumThreads].iState = TS_CREATED;
 				threads[iNumThreads].stackloc = newAlloc;
@@ -3154,7 +3078,7 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 		switch (callnum)
 		{
 			case 4:	// AllocMemory
-				newAlloc = psf2_get_loadaddr();
+				newAlloc = psf2_get_loadaddr(ctx);
 				// make sure we're 16-byte aligned
 				if (newAlloc & 15)
 				{
@@ -3168,7 +3092,7 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 					a1 += 16;
 				}
 
-				psf2_set_loadaddr(newAlloc + a1);
+				psf2_set_loadaddr(ctx, newAlloc + a1);
 
 				#if DEBUG_HLE_IOP
 				printf("IOP: AllocMemory(%d, %d, %x) = %08x\n", a0, a1, a2, newAlloc|0x80000000);
@@ -3189,7 +3113,7 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 				printf("IOP: QueryMaxFreeMemSize\n");
 				#endif
 
-				mipsinfo.i = (2*1024*1024) - psf2_get_loadaddr();
+				mipsinfo.i = (2*1024*1024) - psf2_get_loadaddr(ctx);
 				mips_set_info(CPUINFO_INT_REGISTER + MIPS_R2, &mipsinfo);
 				break;
 
@@ -3198,7 +3122,7 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 				printf("IOP: QueryTotalFreeMemSize\n");
 				#endif
 
-				mipsinfo.i = (2*1024*1024) - psf2_get_loadaddr();
+				mipsinfo.i = (2*1024*1024) - psf2_get_loadaddr(ctx);
 				mips_set_info(CPUINFO_INT_REGISTER + MIPS_R2, &mipsinfo);
 				break;
 
@@ -3254,22 +3178,22 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 				#endif
 
 				// get 2k for our parameters
-				newAlloc = psf2_get_loadaddr();
+				newAlloc = psf2_get_loadaddr(ctx);
 				// force 16-byte alignment
 				if (newAlloc & 0xf)
 				{
 					newAlloc &= ~0xf;
 					newAlloc += 16;
 				}
-				psf2_set_loadaddr(newAlloc + 2048);
+				psf2_set_loadaddr(ctx, newAlloc + 2048);
 
 				tempmem = (uint8_t *)malloc(2*1024*1024);
-				if (psf2_load_file(mname, tempmem, 2*1024*1024) != 0xffffffff)
+				if (psf2_load_file(ctx, mname, tempmem, 2*1024*1024) != 0xffffffff)
 				{
 					uint32_t start;
 					int i;
 
-					start = psf2_load_elf(tempmem, 2*1024*1024);
+					start = psf2_load_elf(ctx, tempmem, 2*1024*1024);
 
 					if (start != 0xffffffff)
 					{
@@ -3377,7 +3301,7 @@ void psx_iop_call(uint32_t pc, uint32_t callnum)
 					#endif
 
 					filedata[slot2use] = (uint8_t *) malloc(6*1024*1024);
-					filesize[slot2use] = psf2_load_file(mname, filedata[slot2use], 6*1024*1024);
+					filesize[slot2use] = psf2_load_file(ctx, mname, filedata[slot2use], 6*1024*1024);
 					filepos[slot2use] = 0;
 					filestat[slot2use] = 1;
 
@@ -0,0 +1,200 @@
+/*
+ * Saved emulator states for seeking in PSF, PSF2 and SPU files
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <string.h>
+
+#include <libaudcore/runtime.h>
+
+#include "snapshot.h"
+
+static constexpr int page_size = 4096;
+static constexpr int64_t max_bytes = 64 << 20;
+
+struct SnapshotCache::Page
+{
+    int refs;
+    char data[page_size];
+};
+
+/* Walks through the state regions one page at a time, as if they were a
+ * single block of memory. */
+class PageWalker
+{
+public:
+    PageWalker (ao_state & regions) :
+        m_regions (regions) {}
+
+    /* copies the next page of state into buf, returning false at the end */
+    bool read (char * buf)
+    {
+        return transfer (buf, true);
+    }
+
+    /* copies buf into the next page of state */
+    void write (const char * buf)
+    {
+        transfer ((char *) buf, false);
+    }
+
+private:
+    ao_state & m_regions;
+    int m_region = 0;
+    uint32_t m_offset = 0;
+
+    bool transfer (char * buf, bool reading)
+    {
+        int fill = 0;
+
+        while (fill < page_size && m_region < m_regions.len ())
+        {
+            ao_state_region & region = m_regions[m_region];
+            char * data = (char *) region.data + m_offset;
+            int len = aud::min (page_size - fill, (int) (region.size - m_offset));
+
+            if (reading)
+                memcpy (buf + fill, data, len);
+            else
+                memcpy (data, buf + fill, len);
+
+            fill += len;
+            m_offset += len;
+
+            if (m_offset == region.size)
+            {
+                m_region ++;
+                m_offset = 0;
+            }
+        }
+
+        if (reading && fill < page_size)
+            memset (buf + fill, 0, page_size - fill);
+
+        return fill > 0;
+    }
+};
+
+void SnapshotCache::reset (ao_state && regions)
+{
+    clear ();
+    m_regions = std::move (regions);
+}
+
+void SnapshotCache::clear ()
+{
+    while (m_snapshots.len ())
+        remove (m_snapshots.len () - 1);
+
+    m_regions.clear ();
+}
+
+int SnapshotCache::find (int time) const
+{
+    int index = -1;
+
+    for (int i = 0; i < m_snapshots.len () && m_snapshots[i].time <= time; i ++)
+        index = i;
+
+    return index;
+}
+
+void SnapshotCache::save (int time)
+{
+    int pos = find (time) + 1;
+
+    if (pos > 0 && m_snapshots[pos - 1].time == time)
+        return;
+
+    /* unchanged pages are shared with the preceding snapshot */
+    const Snapshot * prev = (pos > 0) ? & m_snapshots[pos - 1] : nullptr;
+
+    Snapshot snapshot;
+    snapshot.time = time;
+
+    PageWalker walker (m_regions);
+    Page * page = new Page;
+
+    while (walker.read (page->data))
+    {
+        int i = snapshot.pages.len ();
+
+        if (prev && ! memcmp (prev->pages[i]->data, page->data, page_size))
+        {
+            prev->pages[i]->refs ++;
+            snapshot.pages.append (prev->pages[i]);
+        }
+        else
+        {
+            page->refs = 1;
+            snapshot.pages.append (page);
+            m_bytes += page_size;
+            page = new Page;
+        }
+    }
+
+    delete page;
+
+    m_snapshots.insert (pos, 1);
+    m_snapshots[pos] = std::move (snapshot);
+
+    AUDDBG ("Saved state at %d ms, %d KB used.\n", time, (int) (m_bytes >> 10));
+
+    /* thin out the snapshots where they are closest together, but always
+     * keep the first one so that the song can be restarted */
+    while (m_bytes > max_bytes && m_snapshots.len () > 2)
+    {
+        int best = 1, best_gap = -1;
+
+        for (int i = 1; i < m_snapshots.len (); i ++)
+        {
+            int next = (i + 1 < m_snapshots.len ()) ? m_snapshots[i + 1].time : m_snapshots[i].time;
+            int gap = next - m_snapshots[i - 1].time;
+
+            if (best_gap < 0 || gap < best_gap)
+            {
+                best = i;
+                best_gap = gap;
+            }
+        }
+
+        remove (best);
+    }
+}
+
+void SnapshotCache::restore (int index)
+{
+    PageWalker walker (m_regions);
+
+    for (Page * page : m_snapshots[index].pages)
+        walker.write (page->data);
+
+    AUDDBG ("Restored state at %d ms.\n", m_snapshots[index].time);
+}
+
+void SnapshotCache::remove (int index)
+{
+    for (Page * page : m_snapshots[index].pages)
+    {
+        if (! -- page->refs)
+        {
+            delete page;
+            m_bytes -= page_size;
+        }
+    }
+
+    m_snapshots.remove (index, 1);
+}
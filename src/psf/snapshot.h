@@ -0,0 +1,63 @@
+/*
+ * Saved emulator states for seeking in PSF, PSF2 and SPU files
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef PSF_SNAPSHOT_H
+#define PSF_SNAPSHOT_H
+
+#include "ao.h"
+
+/* A bounded set of snapshots of the emulator state, sorted by song position.
+ * The state is stored in fixed-size pages, and pages which have not changed
+ * since the preceding snapshot are shared with it, so that a snapshot costs
+ * only the memory the song has touched in between.  When the cache grows too
+ * large, snapshots are dropped where they are densest. */
+class SnapshotCache
+{
+public:
+    ~SnapshotCache ()
+        { clear (); }
+
+    /* starts over with a new set of state regions (after starting the engine) */
+    void reset (ao_state && regions);
+    void clear ();
+
+    /* index of the latest snapshot taken at or before time, or -1 */
+    int find (int time) const;
+    int time (int index) const
+        { return m_snapshots[index].time; }
+
+    void save (int time);
+    void restore (int index);
+
+private:
+    struct Page;
+
+    struct Snapshot
+    {
+        int time;
+        Index<Page *> pages;
+    };
+
+    ao_state m_regions;
+    Index<Snapshot> m_snapshots;
+    int64_t m_bytes = 0;
+
+    void remove (int index);
+};
+
+#endif
@@ -33,6 +33,7 @@
 
 #include "xs_config.h"
 #include "xs_sidplay2.h"
+#include "../pcm-cache/pcm-cache.h"
 
 class SIDPlugin : public InputPlugin
 {
@@ -159,8 +160,35 @@ bool SIDPlugin::play(const char *filename, VFSFile &file)
             tmpLength = xs_cfg.playMinTime;
     }
 
+    /* Look up the rendered sub-tune.  The emulation settings only change
+     * on restart, so xs_cfg describes the running engine. */
+    PCMCacheKey key;
+    PCMCacheReader cache;
+    PCMCacheWriter writer;
+    bool useCache = pcm_cache_enabled();
+
+    if (useCache) {
+        key.add("sid");
+        key.add(buf.begin(), buf.len());
+        key.add(subTune);
+        key.add(tmpLength);
+        key.add(xs_cfg.audioChannels);
+        key.add(xs_cfg.audioFrequency);
+        key.add(xs_cfg.mos8580);
+        key.add(xs_cfg.forceModel);
+        key.add(xs_cfg.clockSpeed);
+        key.add(xs_cfg.forceSpeed);
+        key.add(xs_cfg.emulateFilters);
+        key.add(xs_cfg.playMaxTimeEnable);
+        key.add(xs_cfg.playMaxTimeUnknown);
+        key.add(xs_cfg.playMaxTime);
+    }
+
+    bool cached = useCache &&
+        cache.open(key, xs_cfg.audioFrequency, xs_cfg.audioChannels);
+
     /* Initialize song */
-    if (!xs_sidplayfp_initsong(subTune)) {
+    if (!cached && !xs_sidplayfp_initsong(subTune)) {
         AUDERR("Couldn't initialize SID-tune '%s' (sub-tune #%i)!\n",
             filename, subTune);
         return false;
@@ -177,7 +205,25 @@ bool SIDPlugin::play(const char *filename, VFSFile &file)
     char *audioBuffer = new char[audioBufSize];
     int64_t bytes_played = 0;
 
-    while (! check_stop ())
+    /* Unlike the emulator, the cache can seek */
+    while (cached && ! check_stop ())
+    {
+        int seek_value = check_seek ();
+        if (seek_value >= 0)
+            cache.seek(seek_value);
+
+        int bytes = cache.read(audioBuffer, 4096);
+        if (!bytes)
+            break;
+
+        write_audio (audioBuffer, bytes);
+    }
+
+    /* A sub-tune with no known end would only fill the disk */
+    if (!cached && useCache && (tmpLength >= 0 || xs_cfg.playMaxTimeEnable))
+        writer.open(key, xs_cfg.audioFrequency, xs_cfg.audioChannels);
+
+    while (! cached && ! check_stop ())
     {
         if (check_seek () >= 0)
             AUDWARN ("Seeking is not implemented, ignoring.\n");
@@ -185,6 +231,7 @@ bool SIDPlugin::play(const char *filename, VFSFile &file)
         int bufRemaining = xs_sidplayfp_fillbuffer(audioBuffer, audioBufSize);
 
         write_audio (audioBuffer, bufRemaining);
+        writer.write(audioBuffer, bufRemaining);
         bytes_played += bufRemaining;
 
         /* Check if we have played enough */
@@ -208,6 +255,10 @@ bool SIDPlugin::play(const char *filename, VFSFile &file)
         }
     }
 
+    /* Only a sub-tune played to its end is cached */
+    if (! check_stop ())
+        writer.commit();
+
     delete[] audioBuffer;
 
     return true;
@@ -23,6 +23,7 @@
 
 #include "xmms-sid.h"
 #include "xs_config.h"
+#include "../pcm-cache/pcm-cache.h"
 
 #include <libaudcore/i18n.h>
 #include <libaudcore/preferences.h>
@@ -102,6 +103,11 @@ static constexpr PreferencesWidget widgets[] = {
         WidgetInt("sid", "subAutoMinTime"),
         {5, 3600, 5, N_("seconds")},
         WIDGET_CHILD),
+#ifdef PCM_CACHE
+    WidgetLabel(N_("<b>Cache</b>")),
+    WidgetCheck(N_("Keep rendered audio on disk"),
+        WidgetBool("pcm-cache", "enabled")),
+#endif
     WidgetLabel(N_("<b>Note</b>")),
     WidgetLabel(N_("These settings will take effect when Audacious is restarted."))
 };
@@ -113,6 +119,7 @@ const PluginPreferences sid_prefs = {{widgets}};
 void xs_init_configuration()
 {
     aud_config_set_defaults("sid", defaults);
+    pcm_cache_init();
 
     /* Initialize values with sensible defaults */
     xs_cfg.audioChannels = aud_get_int("sid", "audioChannels");
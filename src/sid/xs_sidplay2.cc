@@ -26,12 +26,11 @@
 
 #include "xs_config.h"
 #include "xs_sidplay2.h"
+#include "xs_slsdb.h"
 
-#include <pthread.h>
 #include <string.h>
 
 #include <sidplayfp/sidplayfp.h>
-#include <sidplayfp/SidDatabase.h>
 #include <sidplayfp/SidInfo.h>
 #include <sidplayfp/SidTune.h>
 #include <sidplayfp/SidTuneInfo.h>
@@ -45,9 +44,7 @@ struct SidState {
     sidbuilder *currBuilder;
     SidTune *currTune;
 
-    SidDatabase database;
     bool database_loaded = false;
-    pthread_mutex_t database_mutex = PTHREAD_MUTEX_INITIALIZER;
 };
 
 static SidState state;
@@ -155,7 +152,7 @@ bool xs_sidplayfp_init()
     }
 
     /* Load song length database */
-    state.database_loaded = state.database.open(SIDDATADIR "sidplayfp/Songlengths.txt");
+    state.database_loaded = xs_slsdb_open(SIDDATADIR "sidplayfp/Songlengths.txt");
 
     /* Create the sidtune */
     state.currTune = new SidTune(0);
@@ -184,8 +181,10 @@ void xs_sidplayfp_close()
         state.currTune = nullptr;
     }
 
-    if (state.database_loaded)
-        state.database.close();
+    if (state.database_loaded) {
+        xs_slsdb_close();
+        state.database_loaded = false;
+    }
 }
 
 
@@ -252,15 +251,12 @@ bool xs_sidplayfp_getinfo(xs_tuneinfo_t &ti, const void *buf, int64_t bufSize)
 
     if (state.database_loaded)
     {
-        pthread_mutex_lock(&state.database_mutex);
+        /* the MD5 covers all subtunes */
+        char md5[SidTune::MD5_LENGTH + 1];
+        myTune.createMD5(md5);
 
         for (int i = 0; i < ti.nsubTunes; i++)
-        {
-            myTune.selectSong(i + 1);
-            ti.subTunes[i].tuneLength = state.database.length(myTune);
-        }
-
-        pthread_mutex_unlock(&state.database_mutex);
+            ti.subTunes[i].tuneLength = xs_slsdb_length(md5, i + 1);
     }
 
     return true;
@@ -0,0 +1,353 @@
+/*
+   XMMS-SID - SIDPlay input plugin for X MultiMedia System (XMMS)
+
+   Compiled song length database
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "xs_slsdb.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/index.h>
+#include <libaudcore/runtime.h>
+
+#define XS_SLSDB_MAGIC "XSSLDB01"
+
+/* Layout of the compiled table: a header, the tunes sorted by MD5, and the
+ * lengths of their subtunes.  It is only ever read back on the machine that
+ * wrote it, so everything is in host byte order.
+ */
+typedef struct {
+    char magic[8];
+    int64_t srcTime, srcSize;   /* of the text file it was compiled from */
+    uint32_t nTunes, nLengths;
+} xs_slsdb_header_t;
+
+typedef struct {
+    uint8_t md5[16];
+    uint32_t first, count;      /* subtune lengths, index into the lengths */
+} xs_slsdb_tune_t;
+
+static struct {
+    void *map;
+    size_t mapSize;
+    Index<char> image;          /* used instead if the table cannot be saved */
+
+    const xs_slsdb_header_t *header;
+    const xs_slsdb_tune_t *tunes;
+    const uint32_t *lengths;    /* milliseconds, 0 if unknown */
+} xs_slsdb;
+
+
+static StringBuf xs_slsdb_path()
+{
+    return filename_build({aud_get_path(AudPath::UserDir), "sid-songlengths"});
+}
+
+
+static int xs_hexdigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+
+static bool xs_slsdb_parse_md5(const char *str, uint8_t *md5)
+{
+    for (int i = 0; i < 16; i++) {
+        int hi = xs_hexdigit(str[2 * i]);
+        int lo = xs_hexdigit(str[2 * i + 1]);
+
+        if (hi < 0 || lo < 0)
+            return false;
+
+        md5[i] = hi << 4 | lo;
+    }
+
+    return true;
+}
+
+
+static bool xs_isspace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+/* Parses one "m:ss" or "m:ss.mmm" length, followed by optional attributes
+ * like "(G)".  Returns the length in milliseconds, or 0 if it is malformed.
+ */
+static uint32_t xs_slsdb_parse_length(const char *&str)
+{
+    uint32_t min = 0, sec = 0, msec = 0;
+    bool valid = false;
+
+    for (; *str >= '0' && *str <= '9'; str++)
+        min = min * 10 + (*str - '0');
+
+    if (*str == ':' && str[1] >= '0' && str[1] <= '9') {
+        for (str++; *str >= '0' && *str <= '9'; str++)
+            sec = sec * 10 + (*str - '0');
+
+        valid = true;
+    }
+
+    if (valid && *str == '.') {
+        int scale = 100;
+        for (str++; *str >= '0' && *str <= '9'; str++, scale /= 10)
+            msec += (*str - '0') * scale;
+    }
+
+    while (*str && !xs_isspace(*str))
+        str++;
+
+    return valid ? (min * 60 + sec) * 1000 + msec : 0;
+}
+
+
+/* Parses a "<md5>=<length> <length> ..." line; anything else is skipped.
+ */
+static bool xs_slsdb_parse_line(const char *line, xs_slsdb_tune_t &tune,
+    Index<uint32_t> &lengths)
+{
+    if (strlen(line) < 33 || line[32] != '=' || !xs_slsdb_parse_md5(line, tune.md5))
+        return false;
+
+    tune.first = lengths.len();
+
+    for (const char *str = line + 33;;) {
+        while (xs_isspace(*str))
+            str++;
+
+        if (!*str)
+            break;
+
+        lengths.append(xs_slsdb_parse_length(str));
+    }
+
+    tune.count = lengths.len() - tune.first;
+    return tune.count > 0;
+}
+
+
+static bool xs_slsdb_compile(const char *txtPath, const struct stat &st,
+    Index<char> &image)
+{
+    FILE *handle = fopen(txtPath, "r");
+    if (!handle)
+        return false;
+
+    Index<xs_slsdb_tune_t> tunes;
+    Index<uint32_t> lengths;
+    xs_slsdb_tune_t tune;
+
+    char *line = nullptr;
+    size_t size = 0;
+
+    while (getline(&line, &size, handle) >= 0) {
+        if (xs_slsdb_parse_line(line, tune, lengths))
+            tunes.append(tune);
+    }
+
+    free(line);
+    fclose(handle);
+
+    if (!tunes.len())
+        return false;
+
+    tunes.sort([] (const xs_slsdb_tune_t &a, const xs_slsdb_tune_t &b)
+        { return memcmp(a.md5, b.md5, sizeof a.md5); });
+
+    xs_slsdb_header_t header;
+    memcpy(header.magic, XS_SLSDB_MAGIC, sizeof header.magic);
+    header.srcTime = st.st_mtime;
+    header.srcSize = st.st_size;
+    header.nTunes = tunes.len();
+    header.nLengths = lengths.len();
+
+    image.clear();
+    image.insert((const char *)&header, -1, sizeof header);
+    image.insert((const char *)tunes.begin(), -1, tunes.len() * sizeof(xs_slsdb_tune_t));
+    image.insert((const char *)lengths.begin(), -1, lengths.len() * sizeof(uint32_t));
+
+    return true;
+}
+
+
+/* Points the lookups at a compiled table, if it is complete and up to date.
+ */
+static bool xs_slsdb_set(const char *data, size_t size, const struct stat &st)
+{
+    const xs_slsdb_header_t *header = (const xs_slsdb_header_t *)data;
+
+    if (size < sizeof *header || memcmp(header->magic, XS_SLSDB_MAGIC, sizeof header->magic) ||
+        header->srcTime != st.st_mtime || header->srcSize != st.st_size ||
+        size != sizeof *header + (size_t)header->nTunes * sizeof(xs_slsdb_tune_t) +
+        (size_t)header->nLengths * sizeof(uint32_t))
+        return false;
+
+    xs_slsdb.header = header;
+    xs_slsdb.tunes = (const xs_slsdb_tune_t *)(header + 1);
+    xs_slsdb.lengths = (const uint32_t *)(xs_slsdb.tunes + header->nTunes);
+
+    return true;
+}
+
+
+static bool xs_slsdb_map_file(const char *binPath, const struct stat &st)
+{
+    int fd = open(binPath, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat binSt;
+    if (fstat(fd, &binSt) < 0 || binSt.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = binSt.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    if (!xs_slsdb_set((const char *)map, size, st)) {
+        munmap(map, size);
+        return false;
+    }
+
+    xs_slsdb.map = map;
+    xs_slsdb.mapSize = size;
+    return true;
+}
+
+
+/* Writes the table under a temporary name first, so that other instances
+ * never map a partly written file.
+ */
+static bool xs_slsdb_save(const char *binPath, const Index<char> &image)
+{
+    StringBuf tmpPath = str_concat({binPath, ".tmp"});
+
+    FILE *handle = fopen(tmpPath, "w");
+    if (!handle)
+        return false;
+
+    bool success = (fwrite(image.begin(), 1, image.len(), handle) == (size_t)image.len());
+    success = !fclose(handle) && success;
+
+    if (success && rename(tmpPath, binPath) < 0)
+        success = false;
+
+    if (!success)
+        unlink(tmpPath);
+
+    return success;
+}
+
+
+bool xs_slsdb_open(const char *txtPath)
+{
+    xs_slsdb_close();
+
+    struct stat st;
+    if (stat(txtPath, &st) < 0)
+        return false;
+
+    StringBuf binPath = xs_slsdb_path();
+    if (xs_slsdb_map_file(binPath, st))
+        return true;
+
+    AUDDBG("Compiling song length database %s.\n", txtPath);
+
+    Index<char> image;
+    if (!xs_slsdb_compile(txtPath, st, image)) {
+        AUDERR("No song lengths found in %s.\n", txtPath);
+        return false;
+    }
+
+    if (xs_slsdb_save(binPath, image) && xs_slsdb_map_file(binPath, st))
+        return true;
+
+    AUDERR("Could not save song length database to %s.\n", (const char *)binPath);
+
+    xs_slsdb.image = std::move(image);
+    return xs_slsdb_set(xs_slsdb.image.begin(), xs_slsdb.image.len(), st);
+}
+
+
+void xs_slsdb_close()
+{
+    if (xs_slsdb.map)
+        munmap(xs_slsdb.map, xs_slsdb.mapSize);
+
+    xs_slsdb.map = nullptr;
+    xs_slsdb.mapSize = 0;
+    xs_slsdb.image.clear();
+
+    xs_slsdb.header = nullptr;
+    xs_slsdb.tunes = nullptr;
+    xs_slsdb.lengths = nullptr;
+}
+
+
+int xs_slsdb_length(const char *md5, int subTune)
+{
+    uint8_t key[16];
+
+    if (!xs_slsdb.header || strlen(md5) != 32 || !xs_slsdb_parse_md5(md5, key))
+        return -1;
+
+    int lo = 0, hi = xs_slsdb.header->nTunes;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const xs_slsdb_tune_t &tune = xs_slsdb.tunes[mid];
+        int diff = memcmp(key, tune.md5, sizeof key);
+
+        if (diff < 0)
+            hi = mid;
+        else if (diff > 0)
+            lo = mid + 1;
+        else {
+            if (subTune < 1 || (uint32_t)subTune > tune.count ||
+                tune.first + tune.count > xs_slsdb.header->nLengths)
+                return -1;
+
+            uint32_t msec = xs_slsdb.lengths[tune.first + subTune - 1];
+            return msec ? (int)(msec / 1000) : -1;
+        }
+    }
+
+    return -1;
+}
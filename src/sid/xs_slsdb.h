@@ -0,0 +1,19 @@
+#ifndef XS_SLSDB_H
+#define XS_SLSDB_H
+
+/* Song length database (HVSC Songlengths.txt).
+ *
+ * The text file is compiled into a table of lengths sorted by MD5, which is
+ * kept in the user's config directory and mapped into memory.  Lookups are a
+ * binary search over the mapping, so only the pages actually searched become
+ * resident.  The table is rebuilt whenever the modification time or size of
+ * the text file changes.
+ */
+bool xs_slsdb_open(const char *txtPath);
+void xs_slsdb_close();
+
+/* Returns the length in seconds of the given (1-based) subtune of the tune
+ * whose MD5 (as 32 hex digits) is given, or -1 if it is not known. */
+int xs_slsdb_length(const char *md5, int subTune);
+
+#endif /* XS_SLSDB_H */
@@ -19,8 +19,14 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <fcntl.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <sndfile.h>
 
@@ -28,6 +34,7 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/i18n.h>
 #include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
 
 class SndfilePlugin : public InputPlugin
 {
@@ -300,6 +307,116 @@ bool SndfilePlugin::read_tag (const char * filename, VFSFile & file, Tuple & tup
     return true;
 }
 
+/* Uncompressed PCM in a local file is mapped into memory and passed to
+ * write_audio() as-is, bypassing libsndfile's conversion to float. */
+
+struct MappedPCM
+{
+    void * map = nullptr;
+    size_t map_size = 0;
+    const char * data = nullptr;
+    int64_t frames = 0;
+    int frame_size = 0;
+    int format = 0;
+
+    ~MappedPCM ()
+    {
+        if (map)
+            munmap (map, map_size);
+    }
+};
+
+static bool host_is_little_endian ()
+{
+    const uint16_t test = 1;
+    return * (const uint8_t *) & test;
+}
+
+static bool map_pcm (const char * filename, SNDFILE * sndfile,
+ const SF_INFO & sfinfo, VFSFile & file, MappedPCM & pcm)
+{
+    StringBuf path = uri_to_filename (filename);
+    if (! path)
+        return false;
+
+    int type = sfinfo.format & SF_FORMAT_TYPEMASK;
+    if (type != SF_FORMAT_WAV && type != SF_FORMAT_WAVEX &&
+     type != SF_FORMAT_RF64 && type != SF_FORMAT_AIFF)
+        return false;
+
+    bool swapped = sf_command (sndfile, SFC_RAW_DATA_NEEDS_ENDSWAP, nullptr, 0);
+    bool little = (host_is_little_endian () != swapped);
+    int sample_size;
+
+    switch (sfinfo.format & SF_FORMAT_SUBMASK)
+    {
+    case SF_FORMAT_PCM_16:
+        pcm.format = little ? FMT_S16_LE : FMT_S16_BE;
+        sample_size = 2;
+        break;
+    case SF_FORMAT_PCM_24:
+        pcm.format = little ? FMT_S24_3LE : FMT_S24_3BE;
+        sample_size = 3;
+        break;
+    case SF_FORMAT_PCM_32:
+        pcm.format = little ? FMT_S32_LE : FMT_S32_BE;
+        sample_size = 4;
+        break;
+    case SF_FORMAT_FLOAT:
+        if (swapped)
+            return false;
+        pcm.format = FMT_FLOAT;
+        sample_size = 4;
+        break;
+    default:
+        return false;
+    }
+
+    /* for raw PCM, seeking to the first frame puts the file position at the
+     * start of the data chunk */
+    if (sf_seek (sndfile, 0, SEEK_SET) != 0)
+        return false;
+
+    int64_t offset = file.ftell ();
+    int64_t size = file.fsize ();
+
+    pcm.frame_size = sample_size * sfinfo.channels;
+    pcm.frames = sfinfo.frames;
+
+    if (offset <= 0 || pcm.frames <= 0 || offset + pcm.frames * pcm.frame_size > size ||
+     (uint64_t) size > (size_t) -1)
+        return false;
+
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat (fd, & st) < 0 || st.st_size != size)
+    {
+        close (fd);
+        return false;
+    }
+
+    pcm.map_size = size;
+    pcm.map = mmap (nullptr, pcm.map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (pcm.map == MAP_FAILED)
+    {
+        pcm.map = nullptr;
+        return false;
+    }
+
+    madvise (pcm.map, pcm.map_size, MADV_SEQUENTIAL);
+    pcm.data = (const char *) pcm.map + offset;
+
+    AUDDBG ("Mapped %" PRId64 " frames of PCM data at offset %" PRId64 ".\n",
+     pcm.frames, offset);
+
+    return true;
+}
+
 bool SndfilePlugin::play (const char * filename, VFSFile & file)
 {
     SF_INFO sfinfo {}; // must be zeroed before sf_open()
@@ -311,6 +428,37 @@ bool SndfilePlugin::play (const char * filename, VFSFile & file)
     if (sndfile == nullptr)
         return false;
 
+    MappedPCM pcm;
+
+    if (! stream && map_pcm (filename, sndfile, sfinfo, file, pcm))
+    {
+        sf_close (sndfile);
+
+        open_audio (pcm.format, sfinfo.samplerate, sfinfo.channels);
+
+        /* slices of 1/10 second are passed to write_audio() */
+        int64_t slice = aud::max (sfinfo.samplerate / 10, 1);
+        int64_t pos = 0;
+
+        while (! check_stop ())
+        {
+            int seek_value = check_seek ();
+            if (seek_value != -1)
+                pos = aud::min ((int64_t) seek_value * sfinfo.samplerate / 1000, pcm.frames);
+
+            int64_t frames = aud::min (slice, pcm.frames - pos);
+            if (! frames)
+                break;
+
+            write_audio (pcm.data + pos * pcm.frame_size, frames * pcm.frame_size);
+            pos += frames;
+        }
+
+        return true;
+    }
+
+    sf_seek (sndfile, 0, SEEK_SET);
+
     open_audio (FMT_FLOAT, sfinfo.samplerate, sfinfo.channels);
 
     Index<float> buffer;
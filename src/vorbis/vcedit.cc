@@ -16,6 +16,13 @@
 
 #define CHUNKSIZE 4096
 
+/* bytes of padding reserved after the comments when the whole file is
+ * rewritten, so that later edits can usually be done in place */
+#define PADDING 1024
+
+/* number of lacing values needed for a packet */
+#define LACING_VALUES(bytes) ((bytes) / 255 + 1)
+
 VCEdit::VCEdit()
 {
     ogg_sync_init(&oy);
@@ -44,7 +51,7 @@ _v_writestring(oggpack_buffer *o, const char *s, int len)
 }
 
 static void
-_commentheader_out(vorbis_comment *vc, const char *vendor, ogg_packet *op)
+_commentheader_out(vorbis_comment *vc, const char *vendor, int padding, ogg_packet *op)
 {
     oggpack_buffer opb;
 
@@ -75,6 +82,10 @@ _commentheader_out(vorbis_comment *vc, const char *vendor, ogg_packet *op)
     }
     oggpack_write(&opb, 1, 1);
 
+    /* decoders ignore anything following the framing bit */
+    while (padding--)
+        oggpack_write(&opb, 0, 8);
+
     op->packet = (unsigned char *) _ogg_malloc(oggpack_bytes(&opb));
     memcpy(op->packet, opb.buffer, oggpack_bytes(&opb));
 
@@ -155,6 +166,10 @@ bool VCEdit::open(VFSFile &in)
         return false;
     }
 
+    headers_start = og.header_len + og.body_len;
+    headers_end = headers_start;
+    header_pages = 0;
+
     if (ogg_stream_packetout(&os, &header_main) != 1) {
         lasterror = "Error reading initial header packet.";
         return false;
@@ -165,6 +180,10 @@ bool VCEdit::open(VFSFile &in)
         return false;
     }
 
+    /* the identification header must be alone on the first page; a page
+     * holding one packet could also be the start of the comment header */
+    headers_ok = (ogg_page_packets(&og) == 1 && og.body_len == header_main.bytes);
+
     mainbuf.clear();
     mainbuf.insert(header_main.packet, 0, header_main.bytes);
 
@@ -175,8 +194,23 @@ bool VCEdit::open(VFSFile &in)
             int result = ogg_sync_pageout(&oy, &og);
             if (result == 0)
                 break;          /* Too little data so far */
+            else if (result < 0)
+                headers_ok = false;  /* skipped some bytes */
             else if (result == 1) {
-                ogg_stream_pagein(&os, &og);
+                /* pages of other streams (Skeleton, video) interleaved with
+                 * the headers must never be rewritten in place */
+                if (ogg_page_serialno(&og) != serial ||
+                    ogg_stream_pagein(&os, &og) < 0) {
+                    headers_ok = false;
+                    continue;
+                }
+
+                if (!header_pages)
+                    first_pageno = ogg_page_pageno(&og);
+
+                headers_end += og.header_len + og.body_len;
+                header_pages++;
+
                 while (i < 2) {
                     result = ogg_stream_packetout(&os, header);
                     if (result == 0)
@@ -193,6 +227,12 @@ bool VCEdit::open(VFSFile &in)
                     i++;
                     header = &header_codebooks;
                 }
+
+                /* the setup header must end its page, with no audio
+                 * data following it there */
+                if (i == 2 && (og.header[27 + og.header[26] - 1] == 255 ||
+                               ogg_stream_packetpeek(&os, nullptr) != 0))
+                    headers_ok = false;
             }
         }
 
@@ -242,7 +282,7 @@ bool VCEdit::write(VFSFile &in, VFSFile &out)
 
     ogg_stream_init(&streamout, serial);
 
-    _commentheader_out(&vc, vendor, &header_comments);
+    _commentheader_out(&vc, vendor, PADDING, &header_comments);
 
     ogg_stream_packetin(&streamout, &header_main);
     ogg_stream_packetin(&streamout, &header_comments);
@@ -352,3 +392,124 @@ bool VCEdit::write(VFSFile &in, VFSFile &out)
 
     return true;
 }
+
+static void write_le32(unsigned char *p, uint32_t val)
+{
+    for (int i = 0; i < 4; i++, val >>= 8)
+        p[i] = val & 0xff;
+}
+
+/* Rewrites only the comment and setup header pages, padding the comment
+ * packet so that the pages keep their exact size and number.  The audio
+ * pages, including their sequence numbers and checksums, are untouched.
+ * Returns false (without modifying the file) if the new comments do not fit
+ * in the space available. */
+bool VCEdit::write_in_place(VFSFile &file)
+{
+    if (!headers_ok || header_pages < 1)
+        return false;
+
+    ogg_packet header_comments;
+    _commentheader_out(&vc, vendor, 0, &header_comments);
+
+    int64_t needed = header_comments.bytes;
+    int64_t setup = bookbuf.len();
+    ogg_packet_clear(&header_comments);
+
+    /* total bytes available for the comment packet and its lacing values */
+    int64_t avail = (headers_end - headers_start) - 27 * header_pages -
+        setup - LACING_VALUES(setup);
+
+    /* some sizes cannot be hit exactly, since the number of lacing values
+     * steps up by one whenever the packet size crosses a multiple of 255 */
+    int64_t size = (avail - 1) * 255 / 256 - 1;
+    while (size + LACING_VALUES(size) < avail)
+        size++;
+
+    if (size < needed || size + LACING_VALUES(size) != avail)
+        return false;
+
+    int total_segs = LACING_VALUES(size) + LACING_VALUES(setup);
+    int segs_per_page = (total_segs + header_pages - 1) / header_pages;
+
+    if (segs_per_page > 255 || total_segs < header_pages)
+        return false;
+
+    _commentheader_out(&vc, vendor, size - needed, &header_comments);
+
+    /* lacing values and body for both packets */
+    Index<unsigned char> lacing, body;
+
+    for (int64_t left = size; ; left -= 255) {
+        lacing.append(left >= 255 ? 255 : left);
+        if (left < 255)
+            break;
+    }
+    for (int64_t left = setup; ; left -= 255) {
+        lacing.append(left >= 255 ? 255 : left);
+        if (left < 255)
+            break;
+    }
+
+    body.insert(header_comments.packet, 0, size);
+    body.insert(bookbuf.begin(), -1, setup);
+    ogg_packet_clear(&header_comments);
+
+    Index<unsigned char> pages;
+    int seg = 0;
+    int64_t body_pos = 0;
+    bool continued = false;
+
+    for (int page = 0; page < header_pages; page++) {
+        /* spread the remaining segments evenly over the remaining pages */
+        int segs = (total_segs - seg) / (header_pages - page);
+        int64_t body_len = 0;
+        bool packet_done = false;
+
+        unsigned char header[27 + 255];
+        memcpy(header, "OggS", 4);
+        header[4] = 0;
+        header[5] = continued ? 1 : 0;
+
+        for (int i = 0; i < segs; i++) {
+            header[27 + i] = lacing[seg + i];
+            body_len += lacing[seg + i];
+            if (lacing[seg + i] < 255)
+                packet_done = true;
+        }
+
+        /* header packets have granule position 0, or -1 if none ends here */
+        uint32_t granule = packet_done ? 0 : 0xffffffff;
+        write_le32(header + 6, granule);
+        write_le32(header + 10, granule);
+        write_le32(header + 14, serial);
+        write_le32(header + 18, first_pageno + page);
+        write_le32(header + 22, 0);
+        header[26] = segs;
+
+        ogg_page og;
+        og.header = header;
+        og.header_len = 27 + segs;
+        og.body = body.begin() + body_pos;
+        og.body_len = body_len;
+        ogg_page_checksum_set(&og);
+
+        pages.insert(og.header, -1, og.header_len);
+        pages.insert(og.body, -1, og.body_len);
+
+        continued = (lacing[seg + segs - 1] == 255);
+        seg += segs;
+        body_pos += body_len;
+    }
+
+    if (pages.len() != headers_end - headers_start)
+        return false;
+
+    if (file.fseek(headers_start, VFS_SEEK_SET) != 0 ||
+        file.fwrite(pages.begin(), 1, pages.len()) != pages.len()) {
+        lasterror = "Error writing header pages.";
+        return false;
+    }
+
+    return true;
+}
@@ -28,6 +28,7 @@ public:
 
     bool open(VFSFile &in);
     bool write(VFSFile &in, VFSFile &out);
+    bool write_in_place(VFSFile &file);
 
 private:
     ogg_sync_state   oy;
@@ -39,6 +40,13 @@ private:
     bool extrapage = false;
     bool eosin = false;
 
+    /* location of the comment and setup header pages, for write_in_place() */
+    bool headers_ok = false;
+    int64_t headers_start = 0;
+    int64_t headers_end = 0;
+    int header_pages = 0;
+    long first_pageno = 0;
+
     String vendor;
 
     Index<unsigned char> mainbuf;
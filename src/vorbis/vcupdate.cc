@@ -105,6 +105,16 @@ bool VorbisPlugin::write_tuple (const char * filename, VFSFile & file, const Tup
 
     dictionary_to_vorbis_comment (& edit.vc, dict);
 
+    if (edit.write_in_place (file))
+        return true;
+
+    /* a hard error here may have left the file partly written */
+    if (edit.lasterror)
+    {
+        AUDERR ("Tag update failed: %s.\n", edit.lasterror);
+        return false;
+    }
+
     auto temp_vfs = VFSFile::tmpfile ();
     if (! temp_vfs)
         return false;
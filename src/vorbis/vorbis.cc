@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <inttypes.h>
+#include <pthread.h>
 
 #include <ogg/ogg.h>
 #include <vorbis/codec.h>
@@ -38,6 +40,7 @@
 #define WANT_AUD_BSWAP
 #define WANT_VFS_STDIO_COMPAT
 #include <libaudcore/audstrings.h>
+#include <libaudcore/multihash.h>
 #include <libaudcore/runtime.h>
 
 #include "vorbis.h"
@@ -196,20 +199,39 @@ static bool update_replay_gain (OggVorbis_File * vf, ReplayGainInfo * rg_info)
     return true;
 }
 
-static long
+/* mono and stereo get their own loops, which the compiler can vectorize */
+static void
 vorbis_interleave_buffer(float **pcm, int samples, int ch, float *pcmout)
 {
-    int i, j;
-    for (i = 0; i < samples; i++)
-        for (j = 0; j < ch; j++)
-            *pcmout++ = pcm[j][i];
+    if (ch == 1)
+        memcpy (pcmout, pcm[0], sizeof (float) * samples);
+    else if (ch == 2)
+    {
+        const float * left = pcm[0], * right = pcm[1];
+
+        for (int i = 0; i < samples; i ++)
+        {
+            pcmout[2 * i] = left[i];
+            pcmout[2 * i + 1] = right[i];
+        }
+    }
+    else
+    {
+        for (int j = 0; j < ch; j ++)
+        {
+            const float * in = pcm[j];
+            float * out = pcmout + j;
 
-    return ch * samples * sizeof(float);
+            for (int i = 0; i < samples; i ++, out += ch)
+                * out = in[i];
+        }
+    }
 }
 
 
-#define PCM_FRAMES 1024
-#define PCM_BUFSIZE (PCM_FRAMES * 2)
+/* several Vorbis blocks are collected before each call to write_audio */
+#define PCM_FRAMES 4096
+#define PCM_BUFSIZE (PCM_FRAMES * AUD_MAX_CHANNELS)
 
 bool VorbisPlugin::play (const char * filename, VFSFile & file)
 {
@@ -218,8 +240,9 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
     int last_section = -1;
     Tuple tuple = get_playback_tuple ();
     ReplayGainInfo rg_info;
-    float pcmout[PCM_BUFSIZE*sizeof(float)], **pcm;
-    int bytes, channels, samplerate, br;
+    Index<float> pcmout;
+    float **pcm;
+    int frames, buffered = 0, channels, samplerate, br;
 
     memset(&vf, 0, sizeof(vf));
 
@@ -239,6 +262,15 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
     channels = vi->channels;
     samplerate = vi->rate;
 
+    if (channels < 1 || channels > AUD_MAX_CHANNELS)
+    {
+        AUDERR ("Unsupported number of channels: %d\n", channels);
+        error = true;
+        goto play_cleanup;
+    }
+
+    pcmout.resize (PCM_BUFSIZE);
+
     set_stream_bitrate (br);
 
     if (update_tuple (& vf, tuple))
@@ -260,23 +292,26 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
     {
         int seek_value = check_seek ();
 
-        if (seek_value >= 0 && ov_time_seek (& vf, (double) seek_value / 1000) < 0)
+        if (seek_value >= 0)
         {
-            AUDERR ("seek failed\n");
-            error = true;
-            break;
+            if (ov_time_seek (& vf, (double) seek_value / 1000) < 0)
+            {
+                AUDERR ("seek failed\n");
+                error = true;
+                break;
+            }
+
+            buffered = 0;
         }
 
         int current_section = last_section;
-        bytes = ov_read_float(&vf, &pcm, PCM_FRAMES, &current_section);
-        if (bytes == OV_HOLE)
+        frames = ov_read_float(&vf, &pcm, PCM_FRAMES - buffered, &current_section);
+        if (frames == OV_HOLE)
             continue;
 
-        if (bytes <= 0)
+        if (frames <= 0)
             break;
 
-        bytes = vorbis_interleave_buffer (pcm, bytes, channels, pcmout);
-
         if (update_tuple (& vf, tuple))
             set_playback_tuple (tuple.ref ());
 
@@ -289,8 +324,22 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
              */
             vi = ov_info(&vf, -1);
 
+            if (vi->channels < 1 || vi->channels > AUD_MAX_CHANNELS)
+            {
+                AUDERR ("Unsupported number of channels: %d\n", vi->channels);
+                error = true;
+                break;
+            }
+
             if (vi->rate != samplerate || vi->channels != channels)
             {
+                /* audio collected so far belongs to the previous format */
+                if (buffered)
+                {
+                    write_audio (pcmout.begin (), sizeof (float) * buffered * channels);
+                    buffered = 0;
+                }
+
                 samplerate = vi->rate;
                 channels = vi->channels;
 
@@ -301,7 +350,14 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
             }
         }
 
-        write_audio (pcmout, bytes);
+        vorbis_interleave_buffer (pcm, frames, channels, pcmout.begin () + buffered * channels);
+        buffered += frames;
+
+        if (buffered == PCM_FRAMES)
+        {
+            write_audio (pcmout.begin (), sizeof (float) * buffered * channels);
+            buffered = 0;
+        }
 
         if (current_section != last_section)
         {
@@ -310,12 +366,186 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
         }
     } /* main loop */
 
+    if (buffered && ! error && ! check_stop ())
+        write_audio (pcmout.begin (), sizeof (float) * buffered * channels);
+
 play_cleanup:
 
     ov_clear(&vf);
     return ! error;
 }
 
+/* the largest possible Ogg page is 65307 bytes */
+#define TAIL_SIZE 65536
+
+/*
+ * Finds the granule position of the last page in the file, using a single
+ * read of the file tail.  This avoids the bisection that ov_open() does to
+ * find the end of each chained stream.  Returns -1 if the last page does not
+ * belong to the given logical stream (i.e. the file is chained).
+ */
+static int64_t read_last_granule (VFSFile & file, long serial)
+{
+    int64_t size = file.fsize ();
+    int64_t tail = aud::min (size, (int64_t) TAIL_SIZE);
+
+    if (tail <= 0 || file.fseek (size - tail, VFS_SEEK_SET) != 0)
+        return -1;
+
+    ogg_sync_state oy;
+    ogg_sync_init (& oy);
+
+    char * buffer = ogg_sync_buffer (& oy, tail);
+    int64_t bytes = file.fread (buffer, 1, tail);
+
+    if (bytes > 0)
+        ogg_sync_wrote (& oy, bytes);
+
+    ogg_page og;
+    int64_t granule = -1;
+    bool ours = false;
+
+    while (1)
+    {
+        long result = ogg_sync_pageseek (& oy, & og);
+
+        if (result == 0)
+            break;
+        if (result < 0)  /* skipped some bytes */
+            continue;
+
+        if (ogg_page_granulepos (& og) >= 0)
+        {
+            granule = ogg_page_granulepos (& og);
+            ours = (ogg_page_serialno (& og) == serial);
+        }
+    }
+
+    ogg_sync_clear (& oy);
+
+    return ours ? granule : -1;
+}
+
+/*
+ * Finds the PCM offset at which the stream starts, as ov_open() does: the
+ * granule position of the first audio page, less the samples completed on
+ * that page.  Streams cut from a live source or from a chained file may
+ * start well above zero.
+ */
+static int64_t read_first_granule (VFSFile & file, vorbis_info * info, long serial)
+{
+    if (file.fseek (0, VFS_SEEK_SET) != 0)
+        return -1;
+
+    ogg_sync_state oy;
+    ogg_stream_state os;
+    ogg_sync_init (& oy);
+    ogg_stream_init (& os, serial);
+
+    ogg_page og;
+    ogg_packet op;
+    int64_t granule = -1;
+    int64_t accumulated = 0;
+    long last_block = -1;
+
+    while (granule < 0)
+    {
+        int result = ogg_sync_pageout (& oy, & og);
+
+        if (result == 0)
+        {
+            char * buffer = ogg_sync_buffer (& oy, 4096);
+            int64_t bytes = file.fread (buffer, 1, 4096);
+
+            if (bytes <= 0)
+                break;
+
+            ogg_sync_wrote (& oy, bytes);
+            continue;
+        }
+
+        if (result < 0 || ogg_page_serialno (& og) != serial ||
+         ogg_stream_pagein (& os, & og) < 0)
+            continue;
+
+        /* header packets are not audio and are skipped here */
+        while (ogg_stream_packetout (& os, & op) > 0)
+        {
+            long block = vorbis_packet_blocksize (info, & op);
+
+            if (block < 0)
+                continue;
+
+            if (last_block >= 0)
+                accumulated += (last_block + block) >> 2;
+
+            last_block = block;
+        }
+
+        if (ogg_page_granulepos (& og) >= 0)
+            granule = aud::max (ogg_page_granulepos (& og) - accumulated, (int64_t) 0);
+    }
+
+    ogg_stream_clear (& os);
+    ogg_sync_clear (& oy);
+
+    return granule;
+}
+
+#define LENGTH_CACHE_SIZE 256    /* files */
+
+/* lengths of network files, which are expensive to seek */
+static pthread_mutex_t length_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SimpleHash<String, int> length_cache;
+
+static String length_cache_key (const char * filename, int64_t size)
+{
+    return String (str_printf ("%s:%" PRId64, filename, size));
+}
+
+static int read_length (const char * filename, VFSFile & file, OggVorbis_File * vf)
+{
+    bool local = ! strncmp (filename, "file://", 7);
+    String key;
+
+    if (! local)
+    {
+        key = length_cache_key (filename, file.fsize ());
+
+        pthread_mutex_lock (& length_mutex);
+        int * cached = length_cache.lookup (key);
+        int length = cached ? * cached : -1;
+        pthread_mutex_unlock (& length_mutex);
+
+        if (length >= 0)
+            return length;
+    }
+
+    vorbis_info * info = ov_info (vf, -1);
+    long serial = ov_serialnumber (vf, -1);
+
+    int64_t granule = read_last_granule (file, serial);
+    int64_t start = (granule >= 0) ? read_first_granule (file, info, serial) : -1;
+
+    if (granule < 0 || start < 0 || start > granule || info->rate <= 0)
+        return -1;
+
+    int length = (granule - start) * 1000 / info->rate;
+
+    if (! local)
+    {
+        pthread_mutex_lock (& length_mutex);
+
+        if (length_cache.n_items () >= LENGTH_CACHE_SIZE)
+            length_cache.clear ();
+
+        length_cache.add (key, std::move (length));
+        pthread_mutex_unlock (& length_mutex);
+    }
+
+    return length;
+}
+
 bool VorbisPlugin::read_tag (const char * filename, VFSFile & file,
  Tuple & tuple, Index<char> * image)
 {
@@ -324,11 +554,11 @@ bool VorbisPlugin::read_tag (const char * filename, VFSFile & file,
     bool stream = (file.fsize () < 0);
 
     /*
-     * The open function performs full stream detection and
-     * machine initialization.  If it returns zero, the stream
-     * *is* Vorbis and we're fully ready to decode.
+     * Only the headers of the first stream are read here.  The length is
+     * taken from the last page of the file, unless the file is chained, in
+     * which case we fall back to a full open below.
      */
-    if (ov_open_callbacks (& file, & vfile, nullptr, 0, stream ?
+    if (ov_test_callbacks (& file, & vfile, nullptr, 0, stream ?
      vorbis_callbacks_stream : vorbis_callbacks) < 0)
         return false;
 
@@ -338,7 +568,24 @@ bool VorbisPlugin::read_tag (const char * filename, VFSFile & file,
     tuple.set_format ("Ogg Vorbis", info->channels, info->rate, info->bitrate_nominal / 1000);
 
     if (! stream)
-        tuple.set_int (Tuple::Length, ov_time_total (& vfile, -1) * 1000);
+    {
+        int length = read_length (filename, file, & vfile);
+
+        if (length < 0)
+        {
+            OggVorbis_File full;
+
+            if (file.fseek (0, VFS_SEEK_SET) == 0 &&
+             ov_open_callbacks (& file, & full, nullptr, 0, vorbis_callbacks) == 0)
+            {
+                length = ov_time_total (& full, -1) * 1000;
+                ov_clear (& full);
+            }
+        }
+
+        if (length >= 0)
+            tuple.set_int (Tuple::Length, length);
+    }
 
     if (comment)
         read_comment (comment, tuple);
@@ -10,7 +10,7 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/audstrings.h>
 
-#define BUFFER_SIZE 256 /* read buffer size, in samples / frames */
+#define BUFFER_MS 20 /* read buffer size, in milliseconds */
 #define SAMPLE_SIZE(a) (a == 8 ? sizeof(uint8_t) : (a == 16 ? sizeof(uint16_t) : sizeof(uint32_t)))
 #define SAMPLE_FMT(a) (a == 8 ? FMT_S8 : (a == 16 ? FMT_S16_NE : (a == 24 ? FMT_S24_NE : FMT_S32_NE)))
 
@@ -120,6 +120,14 @@ static void wv_deattach (WavpackContext * ctx)
     WavpackCloseFile(ctx);
 }
 
+/* simple loops which the compiler is able to vectorize */
+template<class T>
+static void wv_narrow (const int32_t * in, T * out, int count)
+{
+    for (int i = 0; i < count; i ++)
+        out[i] = in[i];
+}
+
 bool WavpackPlugin::play (const char * filename, VFSFile & file)
 {
     int sample_rate, num_channels, bits_per_sample;
@@ -127,7 +135,7 @@ bool WavpackPlugin::play (const char * filename, VFSFile & file)
     WavpackContext *ctx = nullptr;
     VFSFile wvc_input;
 
-    if (! wv_attach (filename, file, wvc_input, & ctx, nullptr, OPEN_TAGS | OPEN_WVC))
+    if (! wv_attach (filename, file, wvc_input, & ctx, nullptr, OPEN_TAGS | OPEN_WVC | OPEN_NORMALIZE))
     {
         AUDERR ("Error opening Wavpack file '%s'.", filename);
         return false;
@@ -138,14 +146,21 @@ bool WavpackPlugin::play (const char * filename, VFSFile & file)
     bits_per_sample = WavpackGetBitsPerSample(ctx);
     num_samples = WavpackGetNumSamples(ctx);
 
+    /* float files are unpacked as 32-bit floats, normalized to +/- 1.0 */
+    bool is_float = (WavpackGetMode (ctx) & MODE_FLOAT);
+    int buffer_size = aud::max (sample_rate * BUFFER_MS / 1000, 256);
+
     set_stream_bitrate(WavpackGetAverageBitrate(ctx, num_channels));
-    open_audio(SAMPLE_FMT(bits_per_sample), sample_rate, num_channels);
+    open_audio(is_float ? FMT_FLOAT : SAMPLE_FMT(bits_per_sample), sample_rate, num_channels);
 
     Index<int32_t> input;
-    input.resize (BUFFER_SIZE * num_channels);
+    input.resize (buffer_size * num_channels);
 
+    /* 24- and 32-bit and float samples are output straight from the input
+     * buffer; only 8- and 16-bit samples need to be narrowed */
     Index<char> output;
-    output.resize (BUFFER_SIZE * num_channels * SAMPLE_SIZE (bits_per_sample));
+    if (! is_float && (bits_per_sample == 8 || bits_per_sample == 16))
+        output.resize (buffer_size * num_channels * SAMPLE_SIZE (bits_per_sample));
 
     while (! check_stop ())
     {
@@ -159,39 +174,32 @@ bool WavpackPlugin::play (const char * filename, VFSFile & file)
         if (samples_left == 0)
             break;
 
-        int ret = WavpackUnpackSamples (ctx, input.begin (), BUFFER_SIZE);
+        int ret = WavpackUnpackSamples (ctx, input.begin (),
+         aud::min (samples_left, (unsigned) buffer_size));
 
         if (ret < 0)
         {
             AUDERR ("Error decoding file.\n");
             break;
         }
+
+        if (ret == 0)
+            break;
+
+        int count = ret * num_channels;
+
+        /* Perform audio data conversion and output */
+        if (is_float || (bits_per_sample != 8 && bits_per_sample != 16))
+            write_audio (input.begin (), count * sizeof (int32_t));
+        else if (bits_per_sample == 8)
+        {
+            wv_narrow (input.begin (), (int8_t *) output.begin (), count);
+            write_audio (output.begin (), count);
+        }
         else
         {
-            /* Perform audio data conversion and output */
-            int32_t * rp = input.begin ();
-            int8_t * wp = (int8_t *) output.begin ();
-            int16_t * wp2 = (int16_t *) output.begin ();
-            int32_t * wp4 = (int32_t *) output.begin ();
-
-            if (bits_per_sample == 8)
-            {
-                for (int i = 0; i < ret * num_channels; i++, wp++, rp++)
-                    *wp = *rp & 0xff;
-            }
-            else if (bits_per_sample == 16)
-            {
-                for (int i = 0; i < ret * num_channels; i++, wp2++, rp++)
-                    *wp2 = *rp & 0xffff;
-            }
-            else if (bits_per_sample == 24 || bits_per_sample == 32)
-            {
-                for (int i = 0; i < ret * num_channels; i++, wp4++, rp++)
-                    *wp4 = *rp;
-            }
-
-            write_audio (output.begin (),
-             ret * num_channels * SAMPLE_SIZE (bits_per_sample));
+            wv_narrow (input.begin (), (int16_t *) output.begin (), count);
+            write_audio (output.begin (), count * sizeof (int16_t));
         }
     }
 
@@ -0,0 +1,383 @@
+/*
+ * xsf-bench.cc
+ * Benchmark of the 2SF engine: renders synthetic 2SFs with xsf_gen() and
+ * reports emulated ARM7 cycles per host second, with a hash of the output
+ * so that builds can be checked to render the same audio.
+ *
+ * Build the reference interpreter (every instruction fetched through the
+ * MMU and looked up again) with -DARMCPU_NO_DECODE_CACHE to compare; "make
+ * compare" in this directory builds and runs both.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include "../ao.h"
+#include "../vio2sf.h"
+
+/* the synthetic 2SFs use no libraries */
+Index<char> xsf_get_lib(char *)
+{
+	return Index<char>();
+}
+
+/*
+ * The ARM7 drivers, assembled for ARMv4T.  All of them start by setting up
+ * four sound channels from the sample data placed 4 KB after the code
+ * (DATA):
+ *
+ *	ldr r0, =0x04000400      @ SOUND0CNT
+ *	ldr r1, =0x807f          @ SOUNDCNT: enable, full volume
+ *	ldr r2, =0x04000500
+ *	strh r1, [r2]
+ *	ldr r1, =DATA + 0x000    @ ch 0: looped PCM16
+ *	str r1, [r0, #4]
+ *	ldr r1, =0xfc00
+ *	strh r1, [r0, #8]
+ *	mov r1, #0x100
+ *	strh r1, [r0, #0xa]
+ *	mov r1, #0x300
+ *	str r1, [r0, #0xc]
+ *	ldr r1, =0xa840007f
+ *	str r1, [r0]
+ *	add r3, r0, #0x10        @ ch 1: looped IMA-ADPCM
+ *	ldr r1, =DATA + 0x1000
+ *	str r1, [r3, #4]
+ *	ldr r1, =0xfe00
+ *	strh r1, [r3, #8]
+ *	mov r1, #0x40
+ *	strh r1, [r3, #0xa]
+ *	mov r1, #0x1c0
+ *	str r1, [r3, #0xc]
+ *	ldr r1, =0xc8200060
+ *	str r1, [r3]
+ *	add r3, r0, #0x80        @ ch 8: PSG square
+ *	ldr r1, =0xf000
+ *	strh r1, [r3, #8]
+ *	ldr r1, =0xe3600040
+ *	str r1, [r3]
+ *	add r3, r0, #0xe0        @ ch 14: noise
+ *	ldr r1, =0xf800
+ *	strh r1, [r3, #8]
+ *	ldr r1, =0xe0400020
+ *	str r1, [r3]
+ *	ldr r4, =0xace1          @ LFSR seed
+ */
+
+/* runs from main RAM at 0x02380000 (DATA = 0x02381000):
+ *
+ * loop:
+ *	ldr r5, =0x8000          @ busy wait, then update ch 0 and restart ch 2
+ * 1:	subs r5, r5, #1
+ *	bne 1b
+ *	mov r6, r4, lsr #1
+ *	tst r4, #1
+ *	eorne r6, r6, #0xb400
+ *	mov r4, r6
+ *	mov r1, r4, lsl #20
+ *	mov r1, r1, lsr #20
+ *	orr r1, r1, #0xf000
+ *	strh r1, [r0, #8]
+ *	add r3, r0, #0x20        @ ch 2: one-shot PCM8
+ *	ldr r1, =DATA + 0x2000
+ *	str r1, [r3, #4]
+ *	ldr r1, =0xfd00
+ *	strh r1, [r3, #8]
+ *	mov r1, #0
+ *	strh r1, [r3, #0xa]
+ *	mov r1, #0xc0
+ *	str r1, [r3, #0xc]
+ *	mov r1, #0
+ *	str r1, [r3]
+ *	ldr r1, =0x90400070
+ *	str r1, [r3]
+ *	b loop
+ */
+static const uint32_t arm7_busy[] = {
+	0xe59f00ec, 0xe59f10ec, 0xe59f20ec, 0xe1c210b0, 0xe59f10e8, 0xe5801004,
+	0xe3a01b3f, 0xe1c010b8, 0xe3a01c01, 0xe1c010ba, 0xe3a01c03, 0xe580100c,
+	0xe59f10cc, 0xe5801000, 0xe2803010, 0xe59f10c4, 0xe5831004, 0xe3a01cfe,
+	0xe1c310b8, 0xe3a01040, 0xe1c310ba, 0xe3a01d07, 0xe583100c, 0xe59f10a8,
+	0xe5831000, 0xe2803080, 0xe3a01a0f, 0xe1c310b8, 0xe59f1098, 0xe5831000,
+	0xe28030e0, 0xe3a01b3e, 0xe1c310b8, 0xe59f1088, 0xe5831000, 0xe59f4084,
+	0xe3a05902, 0xe2555001, 0x1afffffd, 0xe1a060a4, 0xe3140001, 0x12266b2d,
+	0xe1a04006, 0xe1a01a04, 0xe1a01a21, 0xe3811a0f, 0xe1c010b8, 0xe2803020,
+	0xe59f1054, 0xe5831004, 0xe3a01cfd, 0xe1c310b8, 0xe3a01000, 0xe1c310ba,
+	0xe3a010c0, 0xe583100c, 0xe3a01000, 0xe5831000, 0xe59f1030, 0xe5831000,
+	0xeaffffe6, 0x04000400, 0x0000807f, 0x04000500, 0x02381000, 0xa840007f,
+	0x02382000, 0xc8200060, 0xe3600040, 0xe0400020, 0x0000ace1, 0x02383000,
+	0x90400070
+};
+
+/* runs from main RAM at 0x02380000 (DATA = 0x02381000) and halts:
+ *
+ * loop:
+ *	swi 0x060000             @ Halt
+ *	b loop
+ */
+static const uint32_t arm7_idle[] = {
+	0xe59f0090, 0xe59f1090, 0xe59f2090, 0xe1c210b0, 0xe59f108c, 0xe5801004,
+	0xe3a01b3f, 0xe1c010b8, 0xe3a01c01, 0xe1c010ba, 0xe3a01c03, 0xe580100c,
+	0xe59f1070, 0xe5801000, 0xe2803010, 0xe59f1068, 0xe5831004, 0xe3a01cfe,
+	0xe1c310b8, 0xe3a01040, 0xe1c310ba, 0xe3a01d07, 0xe583100c, 0xe59f104c,
+	0xe5831000, 0xe2803080, 0xe3a01a0f, 0xe1c310b8, 0xe59f103c, 0xe5831000,
+	0xe28030e0, 0xe3a01b3e, 0xe1c310b8, 0xe59f102c, 0xe5831000, 0xe59f4028,
+	0xef060000, 0xeafffffd, 0x04000400, 0x0000807f, 0x04000500, 0x02381000,
+	0xa840007f, 0x02382000, 0xc8200060, 0xe3600040, 0xe0400020, 0x0000ace1
+};
+
+/* runs from ARM7 work RAM at 0x03800000 (DATA = 0x03801000), calls a Thumb
+ * delay loop and patches one of its own instructions on every pass:
+ *
+ *	adr r7, counter
+ * loop:
+ *	ldr r5, =0x2000
+ *	adr r6, delay + 1
+ *	mov lr, pc
+ *	bx r6
+ *	ldr r1, [r7]             @ patch the immediate of the mov at smc
+ *	add r1, r1, #1
+ *	str r1, [r7]
+ *	and r2, r1, #0xff
+ *	ldr r3, =0xe3a01000      @ mov r1, #0
+ *	orr r3, r3, r2
+ *	adr r2, smc
+ *	str r3, [r2]
+ * smc:	mov r1, #0
+ *	mov r1, r1, lsl #4
+ *	orr r1, r1, #0xf000
+ *	strh r1, [r0, #8]
+ *	add r3, r0, #0x80
+ *	mov r1, r4, lsl #20
+ *	mov r1, r1, lsr #20
+ *	orr r1, r1, #0xf000
+ *	strh r1, [r3, #8]
+ *	mov r6, r4, lsr #1
+ *	tst r4, #1
+ *	eorne r6, r6, #0xb400
+ *	mov r4, r6
+ *	b loop
+ * counter:
+ *	.word 0
+ *	.thumb
+ * delay:
+ *	movs r2, #3
+ * 1:	subs r5, r5, #1
+ *	adds r2, r2, r5
+ *	lsrs r2, r2, #1
+ *	cmp r5, #0
+ *	bne 1b
+ *	bx lr
+ */
+static const uint32_t arm7_wram[] = {
+	0xe59f00f4, 0xe59f10f4, 0xe59f20f4, 0xe1c210b0, 0xe59f10f0, 0xe5801004,
+	0xe3a01b3f, 0xe1c010b8, 0xe3a01c01, 0xe1c010ba, 0xe3a01c03, 0xe580100c,
+	0xe59f10d4, 0xe5801000, 0xe2803010, 0xe59f10cc, 0xe5831004, 0xe3a01cfe,
+	0xe1c310b8, 0xe3a01040, 0xe1c310ba, 0xe3a01d07, 0xe583100c, 0xe59f10b0,
+	0xe5831000, 0xe2803080, 0xe3a01a0f, 0xe1c310b8, 0xe59f10a0, 0xe5831000,
+	0xe28030e0, 0xe3a01b3e, 0xe1c310b8, 0xe59f1090, 0xe5831000, 0xe59f408c,
+	0xe28f7090, 0xe3a05a02, 0xe28f608d, 0xe1a0e00f, 0xe12fff16, 0xe5971000,
+	0xe2811001, 0xe5871000, 0xe20120ff, 0xe59f3068, 0xe1833002, 0xe28f2000,
+	0xe5823000, 0xe3a01000, 0xe1a01201, 0xe3811a0f, 0xe1c010b8, 0xe2803080,
+	0xe1a01a04, 0xe1a01a21, 0xe3811a0f, 0xe1c310b8, 0xe1a060a4, 0xe3140001,
+	0x12266b2d, 0xe1a04006, 0xeaffffe5, 0x04000400, 0x0000807f, 0x04000500,
+	0x03801000, 0xa840007f, 0x03802000, 0xc8200060, 0xe3600040, 0xe0400020,
+	0x0000ace1, 0xe3a01000, 0x00000000, 0x1e6d2203, 0x08521952, 0xd1fa2d00,
+	0x46c04770
+};
+
+/* the same, but it patches itself through the mirror 64 KB higher:
+ *
+ *	adr r2, smc
+ *	add r2, r2, #0x10000
+ *	str r3, [r2]
+ */
+static const uint32_t arm7_mirror[] = {
+	0xe59f00f8, 0xe59f10f8, 0xe59f20f8, 0xe1c210b0, 0xe59f10f4, 0xe5801004,
+	0xe3a01b3f, 0xe1c010b8, 0xe3a01c01, 0xe1c010ba, 0xe3a01c03, 0xe580100c,
+	0xe59f10d8, 0xe5801000, 0xe2803010, 0xe59f10d0, 0xe5831004, 0xe3a01cfe,
+	0xe1c310b8, 0xe3a01040, 0xe1c310ba, 0xe3a01d07, 0xe583100c, 0xe59f10b4,
+	0xe5831000, 0xe2803080, 0xe3a01a0f, 0xe1c310b8, 0xe59f10a4, 0xe5831000,
+	0xe28030e0, 0xe3a01b3e, 0xe1c310b8, 0xe59f1094, 0xe5831000, 0xe59f4090,
+	0xe28f7094, 0xe3a05a02, 0xe28f6091, 0xe1a0e00f, 0xe12fff16, 0xe5971000,
+	0xe2811001, 0xe5871000, 0xe20120ff, 0xe59f306c, 0xe1833002, 0xe28f2004,
+	0xe2822801, 0xe5823000, 0xe3a01000, 0xe1a01201, 0xe3811a0f, 0xe1c010b8,
+	0xe2803080, 0xe1a01a04, 0xe1a01a21, 0xe3811a0f, 0xe1c310b8, 0xe1a060a4,
+	0xe3140001, 0x12266b2d, 0xe1a04006, 0xeaffffe4, 0x04000400, 0x0000807f,
+	0x04000500, 0x03801000, 0xa840007f, 0x03802000, 0xc8200060, 0xe3600040,
+	0xe0400020, 0x0000ace1, 0xe3a01000, 0x00000000, 0x1e6d2203, 0x08521952,
+	0xd1fa2d00, 0x46c04770
+};
+
+/* the ARM9 either spins (b .) or halts:
+ *
+ *	mov r0, #0
+ *	mcr p15, 0, r0, c7, c0, 4   @ wait for interrupt
+ *	b .
+ */
+static const uint32_t arm9_spin[] = {0xeafffffe};
+static const uint32_t arm9_halt[] = {0xe3a00000, 0xee070f90, 0xeafffffe};
+
+#define ARM9_ROM	0x200
+#define ARM7_ROM	0x1000
+#define ARM7_SIZE	0x4000
+#define ROM_SIZE	0x8000
+
+struct Tune
+{
+	const char *name;
+	const uint32_t *arm9;
+	int arm9_words;
+	const uint32_t *arm7;
+	int arm7_words;
+	uint32_t arm7_addr;
+};
+
+#define CODE(a) a, (int)(sizeof a / sizeof a[0])
+
+static const Tune tunes[] = {
+	{"busy", CODE(arm9_spin), CODE(arm7_busy), 0x02380000},
+	{"halt", CODE(arm9_halt), CODE(arm7_busy), 0x02380000},
+	{"idle", CODE(arm9_halt), CODE(arm7_idle), 0x02380000},
+	{"wram", CODE(arm9_spin), CODE(arm7_wram), 0x03800000},
+	{"mirror", CODE(arm9_spin), CODE(arm7_mirror), 0x03800000}
+};
+
+static void put32(unsigned char *p, uint32_t val)
+{
+	for (int b = 0; b < 4; b++)
+		p[b] = val >> (8 * b);
+}
+
+/* builds a ROM with the two programs and the ARM7 sample data, and wraps it
+ * in a 2SF */
+static Index<char> make_2sf(const Tune &t)
+{
+	Index<unsigned char> prog;
+	prog.insert(0, 8 + ROM_SIZE);
+
+	put32(&prog[0], 0);		/* ROM offset */
+	put32(&prog[4], ROM_SIZE);
+
+	unsigned char *rom = &prog[8];
+
+	for (int i = 0; i < t.arm9_words; i++)
+		put32(rom + ARM9_ROM + 4 * i, t.arm9[i]);
+	for (int i = 0; i < t.arm7_words; i++)
+		put32(rom + ARM7_ROM + 4 * i, t.arm7[i]);
+
+	/* ARM9 and ARM7 sections: ROM offset, entry, load address, size */
+	put32(rom + 0x20, ARM9_ROM);
+	put32(rom + 0x24, 0x02000000);
+	put32(rom + 0x28, 0x02000000);
+	put32(rom + 0x2c, 4 * t.arm9_words);
+	put32(rom + 0x30, ARM7_ROM);
+	put32(rom + 0x34, t.arm7_addr);
+	put32(rom + 0x38, t.arm7_addr);
+	put32(rom + 0x3c, ARM7_SIZE);
+
+	/* sample data: PCM16 and PCM8 sines, and IMA-ADPCM noise */
+	unsigned char *data = rom + ARM7_ROM + 0x1000;
+	for (int i = 0; i < 0x600; i++)
+	{
+		int16_t s = 12000 * sin(i * 2 * M_PI / 96) + 3000 * sin(i * 0.37);
+		data[2 * i] = s;
+		data[2 * i + 1] = s >> 8;
+	}
+
+	uint32_t seed = 1;
+	data[0x1002] = 20;	/* initial step index */
+	for (int i = 4; i < 0x700; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[0x1000 + i] = seed >> 16;
+	}
+
+	for (int i = 0; i < 0x300; i++)
+		data[0x2000 + i] = (int)(100 * sin(i / 5.0));
+
+	uLongf packed_len = compressBound(prog.len());
+	Index<char> xsf;
+	xsf.insert(0, 16 + packed_len);
+
+	compress((Bytef *)xsf.begin() + 16, &packed_len, prog.begin(), prog.len());
+	xsf.remove(16 + packed_len, -1);
+
+	memcpy(xsf.begin(), "PSF\x24", 4);
+	put32((unsigned char *)&xsf[4], 0);
+	put32((unsigned char *)&xsf[8], packed_len);
+	put32((unsigned char *)&xsf[12], crc32(0, (Bytef *)xsf.begin() + 16, packed_len));
+
+	return xsf;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define ARM7_CLOCK	33513982	/* Hz */
+#define FRAME		735		/* samples, 1/60 s */
+
+int main(int argc, char **argv)
+{
+	int seconds = (argc > 1) ? atoi(argv[1]) : 20;
+	int frames = seconds * 60;
+
+#ifdef ARMCPU_NO_DECODE_CACHE
+	printf("interpreter: fetch through the MMU\n");
+#else
+	printf("interpreter: decoded instruction cache\n");
+#endif
+
+	for (const Tune &t : tunes)
+	{
+		Index<char> xsf = make_2sf(t);
+		if (xsf_start(xsf.begin(), xsf.len()) != AO_SUCCESS)
+		{
+			fprintf(stderr, "%s: xsf_start failed\n", t.name);
+			return 1;
+		}
+
+		int16_t samples[2 * FRAME];
+		uint32_t hash = crc32(0, nullptr, 0);
+
+		double start = now();
+		for (int i = 0; i < frames; i++)
+		{
+			xsf_gen(samples, FRAME);
+			hash = crc32(hash, (Bytef *)samples, sizeof samples);
+		}
+		double time = now() - start;
+
+		xsf_term();
+
+		printf("%-8s %7.1f M ARM7 cycles/s  %6.1fx real time  output %08x\n",
+		 t.name, seconds * (ARM7_CLOCK / 1e6) / time, seconds / time,
+		 (unsigned)hash);
+	}
+
+	return 0;
+}
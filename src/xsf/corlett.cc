@@ -107,6 +107,9 @@ int corlett_decode(uint8_t *input, uint32_t input_len, uint8_t **output, uint64_
 	comp_length = LE32(buf[2]);
 	comp_crc = LE32(buf[3]);
 
+	decomp_dat = nullptr;
+	decomp_length = 0;
+
 	if (comp_length > 0)
 	{
 		// Check length
@@ -117,8 +120,11 @@ int corlett_decode(uint8_t *input, uint32_t input_len, uint8_t **output, uint64_
 		actual_crc = crc32(0, (unsigned char *)&buf[4+(res_area/4)], comp_length);
 		if (actual_crc != comp_crc)
 			return AO_FAIL;
+	}
 
-		// Decompress data if any
+	// Decompress data if any (not if the caller wants just the tags)
+	if (comp_length > 0 && output != nullptr && size != nullptr)
+	{
 		decomp_dat = (uint8_t *) malloc(DECOMP_MAX_SIZE);
 		decomp_length = DECOMP_MAX_SIZE;
 		if (uncompress(decomp_dat, &decomp_length, (unsigned char *)&buf[4+(res_area/4)], comp_length) != Z_OK)
@@ -130,11 +136,6 @@ int corlett_decode(uint8_t *input, uint32_t input_len, uint8_t **output, uint64_
 		// Resize memory buffer to what we actually need
 		decomp_dat = (uint8_t *) realloc(decomp_dat, (size_t)decomp_length + 1);
 	}
-	else
-	{
-		decomp_dat = nullptr;
-		decomp_length =  0;
-	}
 
 	// Make structure
 	*c = (corlett_t *) malloc(sizeof(corlett_t));
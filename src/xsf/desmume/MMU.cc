@@ -1260,6 +1260,7 @@ void FASTCALL MMU_write8(u32 proc, u32 adr, u8 val)
 			break;
 	}
 
+	armcpu_invalidateCache(adr);
 	MMU.MMU_MEM[proc][(adr>>20)&0xFF][adr&MMU.MMU_MASK[proc][(adr>>20)&0xFF]]=val;
 }
 
@@ -1884,6 +1885,7 @@ void FASTCALL MMU_write16(u32 proc, u32 adr, u16 val)
 				return;
 		}
 	}
+	armcpu_invalidateCache(adr);
 	T1WriteWord(MMU.MMU_MEM[proc][(adr>>20)&0xFF], adr&MMU.MMU_MASK[proc][(adr>>20)&0xFF], val);
 }
 
@@ -2923,6 +2925,8 @@ void FASTCALL MMU_write32(u32 proc, u32 adr, u32 val)
 				return;
 		}
 	}
+	armcpu_invalidateCache(adr);
+	armcpu_invalidateCache(adr + 2);
 	T1WriteLong(MMU.MMU_MEM[proc][(adr>>20)&0xFF], adr&MMU.MMU_MASK[proc][(adr>>20)&0xFF], val);
 }
 
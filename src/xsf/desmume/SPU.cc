@@ -524,6 +524,7 @@ static void decode_pcm8(SChannel *ch, s32 *out, int length)
 		}
 		else
 #endif
+		if (out)
 		{
 			*(out++) += (ch->output * ch->volumel) >> VOL_SHIFT;
 			*(out++) += (ch->output * ch->volumer) >> VOL_SHIFT;
@@ -575,6 +576,7 @@ static void decode_pcm16(SChannel *ch, s32 *out, int length)
 		}
 		else
 #endif
+		if (out)
 		{
 			*(out++) += (ch->output * ch->volumel) >> VOL_SHIFT;
 			*(out++) += (ch->output * ch->volumer) >> VOL_SHIFT;
@@ -749,6 +751,7 @@ static void decode_adpcm(SChannel *ch, s32 *out, int length)
 		}
 		else
 #endif
+		if (out)
 		{
 			*(out++) += (ch->output * ch->volumel) >> VOL_SHIFT;
 			*(out++) += (ch->output * ch->volumer) >> VOL_SHIFT;
@@ -809,6 +812,7 @@ static void decode_psg(SChannel *ch, s32 *out, int length)
 			}
 			else
 #endif
+			if (out)
 			{
 				*(out++) += (ch->output * ch->volumel) >> VOL_SHIFT;
 				*(out++) += (ch->output * ch->volumer) >> VOL_SHIFT;
@@ -844,6 +848,7 @@ static void decode_psg(SChannel *ch, s32 *out, int length)
 		}
 		else
 #endif
+		if (out)
 		{
 			*(out++) += (ch->output * ch->volumel) >> VOL_SHIFT;
 			*(out++) += (ch->output * ch->volumer) >> VOL_SHIFT;
@@ -854,46 +859,65 @@ static void decode_psg(SChannel *ch, s32 *out, int length)
 
 
 
-void SPU_EmulateSamples(u32 numsamples)
+// Advances all channels by numsamples.  out is nullptr when the samples are
+// not wanted: the channels then keep their positions (and stop when they
+// should), but nothing is mixed.
+static void emulate_channels(s32 *out, u32 numsamples)
 {
-	u32 sizesmp = numsamples;
-	u32 sizebyte = sizesmp << 2;
-	if (sizebyte > spu.buflen * sizeof(s16)) sizebyte = spu.buflen * sizeof(s16);
-	sizesmp = sizebyte >> 2;
-	sizebyte = sizesmp << 2;
-	if (sizesmp > 0)
+	unsigned i;
+	SChannel *ch = spu.ch;
+	for (i = 0; i < 16; i++)
 	{
-		unsigned i;
-		SChannel *ch = spu.ch;
-		memset(spu.pmixbuf, 0, spu.buflen * sizeof(s32));
-		for (i = 0; i < 16; i++)
+		if (ch->status)
 		{
-			if (ch->status)
+			switch (ch->format)
 			{
-				switch (ch->format)
-				{
-				case 0:
-					decode_pcm8(ch, spu.pmixbuf, sizesmp);
-					break;
-				case 1:
-					decode_pcm16(ch, spu.pmixbuf, sizesmp);
-					break;
-				case 2:
-					decode_adpcm(ch, spu.pmixbuf, sizesmp);
-					break;
-				case 3:
-					decode_psg(ch, spu.pmixbuf, sizesmp);
-					break;
-				}
+			case 0:
+				decode_pcm8(ch, out, numsamples);
+				break;
+			case 1:
+				decode_pcm16(ch, out, numsamples);
+				break;
+			case 2:
+				decode_adpcm(ch, out, numsamples);
+				break;
+			case 3:
+				decode_psg(ch, out, numsamples);
+				break;
 			}
-			ch++;
 		}
+		ch++;
+	}
+}
+
+static u32 clip_samples(u32 numsamples)
+{
+	u32 sizebyte = numsamples << 2;
+	if (sizebyte > spu.buflen * sizeof(s16)) sizebyte = spu.buflen * sizeof(s16);
+	return sizebyte >> 2;
+}
+
+void SPU_EmulateSamples(u32 numsamples)
+{
+	u32 sizesmp = clip_samples(numsamples);
+	if (sizesmp > 0)
+	{
+		unsigned i;
+		memset(spu.pmixbuf, 0, spu.buflen * sizeof(s32));
+		emulate_channels(spu.pmixbuf, sizesmp);
 		for (i = 0; i < sizesmp * 2; i++)
 			spu.pclipingbuf[i] = (s16)clipping(spu.pmixbuf[i], -0x8000, 0x7fff);
 		SNDCore->UpdateAudio(spu.pclipingbuf, sizesmp);
 	}
 }
 
+void SPU_SkipSamples(u32 numsamples)
+{
+	u32 sizesmp = clip_samples(numsamples);
+	if (sizesmp > 0)
+		emulate_channels(nullptr, sizesmp);
+}
+
 void SPU_Emulate(void)
 {
 	SPU_EmulateSamples(SNDCore->GetAudioSpace());
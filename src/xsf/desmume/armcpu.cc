@@ -25,6 +25,7 @@
 #include "bios.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 const unsigned char arm_cond_table[16*16] = {
     /* N=0, Z=0, C=0, V=0 */
@@ -205,6 +206,9 @@ void armcpu_init(armcpu_t *armcpu, u32 adr)
 
 	armcpu->coproc[15] = (armcp_t*)armcp15_new(armcpu);
 
+	/* memory has been reloaded */
+	armcpu_flushCache();
+
 #ifndef GDB_STUB
 	armcpu_prefetch(armcpu);
 #endif
@@ -317,6 +321,98 @@ u32 armcpu_switchMode(armcpu_t *armcpu, u8 mode)
 	return oldmode;
 }
 
+/*
+ * Decoded instruction cache.
+ *
+ * Every instruction fetched from plain memory (BIOS, TCM, main RAM and the
+ * work RAMs) is kept together with its handler, so running it again costs a
+ * table lookup instead of a trip through MMU_read32 and the decoding.  The
+ * cache is direct mapped on the low bits of the address.  Every mirror of
+ * these memories repeats at a multiple of 16KB, so the slots an address
+ * falls into are the same for all of its aliases and for both CPUs, and a
+ * write only has to clear those slots (see armcpu_invalidateCache).
+ */
+
+#define DCACHE_SIZE  0x2000 /* slots, one per halfword of 16KB */
+#define DCACHE_EMPTY 0xFFFFFFFF
+#define DCACHE_INDEX(adr) (((adr) >> 1) & (DCACHE_SIZE - 1))
+
+/* the address regions (bits 24-27) that hold plain memory, for each CPU */
+static const u32 dcache_regions[2] = {
+	(1 << 0x0) | (1 << 0x2) | (1 << 0x3) | (1 << 0xF), /* ARM9: ITCM, RAM, BIOS */
+	(1 << 0x0) | (1 << 0x2) | (1 << 0x3),              /* ARM7: BIOS, RAM */
+};
+
+typedef struct
+{
+	u32 adr;                  /* address, | 1 for Thumb instructions */
+	u32 instruction;
+	u32 (FASTCALL *op)(armcpu_t * cpu);
+} armcpu_decoded;
+
+static armcpu_decoded dcache[2][DCACHE_SIZE];
+
+void armcpu_invalidateCache(u32 adr)
+{
+	u32 i = DCACHE_INDEX(adr);
+	u32 j = DCACHE_INDEX(adr & ~3);
+
+	dcache[0][i].adr = dcache[1][i].adr = DCACHE_EMPTY;
+	dcache[0][j].adr = dcache[1][j].adr = DCACHE_EMPTY;
+}
+
+void armcpu_flushCache(void)
+{
+	memset(dcache, 0xFF, sizeof(dcache));
+}
+
+#ifndef GDB_STUB
+static void armcpu_decode(armcpu_t *armcpu, u32 adr, u32 thumb)
+{
+	armcpu_decoded *d;
+
+	if(thumb)
+	{
+		armcpu->instruction = MMU_read16_acl(armcpu->proc_ID, adr, CP15_ACCESS_EXECUTE);
+		armcpu->op = thumb_instructions_set[armcpu->instruction>>6];
+	}
+	else
+	{
+		armcpu->instruction = MMU_read32_acl(armcpu->proc_ID, adr, CP15_ACCESS_EXECUTE);
+		armcpu->op = arm_instructions_set[INSTRUCTION_INDEX(armcpu->instruction)];
+	}
+
+	if(!(dcache_regions[armcpu->proc_ID] & (1 << ((adr >> 24) & 0xF))) || (adr | thumb) == DCACHE_EMPTY)
+		return;
+
+	/* the DTCM hides whatever it is mapped over */
+	if((armcpu->proc_ID == ARMCPU_ARM9) && ((adr & ~0x3FFF) == MMU.DTCMRegion))
+		return;
+
+	d = &dcache[armcpu->proc_ID][DCACHE_INDEX(adr)];
+	d->adr = adr | thumb;
+	d->instruction = armcpu->instruction;
+	d->op = armcpu->op;
+}
+
+/* build with ARMCPU_NO_DECODE_CACHE to fetch every instruction through the
+ * MMU again, for comparison (see bench/) */
+static INLINE void armcpu_fetch(armcpu_t *armcpu, u32 adr, u32 thumb)
+{
+#ifndef ARMCPU_NO_DECODE_CACHE
+	const armcpu_decoded *d = &dcache[armcpu->proc_ID][DCACHE_INDEX(adr)];
+
+	if(d->adr == (adr | thumb))
+	{
+		armcpu->instruction = d->instruction;
+		armcpu->op = d->op;
+	}
+	else
+#endif
+		armcpu_decode(armcpu, adr, thumb);
+}
+#endif
+
 u32 armcpu_prefetch(armcpu_t *armcpu)
 {
 #ifdef GDB_STUB
@@ -332,12 +428,13 @@ u32 armcpu_prefetch(armcpu_t *armcpu)
 
 		if ( !armcpu->stalled) {
 			armcpu->instruction = temp_instruction;
+			armcpu->op = arm_instructions_set[INSTRUCTION_INDEX(temp_instruction)];
 			armcpu->instruct_adr = armcpu->next_instruction;
 			armcpu->next_instruction += 4;
 			armcpu->R[15] = armcpu->next_instruction + 4;
 		}
 #else
-		armcpu->instruction = MMU_read32_acl(armcpu->proc_ID, armcpu->next_instruction,CP15_ACCESS_EXECUTE);
+		armcpu_fetch(armcpu, armcpu->next_instruction, 0);
 
 		armcpu->instruct_adr = armcpu->next_instruction;
 		armcpu->next_instruction += 4;
@@ -354,12 +451,13 @@ u32 armcpu_prefetch(armcpu_t *armcpu)
 
 	if ( !armcpu->stalled) {
 		armcpu->instruction = temp_instruction;
+		armcpu->op = thumb_instructions_set[temp_instruction>>6];
 		armcpu->instruct_adr = armcpu->next_instruction;
 		armcpu->next_instruction = armcpu->next_instruction + 2;
 		armcpu->R[15] = armcpu->next_instruction + 2;
 	}
 #else
-	armcpu->instruction = MMU_read16_acl(armcpu->proc_ID, armcpu->next_instruction,CP15_ACCESS_EXECUTE);
+	armcpu_fetch(armcpu, armcpu->next_instruction, 1);
 
 	armcpu->instruct_adr = armcpu->next_instruction;
 	armcpu->next_instruction += 2;
@@ -458,7 +556,7 @@ u32 armcpu_exec(armcpu_t *armcpu)
 /*        if((TEST_COND(CONDITION(armcpu->instruction), armcpu->CPSR)) || ((CONDITION(armcpu->instruction)==0xF)&&(CODE(armcpu->instruction)==0x5)))*/
         if((TEST_COND(CONDITION(armcpu->instruction), CODE(armcpu->instruction), armcpu->CPSR)))
 		{
-			c += arm_instructions_set[INSTRUCTION_INDEX(armcpu->instruction)](armcpu);
+			c += armcpu->op(armcpu);
 		}
 #ifdef GDB_STUB
         if ( armcpu->post_ex_fn != nullptr) {
@@ -472,7 +570,7 @@ u32 armcpu_exec(armcpu_t *armcpu)
 		return c;
 	}
 
-	c += thumb_instructions_set[armcpu->instruction>>6](armcpu);
+	c += armcpu->op(armcpu);
 
 #ifdef GDB_STUB
     if ( armcpu->post_ex_fn != nullptr) {
@@ -197,6 +197,9 @@ typedef struct armcpu_t
 
         u32 (* *swi_tab)(struct armcpu_t * cpu);
 
+        /* handler of the fetched instruction */
+        u32 (FASTCALL *op)(struct armcpu_t * cpu);
+
 #ifdef GDB_STUB
   /** there is a pending irq for the cpu */
   int irq_flag;
@@ -230,6 +233,8 @@ u32 armcpu_switchMode(armcpu_t *armcpu, u8 mode);
 u32 armcpu_prefetch(armcpu_t *armcpu);
 u32 armcpu_exec(armcpu_t *armcpu);
 BOOL armcpu_irqExeption(armcpu_t *armcpu);
+void armcpu_invalidateCache(u32 adr);
+void armcpu_flushCache(void);
 //BOOL armcpu_prefetchExeption(armcpu_t *armcpu);
 BOOL
 armcpu_flagIrq( armcpu_t *armcpu);
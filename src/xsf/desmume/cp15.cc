@@ -567,6 +567,7 @@ BOOL armcp15_moveARM2CP(armcp15_t *armcp15, u32 val, u8 CRn, u8 CRm, u8 opcode1,
 				case 0 :
 					armcp15->DTCMRegion = val;
 					MMU.DTCMRegion = val & 0x0FFFFFFC0;
+					armcpu_flushCache();
 					/*sprintf(logbuf, "%08X", val);
 					log::ajouter(logbuf);*/
 					return true;
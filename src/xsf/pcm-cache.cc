@@ -0,0 +1 @@
+#include "../pcm-cache/pcm-cache.cc"
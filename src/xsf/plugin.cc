@@ -37,6 +37,7 @@
 #include "ao.h"
 #include "corlett.h"
 #include "vio2sf.h"
+#include "../pcm-cache/pcm-cache.h"
 
 class XSFPlugin : public InputPlugin
 {
@@ -57,6 +58,7 @@ public:
 		.with_exts(exts)) {}
 
 	bool init();
+	void cleanup();
 
 	bool is_our_file(const char *filename, VFSFile &file);
 	bool read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *image);
@@ -67,6 +69,7 @@ EXPORT XSFPlugin aud_plugin_instance;
 
 /* xsf_get_lib: called to load secondary files */
 static String dirpath;
+static PCMCacheKey *lib_key;	/* set while the libraries are loaded the first time */
 
 #define CFG_ID "xsf"
 
@@ -79,13 +82,24 @@ const char* const XSFPlugin::defaults[] =
 bool XSFPlugin::init()
 {
 	aud_config_set_defaults(CFG_ID, defaults);
+	pcm_cache_init();
 	return true;
 }
 
+void XSFPlugin::cleanup()
+{
+	xsf_cleanup();
+}
+
 Index<char> xsf_get_lib(char *filename)
 {
 	VFSFile file(filename_build({dirpath, filename}), "r");
-	return file ? file.read_all() : Index<char>();
+	Index<char> buf = file ? file.read_all() : Index<char>();
+
+	if (lib_key)
+		lib_key->add(buf.begin(), buf.len());
+
+	return buf;
 }
 
 bool XSFPlugin::read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *image)
@@ -134,6 +148,13 @@ bool XSFPlugin::play(const char *filename, VFSFile &file)
 	float pos = 0.0;
 	bool error = false;
 
+	/* rendered audio is cached when a track plays through unseeked; not
+	 * when the length is ignored, since the track then never ends */
+	PCMCacheKey key;
+	PCMCacheReader cache;
+	PCMCacheWriter writer;
+	bool use_cache = pcm_cache_enabled() && !aud_get_bool(CFG_ID, "ignore_length");
+
 	const char * slash = strrchr (filename, '/');
 	if (! slash)
 		return false;
@@ -150,26 +171,60 @@ bool XSFPlugin::play(const char *filename, VFSFile &file)
 
 	length = xsf_get_length(buf);
 
+	if (use_cache)
+	{
+		key.add("xsf");
+		key.add(buf.begin(), buf.len());
+		key.add(length);
+		lib_key = &key;
+	}
+
 	if (xsf_start(buf.begin(), buf.len()) != AO_SUCCESS)
 	{
+		lib_key = nullptr;
 		error = true;
 		goto ERR_NO_CLOSE;
 	}
 
+	lib_key = nullptr;
+
 	set_stream_bitrate(44100*2*2*8);
 	open_audio(FMT_S16_NE, 44100, 2);
 
+	if (use_cache && cache.open(key, 44100, 2))
+	{
+		while (! check_stop ())
+		{
+			int seek_value = check_seek ();
+			if (seek_value >= 0)
+				cache.seek(seek_value);
+
+			int bytes = cache.read(samples, seglen * 4);
+			if (! bytes)
+				break;
+
+			write_audio(samples, bytes);
+		}
+
+		goto CLEANUP;
+	}
+
+	if (use_cache)
+		writer.open(key, 44100, 2);
+
 	while (! check_stop ())
 	{
 		int seek_value = check_seek ();
 
 		if (seek_value >= 0)
 		{
+			writer.abandon();
+
 			if (seek_value > pos)
 			{
 				while (pos < seek_value)
 				{
-					xsf_gen(samples, seglen);
+					xsf_skip(seglen);
 					pos += 16.666;
 				}
 			}
@@ -182,7 +237,7 @@ bool XSFPlugin::play(const char *filename, VFSFile &file)
 					pos = 0.0;
 					while (pos < seek_value)
 					{
-						xsf_gen(samples, seglen);
+						xsf_skip(seglen);
 						pos += 16.666; /* each segment is 16.666ms */
 					}
 				}
@@ -198,10 +253,14 @@ bool XSFPlugin::play(const char *filename, VFSFile &file)
 		pos += 16.666;
 
 		write_audio(samples, seglen * 4);
+		writer.write(samples, seglen * 4);
 
 		bool ignore_length = aud_get_bool(CFG_ID, "ignore_length");
 		if (pos >= length && !ignore_length)
+		{
+			writer.commit();
 			goto CLEANUP;
+		}
 	}
 
 CLEANUP:
@@ -230,6 +289,9 @@ const char *const XSFPlugin::exts[] = { "2sf", "mini2sf", nullptr };
 const PreferencesWidget XSFPlugin::widgets[] = {
 	WidgetLabel(N_("<b>XSF Configuration</b>")),
 	WidgetCheck(N_("Ignore length from file"), WidgetBool(CFG_ID, "ignore_length")),
+#ifdef PCM_CACHE
+	WidgetCheck(N_("Keep rendered audio on disk"), WidgetBool("pcm-cache", "enabled")),
+#endif
 };
 
 const PluginPreferences XSFPlugin::prefs = {{widgets}};
@@ -27,6 +27,58 @@ static struct
 	unsigned stateptr;
 } loaderwork = {0, 0, 0, 0, 0};
 
+/* Inflated maps are kept in a small LRU cache, so that the library shared by
+ * all tracks of an album is inflated only once.  A map is identified by the
+ * CRC and size of its compressed data.  Like the rest of the loader, the cache
+ * is not thread-safe. */
+#define MAPCACHE_MAX_MAPS	4
+#define MAPCACHE_MAX_BYTES	(32 << 20)
+#define MAPCACHE_MIN_SIZE	(64 << 10)	/* smaller maps are quick to inflate */
+
+typedef struct
+{
+	unsigned zcrc;
+	unsigned zsize;
+	Index<char> data;
+} cachedmap_t;
+
+static Index<cachedmap_t> mapcache;	/* least recently used first */
+static unsigned mapcache_bytes = 0;
+
+static const Index<char> *mapcache_lookup(unsigned zcrc, unsigned zsize)
+{
+	for (int i = mapcache.len() - 1; i >= 0; i--)
+	{
+		if (mapcache[i].zcrc == zcrc && mapcache[i].zsize == zsize)
+		{
+			/* move it to the most recently used end */
+			cachedmap_t map = std::move(mapcache[i]);
+			mapcache.remove(i, 1);
+			return &mapcache.append(std::move(map)).data;
+		}
+	}
+	return nullptr;
+}
+
+static void mapcache_add(unsigned zcrc, unsigned zsize, const unsigned char *udata, unsigned usize)
+{
+	if (usize < MAPCACHE_MIN_SIZE || usize > MAPCACHE_MAX_BYTES)
+		return;
+
+	while (mapcache.len() && (mapcache.len() >= MAPCACHE_MAX_MAPS ||
+	 mapcache_bytes + usize > MAPCACHE_MAX_BYTES))
+	{
+		mapcache_bytes -= mapcache[0].data.len();
+		mapcache.remove(0, 1);
+	}
+
+	cachedmap_t &map = mapcache.append();
+	map.zcrc = zcrc;
+	map.zsize = zsize;
+	map.data.insert((const char *) udata, 0, usize);
+	mapcache_bytes += usize;
+}
+
 static void load_term(void)
 {
 	if (loaderwork.rom)
@@ -116,6 +168,11 @@ static int load_mapz(int issave, unsigned char *zdata, unsigned zsize, unsigned
 	uLongf rsize = usize;
 	unsigned char *udata;
 	unsigned char *rdata;
+	unsigned zkey = crc32(crc32(0L, Z_NULL, 0), zdata, zsize);
+	const Index<char> *cached = mapcache_lookup(zkey, zsize);
+
+	if (cached)
+		return load_map(issave, (unsigned char *) cached->begin(), cached->len());
 
 	udata = (unsigned char *) malloc(usize);
 	if (!udata)
@@ -164,6 +221,8 @@ static int load_mapz(int issave, unsigned char *zdata, unsigned zsize, unsigned
 			return false;
 	}
 
+	mapcache_add(zkey, zsize, rdata, usize);
+
 	ret = load_map(issave, rdata, usize);
 	free(rdata);
 	return ret;
@@ -715,6 +774,7 @@ int xsf_start(void *pfile, unsigned bytes)
 		/* load state */
 
 		load_setstate();
+		armcpu_flushCache();
 		free(loaderwork.state);
 		loaderwork.state = 0;
 
@@ -745,6 +805,51 @@ int xsf_start(void *pfile, unsigned bytes)
 	return true;
 }
 
+#define HBASE_CYCLES 33509300.322234
+#define VBASE_CYCLES (((double)HBASE_CYCLES) / 100)
+#define HSAMPLES ((u32)((44100.0 * 6 * (99 + 256)) / HBASE_CYCLES))
+#define VSAMPLES ((u32)((44100.0 * 6 * (99 + 256) * 263) / HBASE_CYCLES))
+
+/* runs the CPUs for one frame (or line); returns how many samples the SPU has
+ * to produce for it */
+static int exec_frame(void)
+{
+	int numsamples;
+	if (sndifwork.sync_type == 1)
+	{
+		/* vsync */
+		sndifwork.cycles += (441 * 6 * (99 + 256) * 263);
+		if (sndifwork.cycles >= (u32)(VBASE_CYCLES * (VSAMPLES + 1)))
+		{
+			numsamples = (VSAMPLES + 1);
+			sndifwork.cycles -= (u32)(VBASE_CYCLES * (VSAMPLES + 1));
+		}
+		else
+		{
+			numsamples = (VSAMPLES + 0);
+			sndifwork.cycles -= (u32)(VBASE_CYCLES * (VSAMPLES + 0));
+		}
+		NDS_exec_frame(sndifwork.arm9_clockdown_level, sndifwork.arm7_clockdown_level);
+	}
+	else
+	{
+		/* hsync */
+		sndifwork.cycles += (44100 * 6 * (99 + 256));
+		if (sndifwork.cycles >= (u32)(HBASE_CYCLES * (HSAMPLES + 1)))
+		{
+			numsamples = (HSAMPLES + 1);
+			sndifwork.cycles -= (u32)(HBASE_CYCLES * (HSAMPLES + 1));
+		}
+		else
+		{
+			numsamples = (HSAMPLES + 0);
+			sndifwork.cycles -= (u32)(HBASE_CYCLES * (HSAMPLES + 0));
+		}
+		NDS_exec_hframe(sndifwork.arm9_clockdown_level, sndifwork.arm7_clockdown_level);
+	}
+	return numsamples;
+}
+
 int xsf_gen(void *pbuffer, unsigned samples)
 {
 	unsigned char *ptr = (unsigned char *) pbuffer;
@@ -774,50 +879,48 @@ int xsf_gen(void *pbuffer, unsigned samples)
 			}
 		}
 		if (remainbytes == 0)
-		{
+			SPU_EmulateSamples(exec_frame());
+	}
+	return ptr - (unsigned char *)pbuffer;
+}
 
-#define HBASE_CYCLES 33509300.322234
-#define VBASE_CYCLES (((double)HBASE_CYCLES) / 100)
-#define HSAMPLES ((u32)((44100.0 * 6 * (99 + 256)) / HBASE_CYCLES))
-#define VSAMPLES ((u32)((44100.0 * 6 * (99 + 256) * 263) / HBASE_CYCLES))
+/* Same as xsf_gen, but throws the samples away (for seeking).  The SPU only
+ * keeps track of the channel positions in frames that are skipped entirely;
+ * only the last frame, whose rest will be played, is mixed. */
+int xsf_skip(unsigned samples)
+{
+	unsigned bytes = samples << 2;
+	if (!sndifwork.xfs_load) return 0;
 
-			int numsamples;
-			if (sndifwork.sync_type == 1)
-			{
-				/* vsync */
-				sndifwork.cycles += (441 * 6 * (99 + 256) * 263);
-				if (sndifwork.cycles >= (u32)(VBASE_CYCLES * (VSAMPLES + 1)))
-				{
-					numsamples = (VSAMPLES + 1);
-					sndifwork.cycles -= (u32)(VBASE_CYCLES * (VSAMPLES + 1));
-				}
-				else
-				{
-					numsamples = (VSAMPLES + 0);
-					sndifwork.cycles -= (u32)(VBASE_CYCLES * (VSAMPLES + 0));
-				}
-				NDS_exec_frame(sndifwork.arm9_clockdown_level, sndifwork.arm7_clockdown_level);
-			}
-			else
-			{
-				/* hsync */
-				sndifwork.cycles += (44100 * 6 * (99 + 256));
-				if (sndifwork.cycles >= (u32)(HBASE_CYCLES * (HSAMPLES + 1)))
-				{
-					numsamples = (HSAMPLES + 1);
-					sndifwork.cycles -= (u32)(HBASE_CYCLES * (HSAMPLES + 1));
-				}
-				else
-				{
-					numsamples = (HSAMPLES + 0);
-					sndifwork.cycles -= (u32)(HBASE_CYCLES * (HSAMPLES + 0));
-				}
-				NDS_exec_hframe(sndifwork.arm9_clockdown_level, sndifwork.arm7_clockdown_level);
-			}
+	unsigned remainbytes = sndifwork.filled - sndifwork.used;
+	if (remainbytes > bytes)
+		remainbytes = bytes;
+	sndifwork.used += remainbytes;
+	bytes -= remainbytes;
+
+	while (bytes)
+	{
+		int numsamples = exec_frame();
+
+		/* as limited by SPU_EmulateSamples and SNDIFUpdateAudio */
+		unsigned framebytes = numsamples << 2;
+		if (framebytes > sndifwork.bufferbytes)
+			framebytes = sndifwork.bufferbytes;
+
+		if (framebytes > bytes)
+		{
 			SPU_EmulateSamples(numsamples);
+			sndifwork.used = bytes;
+			bytes = 0;
+		}
+		else
+		{
+			SPU_SkipSamples(numsamples);
+			sndifwork.filled = sndifwork.used = 0;
+			bytes -= framebytes;
 		}
 	}
-	return ptr - (unsigned char *)pbuffer;
+	return samples;
 }
 
 void xsf_term(void)
@@ -826,3 +929,9 @@ void xsf_term(void)
 	NDS_DeInit();
 	load_term();
 }
+
+void xsf_cleanup(void)
+{
+	mapcache.clear();
+	mapcache_bytes = 0;
+}
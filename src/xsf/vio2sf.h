@@ -2,5 +2,7 @@
 
 int xsf_start(void *pfile, unsigned bytes);
 int xsf_gen(void *pbuffer, unsigned samples);
+int xsf_skip(unsigned samples);
 Index<char> xsf_get_lib(char *pfilename);
 void xsf_term(void);
+void xsf_cleanup(void);